@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "animationplayer.h"
+
+#include <QImageReader>
+
+#include <algorithm>
+#include <cmath>
+
+
+// GIFs often say 0 (or 1-2 centiseconds) and mean "as fast as reasonable", which browsers play at 10 fps.
+static constexpr int minimumDelay = 20;
+static constexpr int defaultDelay = 100;
+
+
+AnimationPlayer::AnimationPlayer(const QString &filepath, qint64 budgetBytes, int releaseDelayMs, QObject *parent)
+    : QObject(parent),
+      filepath(filepath),
+      budget(budgetBytes)
+{
+    frameTimer.setSingleShot(true);
+    connect(&frameTimer, &QTimer::timeout, this, &AnimationPlayer::nextFrame);
+
+    releaseTimer.setSingleShot(true);
+    releaseTimer.setInterval(releaseDelayMs);
+    connect(&releaseTimer, &QTimer::timeout, this, &AnimationPlayer::release);
+}
+
+
+AnimationPlayer::~AnimationPlayer() = default;
+
+
+bool AnimationPlayer::open()
+{
+    reader = std::make_unique<QImageReader>(filepath);
+    readerNext = 0;
+    if(!reader->canRead()) {
+        reader.reset();
+        return false;
+    }
+
+    if(!size.isValid()) {
+        size = reader->size();
+        const int count = reader->imageCount();
+        if(size.isValid() && count > 0) {
+            // at 4 bytes a pixel, so it holds whether the frames turn out opaque or not.
+            const double bytes = 4.0 * size.width() * size.height() * count;
+            if(bytes > static_cast<double>(budget)) {
+                const double scale = std::sqrt(static_cast<double>(budget) / bytes);
+                size = QSize(std::max(1, static_cast<int>(size.width() * scale)),
+                             std::max(1, static_cast<int>(size.height() * scale)));
+            }
+        }
+    }
+    return true;
+}
+
+
+bool AnimationPlayer::decode(Frame &frame)
+{
+    if(!reader && !open()) {
+        return false;
+    }
+
+    QImage image = reader->read();
+    if(image.isNull()) {
+        return false;
+    }
+    readerNext++;
+
+    // the delay of the frame just read.
+    const int delay = reader->nextImageDelay();
+    frame.delay = (delay <= 0) ? defaultDelay : std::max(delay, minimumDelay);
+
+    if(size.isValid() && image.size() != size) {
+        image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    frame.image = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                                : QImage::Format_RGB888);
+    return true;
+}
+
+
+void AnimationPlayer::prepare()
+{
+    if(!frames.isEmpty()) {
+        return;
+    }
+    Frame frame;
+    if(decode(frame)) {
+        frameBytes += frame.image.sizeInBytes();
+        frames.append(frame);
+    }
+}
+
+
+QSize AnimationPlayer::frameSize()
+{
+    if(!size.isValid()) {
+        open();
+    }
+    return size;
+}
+
+
+void AnimationPlayer::start()
+{
+    releaseTimer.stop();
+    if(frameTimer.isActive()) {
+        return;
+    }
+
+    prepare();
+    // carry on where it was stopped.
+    if(current >= 0 && current < frames.size()) {
+        show(frames[current]);
+    }
+    else {
+        current = -1;
+        nextFrame();
+    }
+}
+
+
+void AnimationPlayer::stop()
+{
+    frameTimer.stop();
+    releaseTimer.start();
+}
+
+
+void AnimationPlayer::release()
+{
+    frames.clear();
+    frames.squeeze();
+    frameBytes = 0;
+    complete = false;
+    reader.reset();
+    readerNext = 0;
+    current = -1;
+}
+
+
+void AnimationPlayer::nextFrame()
+{
+    const int next = current + 1;
+    if(next < frames.size()) {
+        current = next;
+        show(frames[current]);
+        return;
+    }
+    if(complete) {
+        current = 0;
+        show(frames[current]);
+        return;
+    }
+
+    // past the decoded frames: the reader has to be at this one, which it is unless the budget
+    // could not hold all the frames and this is another loop.
+    if(!reader || readerNext != next) {
+        if(!open()) {
+            return;
+        }
+        Frame skipped;
+        while(readerNext < next && decode(skipped)) {
+        }
+    }
+
+    Frame frame;
+    if(!decode(frame)) {
+        if(next == 0) {
+            // not a single frame
+            return;
+        }
+        // the end of the animation, loop.
+        if(next == frames.size()) {
+            complete = true;
+            reader.reset();
+        }
+        current = -1;
+        nextFrame();
+        return;
+    }
+
+    if(next == frames.size() && frameBytes + frame.image.sizeInBytes() <= budget) {
+        frameBytes += frame.image.sizeInBytes();
+        frames.append(frame);
+    }
+    current = next;
+    show(frame);
+}
+
+
+void AnimationPlayer::show(const Frame &frame)
+{
+    emit frameChanged(QPixmap::fromImage(frame.image));
+    frameTimer.start(frame.delay);
+}
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef ANIMATIONPLAYER_H
+#define ANIMATIONPLAYER_H
+
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
+
+QT_BEGIN_NAMESPACE
+class QImageReader;
+QT_END_NAMESPACE
+
+
+// plays an animation (GIF) decoding each frame only once, instead of on every loop and for every
+// viewer like a QMovie per dialog does.
+//
+// the frames are decoded as they are first played, and kept, within a memory budget: if all the
+// frames at full size would not fit, they are kept down-scaled so they do. frames the budget
+// cannot hold anyway (when the frame count is not known up front) are decoded again each loop.
+// opaque frames are kept without an alpha channel, 3 bytes a pixel instead of 4.
+//
+// stopping does not free anything at once, so showing the animation again soon is free, but once
+// it has been stopped for releaseDelay the frames are dropped, and decoded again if played again.
+class AnimationPlayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    AnimationPlayer(const QString &filepath, qint64 budgetBytes, int releaseDelayMs, QObject *parent = nullptr);
+    ~AnimationPlayer() override;
+
+    // decode the first frame now, so that starting shows it at once.
+    void prepare();
+
+    // the size the frames are played at (the animation's, or less to fit the budget).
+    QSize frameSize();
+
+    // memory held by the decoded frames.
+    qint64 cachedBytes() const { return frameBytes; }
+
+public slots:
+    void start();
+    void stop();
+
+signals:
+    void frameChanged(const QPixmap &frame);
+
+private slots:
+    void nextFrame();
+    void release();
+
+private:
+    struct Frame
+    {
+        QImage image;
+        int delay;      // ms until the next frame
+    };
+
+    // opens the reader at the first frame, and works out the size the frames are kept at.
+    bool open();
+    // the next frame from the reader, scaled and converted, false at the end of the animation.
+    bool decode(Frame &frame);
+    void show(const Frame &frame);
+
+    QString filepath;
+    qint64 budget;
+
+    std::unique_ptr<QImageReader> reader;
+    int readerNext = 0;         // index of the frame the reader reads next
+    QSize size;
+
+    QVector<Frame> frames;      // frames 0 .. n-1, decoded
+    qint64 frameBytes = 0;
+    bool complete = false;      // all the frames are in 'frames'
+    int current = -1;
+
+    QTimer frameTimer;
+    QTimer releaseTimer;
+};
+
+#endif // #ifndef ANIMATIONPLAYER_H
@@ -0,0 +1,1023 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "automatonmatcher.h"
+
+#include <algorithm>
+#include <utility>
+
+
+namespace
+{
+
+using Instruction = AutomatonMatcher::Instruction;
+using Op = AutomatonMatcher::Instruction::Op;
+using ByteClass = AutomatonMatcher::ByteClass;
+
+// upper bound on the size of the program, counted repetitions like (...){1000} expand quickly.
+constexpr std::size_t maximumProgramSize = 64 * 1024;
+
+
+struct Node
+{
+    enum class Kind
+    {
+        Empty,
+        Byte,
+        Class,
+        Begin,
+        End,
+        WordBoundary,
+        NotWordBoundary,
+        Group,          // value: capture index, 0 for a non-capturing group
+        Concat,
+        Alternate,
+        Repeat,         // min, max (-1 for unbounded), greedy
+    };
+
+    Kind kind = Kind::Empty;
+    std::uint32_t value = 0;
+    int min = 0;
+    int max = -1;
+    bool greedy = true;
+    std::vector<Node> children;
+};
+
+
+bool isWordByte(unsigned char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+
+bool isHexDigit(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+
+int hexValue(char c)
+{
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+
+// recursive descent parser for the ECMAScript subset the automaton supports.
+// any failure (syntax error or unsupported feature) makes the whole compile fail.
+class Parser
+{
+public:
+    Parser(const std::string& pattern, std::vector<ByteClass>& classes)
+        : pattern(pattern), classes(classes)
+    {
+    }
+
+    bool parse(Node& root)
+    {
+        return parseAlternate(root) && pos == pattern.size();
+    }
+
+    std::size_t captureCount() const { return captures; }
+
+private:
+    bool atEnd() const { return pos >= pattern.size(); }
+    char peek() const { return pattern[pos]; }
+
+    std::uint32_t addClass(const ByteClass& byteClass)
+    {
+        classes.push_back(byteClass);
+        return static_cast<std::uint32_t>(classes.size() - 1);
+    }
+
+    bool parseAlternate(Node& out)
+    {
+        Node first;
+        if(!parseConcat(first)) {
+            return false;
+        }
+        if(atEnd() || peek() != '|') {
+            out = std::move(first);
+            return true;
+        }
+
+        out.kind = Node::Kind::Alternate;
+        out.children.push_back(std::move(first));
+        while(!atEnd() && peek() == '|') {
+            pos++;
+            Node next;
+            if(!parseConcat(next)) {
+                return false;
+            }
+            out.children.push_back(std::move(next));
+        }
+        return true;
+    }
+
+    bool parseConcat(Node& out)
+    {
+        out.kind = Node::Kind::Concat;
+        while(!atEnd() && peek() != '|' && peek() != ')') {
+            Node next;
+            if(!parseRepeat(next)) {
+                return false;
+            }
+            out.children.push_back(std::move(next));
+        }
+        return true;
+    }
+
+    bool parseRepeat(Node& out)
+    {
+        Node atom;
+        if(!parseAtom(atom)) {
+            return false;
+        }
+
+        int min = 0;
+        int max = -1;
+        if(atEnd()) {
+            out = std::move(atom);
+            return true;
+        }
+        switch(peek()) {
+        case '*': min = 0; max = -1; pos++; break;
+        case '+': min = 1; max = -1; pos++; break;
+        case '?': min = 0; max = 1; pos++; break;
+        case '{':
+            if(!parseBraces(min, max)) {
+                return false;
+            }
+            break;
+        default:
+            out = std::move(atom);
+            return true;
+        }
+
+        // assertions cannot be quantified.
+        if(atom.kind == Node::Kind::Begin || atom.kind == Node::Kind::End ||
+           atom.kind == Node::Kind::WordBoundary || atom.kind == Node::Kind::NotWordBoundary) {
+            return false;
+        }
+
+        bool greedy = true;
+        if(!atEnd() && peek() == '?') {
+            greedy = false;
+            pos++;
+        }
+
+        out.kind = Node::Kind::Repeat;
+        out.min = min;
+        out.max = max;
+        out.greedy = greedy;
+        out.children.push_back(std::move(atom));
+        return true;
+    }
+
+    bool parseNumber(int& value)
+    {
+        const std::size_t start = pos;
+        value = 0;
+        while(!atEnd() && peek() >= '0' && peek() <= '9') {
+            value = value * 10 + (peek() - '0');
+            if(value > 1000) {
+                return false;
+            }
+            pos++;
+        }
+        return pos > start;
+    }
+
+    // {n} {n,} {n,m}
+    bool parseBraces(int& min, int& max)
+    {
+        pos++;
+        if(!parseNumber(min)) {
+            return false;
+        }
+        max = min;
+        if(!atEnd() && peek() == ',') {
+            pos++;
+            max = -1;
+            if(!atEnd() && peek() != '}' && (!parseNumber(max) || max < min)) {
+                return false;
+            }
+        }
+        if(atEnd() || peek() != '}') {
+            return false;
+        }
+        pos++;
+        return true;
+    }
+
+    bool parseAtom(Node& out)
+    {
+        const char c = peek();
+        switch(c) {
+        case '(':
+        {
+            pos++;
+            std::uint32_t capture = 0;
+            if(!atEnd() && peek() == '?') {
+                // only non-capturing groups, no lookahead.
+                if(pos + 1 >= pattern.size() || pattern[pos + 1] != ':') {
+                    return false;
+                }
+                pos += 2;
+            }
+            else {
+                capture = static_cast<std::uint32_t>(++captures);
+            }
+            Node inner;
+            if(!parseAlternate(inner) || atEnd() || peek() != ')') {
+                return false;
+            }
+            pos++;
+            out.kind = Node::Kind::Group;
+            out.value = capture;
+            out.children.push_back(std::move(inner));
+            return true;
+        }
+        case '[':
+            return parseClass(out);
+        case '.':
+        {
+            pos++;
+            ByteClass any;
+            any.set();
+            any.reset('\n');
+            any.reset('\r');
+            out.kind = Node::Kind::Class;
+            out.value = addClass(any);
+            return true;
+        }
+        case '^':
+            pos++;
+            out.kind = Node::Kind::Begin;
+            return true;
+        case '$':
+            pos++;
+            out.kind = Node::Kind::End;
+            return true;
+        case '\\':
+            pos++;
+            return parseEscape(out);
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+            // nothing to repeat
+            return false;
+        default:
+            pos++;
+            out.kind = Node::Kind::Byte;
+            out.value = static_cast<unsigned char>(c);
+            return true;
+        }
+    }
+
+    // class escapes (\d \s \w and their negations), shared by atoms and classes.
+    static bool classEscape(char c, ByteClass& byteClass)
+    {
+        byteClass.reset();
+        switch(c) {
+        case 'd': case 'D':
+            for(int b = '0'; b <= '9'; b++) byteClass.set(b);
+            break;
+        case 's': case 'S':
+            for(char b : {' ', '\t', '\n', '\v', '\f', '\r'}) byteClass.set(static_cast<unsigned char>(b));
+            break;
+        case 'w': case 'W':
+            for(int b = 0; b < 256; b++) {
+                if(isWordByte(static_cast<unsigned char>(b))) byteClass.set(b);
+            }
+            break;
+        default:
+            return false;
+        }
+        if(c == 'D' || c == 'S' || c == 'W') {
+            byteClass.flip();
+        }
+        return true;
+    }
+
+    // character escapes, producing a single byte. the escape character itself has been consumed.
+    bool characterEscape(char c, unsigned char& byte)
+    {
+        switch(c) {
+        case 't': byte = '\t'; return true;
+        case 'n': byte = '\n'; return true;
+        case 'r': byte = '\r'; return true;
+        case 'f': byte = '\f'; return true;
+        case 'v': byte = '\v'; return true;
+        case '0':
+            // \0 followed by a digit would be an octal/backreference
+            if(!atEnd() && peek() >= '0' && peek() <= '9') {
+                return false;
+            }
+            byte = 0;
+            return true;
+        case 'c':
+            if(atEnd() || !((peek() >= 'a' && peek() <= 'z') || (peek() >= 'A' && peek() <= 'Z'))) {
+                return false;
+            }
+            byte = static_cast<unsigned char>(peek() % 32);
+            pos++;
+            return true;
+        case 'x':
+        case 'u':
+        {
+            const std::size_t digits = (c == 'x') ? 2 : 4;
+            if(pos + digits > pattern.size()) {
+                return false;
+            }
+            unsigned int value = 0;
+            for(std::size_t i = 0; i < digits; i++) {
+                if(!isHexDigit(pattern[pos + i])) {
+                    return false;
+                }
+                value = value * 16 + static_cast<unsigned int>(hexValue(pattern[pos + i]));
+            }
+            // the automaton works on bytes, not code points.
+            if(c == 'u' && value > 0x7f) {
+                return false;
+            }
+            pos += digits;
+            byte = static_cast<unsigned char>(value);
+            return true;
+        }
+        default:
+            // backreferences and unknown letter escapes are not supported,
+            // everything else is an identity escape.
+            if((c >= '1' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                return false;
+            }
+            byte = static_cast<unsigned char>(c);
+            return true;
+        }
+    }
+
+    bool parseEscape(Node& out)
+    {
+        if(atEnd()) {
+            return false;
+        }
+        const char c = pattern[pos++];
+
+        if(c == 'b' || c == 'B') {
+            out.kind = (c == 'b') ? Node::Kind::WordBoundary : Node::Kind::NotWordBoundary;
+            return true;
+        }
+
+        ByteClass byteClass;
+        if(classEscape(c, byteClass)) {
+            out.kind = Node::Kind::Class;
+            out.value = addClass(byteClass);
+            return true;
+        }
+
+        unsigned char byte;
+        if(!characterEscape(c, byte)) {
+            return false;
+        }
+        out.kind = Node::Kind::Byte;
+        out.value = byte;
+        return true;
+    }
+
+    // a single class member: either a byte, or a class escape (returned in 'set').
+    bool parseClassAtom(unsigned char& byte, ByteClass& set, bool& isSet)
+    {
+        isSet = false;
+        if(atEnd()) {
+            return false;
+        }
+        const char c = pattern[pos++];
+        if(c != '\\') {
+            byte = static_cast<unsigned char>(c);
+            return true;
+        }
+        if(atEnd()) {
+            return false;
+        }
+        const char e = pattern[pos++];
+        if(e == 'b') {
+            byte = '\b';
+            return true;
+        }
+        if(e == '-') {
+            byte = '-';
+            return true;
+        }
+        if(classEscape(e, set)) {
+            isSet = true;
+            return true;
+        }
+        return characterEscape(e, byte);
+    }
+
+    bool parseClass(Node& out)
+    {
+        pos++;
+        bool negate = false;
+        if(!atEnd() && peek() == '^') {
+            negate = true;
+            pos++;
+        }
+
+        ByteClass byteClass;
+        while(!atEnd() && peek() != ']') {
+            unsigned char low;
+            ByteClass set;
+            bool isSet;
+            if(!parseClassAtom(low, set, isSet)) {
+                return false;
+            }
+            if(isSet) {
+                byteClass |= set;
+                continue;
+            }
+
+            // range, unless the '-' is the last character of the class.
+            if(pos + 1 < pattern.size() && peek() == '-' && pattern[pos + 1] != ']') {
+                pos++;
+                unsigned char high;
+                if(!parseClassAtom(high, set, isSet) || isSet || high < low) {
+                    return false;
+                }
+                for(unsigned int b = low; b <= high; b++) {
+                    byteClass.set(b);
+                }
+            }
+            else {
+                byteClass.set(low);
+            }
+        }
+        if(atEnd()) {
+            return false;
+        }
+        pos++;
+
+        if(negate) {
+            byteClass.flip();
+        }
+        out.kind = Node::Kind::Class;
+        out.value = addClass(byteClass);
+        return true;
+    }
+
+    const std::string& pattern;
+    std::vector<ByteClass>& classes;
+    std::size_t pos = 0;
+    std::size_t captures = 0;
+};
+
+
+// Thompson construction of the program from the syntax tree.
+class Compiler
+{
+public:
+    explicit Compiler(std::vector<Instruction>& program)
+        : program(program)
+    {
+    }
+
+    bool compile(const Node& node)
+    {
+        if(program.size() > maximumProgramSize) {
+            return false;
+        }
+
+        switch(node.kind) {
+        case Node::Kind::Empty:
+            return true;
+        case Node::Kind::Byte:
+            emit(Op::Byte, node.value);
+            return true;
+        case Node::Kind::Class:
+            emit(Op::Class, node.value);
+            return true;
+        case Node::Kind::Begin:
+            emit(Op::AssertBegin);
+            return true;
+        case Node::Kind::End:
+            emit(Op::AssertEnd);
+            return true;
+        case Node::Kind::WordBoundary:
+            emit(Op::WordBoundary);
+            return true;
+        case Node::Kind::NotWordBoundary:
+            emit(Op::NotWordBoundary);
+            return true;
+        case Node::Kind::Group:
+            if(node.value == 0) {
+                return compile(node.children[0]);
+            }
+            emit(Op::Save, 2 * node.value);
+            if(!compile(node.children[0])) {
+                return false;
+            }
+            emit(Op::Save, 2 * node.value + 1);
+            return true;
+        case Node::Kind::Concat:
+            for(const Node& child : node.children) {
+                if(!compile(child)) {
+                    return false;
+                }
+            }
+            return true;
+        case Node::Kind::Alternate:
+            return compileAlternate(node);
+        case Node::Kind::Repeat:
+            return compileRepeat(node);
+        }
+        return false;
+    }
+
+private:
+    std::size_t emit(Op op, std::uint32_t arg = 0)
+    {
+        program.push_back(Instruction{op, arg, 0, 0});
+        return program.size() - 1;
+    }
+
+    std::uint32_t here() const { return static_cast<std::uint32_t>(program.size()); }
+
+    // split to the alternatives in order, each ending with a jump past the last one.
+    bool compileAlternate(const Node& node)
+    {
+        std::vector<std::size_t> jumps;
+        for(std::size_t i = 0; i < node.children.size(); i++) {
+            if(i + 1 < node.children.size()) {
+                const std::size_t split = emit(Op::Split);
+                program[split].x = here();
+                if(!compile(node.children[i])) {
+                    return false;
+                }
+                jumps.push_back(emit(Op::Jump));
+                program[split].y = here();
+            }
+            else if(!compile(node.children[i])) {
+                return false;
+            }
+        }
+        for(std::size_t jump : jumps) {
+            program[jump].x = here();
+        }
+        return true;
+    }
+
+    bool compileRepeat(const Node& node)
+    {
+        const Node& body = node.children[0];
+
+        for(int i = 0; i < node.min; i++) {
+            if(!compile(body)) {
+                return false;
+            }
+        }
+
+        if(node.max < 0) {
+            // L: split body, out; body; jump L
+            const std::size_t split = emit(Op::Split);
+            program[split].x = here();
+            if(!compile(body)) {
+                return false;
+            }
+            program[emit(Op::Jump)].x = static_cast<std::uint32_t>(split);
+            program[split].y = here();
+            if(!node.greedy) {
+                std::swap(program[split].x, program[split].y);
+            }
+            return true;
+        }
+
+        // optional copies, each one only tried if the previous one matched: (x(x)?)?
+        std::vector<std::size_t> splits;
+        for(int i = node.min; i < node.max; i++) {
+            const std::size_t split = emit(Op::Split);
+            program[split].x = here();
+            splits.push_back(split);
+            if(!compile(body)) {
+                return false;
+            }
+        }
+        for(std::size_t split : splits) {
+            program[split].y = here();
+            if(!node.greedy) {
+                std::swap(program[split].x, program[split].y);
+            }
+        }
+        return true;
+    }
+
+    std::vector<Instruction>& program;
+};
+
+
+// set of program counters in insertion (= priority) order, with the capture slots of each thread.
+struct ThreadList
+{
+    std::vector<std::uint32_t> sparse;
+    std::vector<std::uint32_t> dense;
+    std::size_t count = 0;
+    std::vector<const char*> slots;
+
+    void resize(std::size_t programSize, std::size_t slotCount)
+    {
+        sparse.assign(programSize, 0);
+        dense.assign(programSize, 0);
+        slots.assign(programSize * slotCount, nullptr);
+        count = 0;
+    }
+
+    bool contains(std::uint32_t pc) const
+    {
+        const std::uint32_t index = sparse[pc];
+        return index < count && dense[index] == pc;
+    }
+
+    void insert(std::uint32_t pc)
+    {
+        sparse[pc] = static_cast<std::uint32_t>(count);
+        dense[count++] = pc;
+    }
+};
+
+
+struct Frame
+{
+    std::uint32_t index;    // pc to explore, or slot to restore
+    const char* value;      // value to restore
+    bool restore;
+};
+
+
+class AutomatonScratch : public MatchScratch
+{
+public:
+    const AutomatonMatcher* owner = nullptr;
+    ThreadList current;
+    ThreadList next;
+    std::vector<const char*> work;
+    std::vector<const char*> initial;
+    std::vector<Frame> stack;
+    // start of the earliest thread that ran into the end of the subject.
+    const char* partialBegin = nullptr;
+};
+
+
+void notePartial(AutomatonScratch& scratch, const char* start)
+{
+    if(scratch.partialBegin == nullptr || start < scratch.partialBegin) {
+        scratch.partialBegin = start;
+    }
+}
+
+
+bool atWordBoundary(const char* begin, const char* end, const char* sp)
+{
+    const bool before = (sp > begin) && isWordByte(static_cast<unsigned char>(sp[-1]));
+    const bool after = (sp < end) && isWordByte(static_cast<unsigned char>(sp[0]));
+    return before != after;
+}
+
+
+// follow the empty transitions from 'pc' at position 'sp', adding every thread that
+// consumes a byte (or matches) to 'list', in priority order.
+void addThread(const std::vector<Instruction>& program, ThreadList& list, std::uint32_t startPc,
+               const char* begin, const char* end, const char* sp,
+               const char* const* slots, std::size_t slotCount, AutomatonScratch& scratch)
+{
+    std::vector<const char*>& work = scratch.work;
+    std::vector<Frame>& stack = scratch.stack;
+
+    work.assign(slots, slots + slotCount);
+    stack.clear();
+    stack.push_back(Frame{startPc, nullptr, false});
+
+    while(!stack.empty()) {
+        const Frame frame = stack.back();
+        stack.pop_back();
+
+        if(frame.restore) {
+            work[frame.index] = frame.value;
+            continue;
+        }
+
+        std::uint32_t pc = frame.index;
+        for(;;) {
+            if(list.contains(pc)) {
+                break;
+            }
+            list.insert(pc);
+
+            const Instruction& instruction = program[pc];
+            switch(instruction.op) {
+            case Op::Jump:
+                pc = instruction.x;
+                continue;
+            case Op::Split:
+                stack.push_back(Frame{instruction.y, nullptr, false});
+                pc = instruction.x;
+                continue;
+            case Op::Save:
+                stack.push_back(Frame{instruction.arg, work[instruction.arg], true});
+                work[instruction.arg] = sp;
+                pc++;
+                continue;
+            case Op::AssertBegin:
+                if(sp != begin) break;
+                pc++;
+                continue;
+            // at the end of the subject these depend on what follows it.
+            case Op::AssertEnd:
+                if(sp == end) notePartial(scratch, work[0]);
+                if(sp != end) break;
+                pc++;
+                continue;
+            case Op::WordBoundary:
+                if(sp == end) notePartial(scratch, work[0]);
+                if(!atWordBoundary(begin, end, sp)) break;
+                pc++;
+                continue;
+            case Op::NotWordBoundary:
+                if(sp == end) notePartial(scratch, work[0]);
+                if(atWordBoundary(begin, end, sp)) break;
+                pc++;
+                continue;
+            case Op::Byte:
+            case Op::Class:
+            case Op::Match:
+                std::copy(work.begin(), work.end(), list.slots.begin() + static_cast<std::ptrdiff_t>(pc * slotCount));
+                break;
+            }
+            break;
+        }
+    }
+}
+
+} // namespace
+
+
+std::unique_ptr<AutomatonMatcher> AutomatonMatcher::compile(const std::string& pattern)
+{
+    std::unique_ptr<AutomatonMatcher> matcher(new AutomatonMatcher());
+
+    Node root;
+    Parser parser(pattern, matcher->classes);
+    if(!parser.parse(root)) {
+        return nullptr;
+    }
+    matcher->captures = parser.captureCount();
+
+    // the whole match is capture 0.
+    std::vector<Instruction>& program = matcher->instructions;
+    program.push_back(Instruction{Op::Save, 0, 0, 0});
+    Compiler compiler(program);
+    if(!compiler.compile(root)) {
+        return nullptr;
+    }
+    program.push_back(Instruction{Op::Save, 1, 0, 0});
+    program.push_back(Instruction{Op::Match, 0, 0, 0});
+
+    // which bytes can start a match, whether an empty match is possible, and whether every
+    // match has to start at the beginning: walk the empty transitions from the start, taking
+    // every assertion as satisfied (except ^ for the 'anchored' walk).
+    for(const bool passBegin : {true, false}) {
+        std::vector<bool> visited(program.size(), false);
+        std::vector<std::uint32_t> pending{0};
+        bool reachesConsumer = false;
+        while(!pending.empty()) {
+            const std::uint32_t pc = pending.back();
+            pending.pop_back();
+            if(visited[pc]) {
+                continue;
+            }
+            visited[pc] = true;
+
+            const Instruction& instruction = program[pc];
+            switch(instruction.op) {
+            case Op::Byte:
+                if(passBegin) matcher->firstBytes.set(instruction.arg);
+                reachesConsumer = true;
+                break;
+            case Op::Class:
+                if(passBegin) matcher->firstBytes |= matcher->classes[instruction.arg];
+                reachesConsumer = true;
+                break;
+            case Op::Match:
+                if(passBegin) matcher->canMatchEmpty = true;
+                reachesConsumer = true;
+                break;
+            case Op::Jump:
+                pending.push_back(instruction.x);
+                break;
+            case Op::Split:
+                pending.push_back(instruction.x);
+                pending.push_back(instruction.y);
+                break;
+            case Op::AssertBegin:
+                if(passBegin) pending.push_back(pc + 1);
+                break;
+            case Op::Save:
+            case Op::AssertEnd:
+            case Op::WordBoundary:
+            case Op::NotWordBoundary:
+                pending.push_back(pc + 1);
+                break;
+            }
+        }
+        if(!passBegin) {
+            matcher->anchoredAtBegin = !reachesConsumer;
+        }
+    }
+
+    matcher->computeLiteralPrefixes();
+
+    return matcher;
+}
+
+
+// follow every path from the start, collecting the bytes that have to come first on that path,
+// until something that is not a single byte (a class, the end of the match, a loop) is reached.
+// assertions other than ^ and $ are skipped, matchAt() checks them anyway.
+void AutomatonMatcher::computeLiteralPrefixes()
+{
+    constexpr std::size_t maximumPrefixes = 8;
+    constexpr std::size_t maximumPrefixLength = 16;
+
+    struct Path
+    {
+        std::uint32_t pc;
+        std::string prefix;
+        std::vector<std::uint32_t> splits;  // splits seen on this path, to stop at loops
+    };
+
+    std::vector<std::string> found;
+    std::vector<Path> pending{Path{0, std::string(), {}}};
+    while(!pending.empty()) {
+        Path path = std::move(pending.back());
+        pending.pop_back();
+
+        for(bool done = false; !done;) {
+            const Instruction& instruction = instructions[path.pc];
+            switch(instruction.op) {
+            case Op::Save:
+            case Op::WordBoundary:
+            case Op::NotWordBoundary:
+                path.pc++;
+                break;
+            case Op::Jump:
+                path.pc = instruction.x;
+                break;
+            case Op::Split:
+                if(std::find(path.splits.begin(), path.splits.end(), path.pc) != path.splits.end()) {
+                    done = true;
+                    break;
+                }
+                // too many alternatives for a prefilter to be of any use.
+                if(found.size() + pending.size() > maximumPrefixes) {
+                    return;
+                }
+                path.splits.push_back(path.pc);
+                pending.push_back(Path{instruction.y, path.prefix, path.splits});
+                path.pc = instruction.x;
+                break;
+            case Op::Byte:
+            case Op::Class:
+            {
+                int byte = (instruction.op == Op::Byte) ? static_cast<int>(instruction.arg) : -1;
+                if(instruction.op == Op::Class && classes[instruction.arg].count() == 1) {
+                    for(int b = 0; b < 256; b++) {
+                        if(classes[instruction.arg][static_cast<std::size_t>(b)]) byte = b;
+                    }
+                }
+                if(byte < 0 || path.prefix.size() >= maximumPrefixLength) {
+                    done = true;
+                    break;
+                }
+                path.prefix.push_back(static_cast<char>(byte));
+                path.pc++;
+                break;
+            }
+            case Op::AssertBegin:
+            case Op::AssertEnd:
+            case Op::Match:
+                done = true;
+                break;
+            }
+        }
+
+        // a path that can start a match with anything: no prefilter possible.
+        if(path.prefix.empty()) {
+            return;
+        }
+        found.push_back(std::move(path.prefix));
+        if(found.size() > maximumPrefixes) {
+            return;
+        }
+    }
+
+    // a literal which starts with another one is redundant, the shorter one finds it too.
+    std::sort(found.begin(), found.end());
+    for(const std::string& literal : found) {
+        if(prefixes.empty() || literal.compare(0, prefixes.back().size(), prefixes.back()) != 0) {
+            prefixes.push_back(literal);
+        }
+    }
+}
+
+
+bool AutomatonMatcher::search(const char* begin, const char* end, const char* from, MatchResult& result) const
+{
+    return run(begin, end, from, false, result);
+}
+
+
+bool AutomatonMatcher::matchAt(const char* begin, const char* end, const char* at, MatchResult& result) const
+{
+    return run(begin, end, at, true, result);
+}
+
+
+bool AutomatonMatcher::run(const char* begin, const char* end, const char* from, bool anchored,
+                           MatchResult& result) const
+{
+    AutomatonScratch* scratch = dynamic_cast<AutomatonScratch*>(result.scratch.get());
+    const std::size_t slotCount = 2 * (captures + 1);
+    if(scratch == nullptr || scratch->owner != this) {
+        result.scratch = std::make_unique<AutomatonScratch>();
+        scratch = static_cast<AutomatonScratch*>(result.scratch.get());
+        scratch->owner = this;
+        scratch->current.resize(instructions.size(), slotCount);
+        scratch->next.resize(instructions.size(), slotCount);
+        scratch->initial.assign(slotCount, nullptr);
+    }
+
+    result.groups.assign(slotCount, nullptr);
+
+    ThreadList* current = &scratch->current;
+    ThreadList* next = &scratch->next;
+    current->count = 0;
+    scratch->partialBegin = nullptr;
+
+    bool matched = false;
+    const char* sp = from;
+    for(;;) {
+        // start a new thread at every position until a match is found, with the lowest priority,
+        // which makes the search unanchored and leftmost. anchored, only at the first position.
+        if(!matched && (!anchoredAtBegin || sp == begin) && (!anchored || sp == from)) {
+            if(current->count == 0 && !canMatchEmpty && !anchored) {
+                while(sp < end && !firstBytes[static_cast<unsigned char>(*sp)]) {
+                    ++sp;
+                }
+                if(sp == end) {
+                    break;
+                }
+            }
+            addThread(instructions, *current, 0, begin, end, sp,
+                      scratch->initial.data(), slotCount, *scratch);
+        }
+
+        if(current->count == 0) {
+            break;
+        }
+
+        next->count = 0;
+        for(std::size_t i = 0; i < current->count; i++) {
+            const std::uint32_t pc = current->dense[i];
+            const Instruction& instruction = instructions[pc];
+            const char* const* slots = current->slots.data() + pc * slotCount;
+
+            if(instruction.op == Op::Match) {
+                std::copy(slots, slots + slotCount, result.groups.begin());
+                matched = true;
+                // threads after this one have lower priority.
+                break;
+            }
+
+            if(sp == end) {
+                // it would go on with more of the subject.
+                if(instruction.op == Op::Byte || instruction.op == Op::Class) {
+                    notePartial(*scratch, slots[0]);
+                }
+                continue;
+            }
+            const unsigned char c = static_cast<unsigned char>(*sp);
+            if((instruction.op == Op::Byte && c == instruction.arg) ||
+               (instruction.op == Op::Class && classes[instruction.arg][c])) {
+                addThread(instructions, *next, pc + 1, begin, end, sp + 1, slots, slotCount, *scratch);
+            }
+        }
+
+        std::swap(current, next);
+        if(sp == end) {
+            break;
+        }
+        ++sp;
+    }
+
+    result.partialBegin = scratch->partialBegin;
+    return matched;
+}
@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef AUTOMATONMATCHER_H
+#define AUTOMATONMATCHER_H
+
+#include "matcher.h"
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+// Thompson NFA simulated as a Pike VM: every thread of the automaton advances in lockstep
+// over the input, so a search is O(input * pattern) with no backtracking, no recursion on the
+// input, and therefore no blowup on pathological patterns or stack overflow on large inputs.
+//
+// threads are kept in priority order, which gives the leftmost-first (ECMAScript) match and
+// the same captures as std::regex for the patterns we use.
+//
+// supported: literals, escapes (\d \D \s \S \w \W \b \B \t \n \r \f \v \0 \xhh \uhhhh),
+// classes [...] and [^...], '.', '^', '$', groups (...) and (?:...), alternation,
+// greedy and lazy quantifiers * + ? {n} {n,} {n,m}.
+// not supported: backreferences and lookahead assertions.
+class AutomatonMatcher : public Matcher
+{
+public:
+    // returns nullptr if the pattern uses a feature the automaton does not support,
+    // or is not a valid pattern.
+    static std::unique_ptr<AutomatonMatcher> compile(const std::string& pattern);
+
+    bool search(const char* begin, const char* end, const char* from, MatchResult& result) const override;
+    bool matchAt(const char* begin, const char* end, const char* at, MatchResult& result) const override;
+    std::size_t captureCount() const override { return captures; }
+    const char* name() const override { return "automaton"; }
+
+    struct Instruction
+    {
+        enum class Op : std::uint8_t
+        {
+            Byte,           // consume the byte 'arg'
+            Class,          // consume a byte in classes['arg']
+            Split,          // fork: continue at 'x' (preferred) and 'y'
+            Jump,           // continue at 'x'
+            Save,           // record the position in capture slot 'arg'
+            AssertBegin,    // ^
+            AssertEnd,      // $
+            WordBoundary,   // \b
+            NotWordBoundary,// \B
+            Match,
+        };
+
+        Op op;
+        std::uint32_t arg;
+        std::uint32_t x;
+        std::uint32_t y;
+    };
+
+    using ByteClass = std::bitset<256>;
+
+    const std::vector<Instruction>& program() const { return instructions; }
+    const std::vector<ByteClass>& byteClasses() const { return classes; }
+
+    // literals of which every match starts with one, empty if there is no such set.
+    const std::vector<std::string>& literalPrefixes() const { return prefixes; }
+
+private:
+    AutomatonMatcher() = default;
+
+    bool run(const char* begin, const char* end, const char* from, bool anchored, MatchResult& result) const;
+    void computeLiteralPrefixes();
+
+    std::vector<Instruction> instructions;
+    std::vector<ByteClass> classes;
+    std::size_t captures = 0;
+    // bytes that can begin a match, used to skip ahead while no thread is alive.
+    ByteClass firstBytes;
+    bool anchoredAtBegin = false;
+    bool canMatchEmpty = false;
+    std::vector<std::string> prefixes;
+};
+
+#endif // #ifndef AUTOMATONMATCHER_H
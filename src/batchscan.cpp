@@ -0,0 +1,725 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "batchscan.h"
+#include "directoryscanner.h"
+#include "metricstore.h"
+#include "ruleset.h"
+#include "scanmetrics.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace
+{
+
+// used without --rules, the same series the GUI extracts.
+constexpr const char* defaultRules =
+    "stage   stage:int   stage\\s+(\\d+)\\s*:\n"
+    "errors  count:int   errors\\s*:\\s*(\\d+)\n";
+
+
+enum class OutputFormat
+{
+    Text,
+    Json,
+};
+
+
+// --max rule=N or --max rule.field=N
+struct Threshold
+{
+    std::string text;           // as given on the command line
+    std::size_t rule = 0;
+    bool isField = false;       // a field's value, otherwise the number of matches of the rule
+    std::size_t field = 0;
+    double limit = 0;
+
+    // per file
+    double value = 0;
+    bool seen = false;
+};
+
+
+struct Options
+{
+    std::vector<std::string> files;
+    std::string rulesPath;
+    OutputFormat format = OutputFormat::Text;
+    std::vector<std::string> thresholds;
+    unsigned int threads = 0;
+    std::string tracePath;
+    MatcherBackend backend = MatcherBackend::Builtin;
+
+    // --store, or the store of --query
+    std::string storePath;
+    std::string runLabel;
+    bool query = false;
+    std::string queryField;
+    std::string runWindow;      // "first:last"
+    unsigned int lastRuns = 0;
+    bool haveStage = false;
+    std::uint32_t stage = 0;
+    MetricQuery::GroupBy groupBy = MetricQuery::GroupBy::Stage;
+};
+
+
+// the percentiles --query reports.
+const std::vector<double> queryPercentiles = {0.5, 0.9, 0.99};
+
+
+void printUsage(std::ostream& stream)
+{
+    stream << "usage: quetzalcoatlus --scan <files|directories|globs...> [--rules <file>] [--format text|json]\n"
+              "                      [--max <rule>=<N>] [--max <rule>.<field>=<N>] [--threads <N>]\n"
+              "                      [--trace <file>] [--store <directory> [--run <label>]]\n"
+              "                      [--matcher builtin|automaton|regex|qregularexpression]\n"
+              "       quetzalcoatlus --query <directory> [--field <rule>.<field>]\n"
+              "                      [--run <label> | --runs <first>:<last> | --last <N>] [--stage <N>]\n"
+              "                      [--by stage|run|all] [--format text|json]\n"
+              "\n"
+              "one scan at a time writes to a store, --query reads it while it is written.\n"
+              "\n"
+              "exit status: 0 all thresholds held, 1 a threshold was exceeded,\n"
+              "             2 bad arguments or rule file, 3 a file could not be scanned\n";
+}
+
+
+bool parseOptions(int argc, char* argv[], Options& options, std::ostream& err)
+{
+    for(int i = 1; i < argc; i++) {
+        const std::string_view argument(argv[i]);
+
+        auto value = [&](std::string& target) {
+            if(i + 1 >= argc) {
+                err << "missing value for " << argument << "\n";
+                return false;
+            }
+            target = argv[++i];
+            return true;
+        };
+
+        if(argument == "--scan") {
+            // the files are the positional arguments, wherever they are.
+            continue;
+        }
+        else if(argument == "--query") {
+            options.query = true;
+            if(!value(options.storePath)) {
+                return false;
+            }
+        }
+        else if(argument == "--store") {
+            if(!value(options.storePath)) {
+                return false;
+            }
+        }
+        else if(argument == "--run") {
+            if(!value(options.runLabel)) {
+                return false;
+            }
+        }
+        else if(argument == "--field") {
+            if(!value(options.queryField)) {
+                return false;
+            }
+        }
+        else if(argument == "--runs") {
+            if(!value(options.runWindow)) {
+                return false;
+            }
+        }
+        else if(argument == "--last") {
+            std::string last;
+            if(!value(last)) {
+                return false;
+            }
+            options.lastRuns = static_cast<unsigned int>(std::strtoul(last.c_str(), nullptr, 10));
+        }
+        else if(argument == "--stage") {
+            std::string stage;
+            if(!value(stage)) {
+                return false;
+            }
+            options.haveStage = true;
+            options.stage = static_cast<std::uint32_t>(std::strtoul(stage.c_str(), nullptr, 10));
+        }
+        else if(argument == "--by") {
+            std::string groupBy;
+            if(!value(groupBy)) {
+                return false;
+            }
+            if(groupBy == "stage") {
+                options.groupBy = MetricQuery::GroupBy::Stage;
+            }
+            else if(groupBy == "run") {
+                options.groupBy = MetricQuery::GroupBy::Run;
+            }
+            else if(groupBy == "all") {
+                options.groupBy = MetricQuery::GroupBy::None;
+            }
+            else {
+                err << "unknown grouping '" << groupBy << "'\n";
+                return false;
+            }
+        }
+        else if(argument == "--rules") {
+            if(!value(options.rulesPath)) {
+                return false;
+            }
+        }
+        else if(argument == "--format") {
+            std::string format;
+            if(!value(format)) {
+                return false;
+            }
+            if(format == "text") {
+                options.format = OutputFormat::Text;
+            }
+            else if(format == "json") {
+                options.format = OutputFormat::Json;
+            }
+            else {
+                err << "unknown format '" << format << "'\n";
+                return false;
+            }
+        }
+        else if(argument == "--max") {
+            std::string threshold;
+            if(!value(threshold)) {
+                return false;
+            }
+            options.thresholds.push_back(threshold);
+        }
+        else if(argument == "--threads") {
+            std::string threads;
+            if(!value(threads)) {
+                return false;
+            }
+            options.threads = static_cast<unsigned int>(std::strtoul(threads.c_str(), nullptr, 10));
+        }
+        else if(argument == "--matcher") {
+            std::string backend;
+            if(!value(backend)) {
+                return false;
+            }
+            if(!parseMatcherBackend(backend, options.backend)) {
+                err << "unknown matcher '" << backend << "'\n";
+                return false;
+            }
+        }
+        else if(argument == "--trace") {
+            if(!value(options.tracePath)) {
+                return false;
+            }
+#if !QUETZALCOATLUS_SCAN_METRICS
+            err << "--trace needs a build with QUETZALCOATLUS_SCAN_METRICS\n";
+            return false;
+#endif
+        }
+        else if(argument.size() > 1 && argument[0] == '-') {
+            err << "unknown option '" << argument << "'\n";
+            return false;
+        }
+        else {
+            options.files.emplace_back(argument);
+        }
+    }
+
+    if(options.files.empty() && !options.query) {
+        err << "no files to scan\n";
+        return false;
+    }
+    return true;
+}
+
+
+bool parseThreshold(const std::string& text, const RuleSet& rules, Threshold& threshold, std::ostream& err)
+{
+    const std::size_t equals = text.rfind('=');
+    if(equals == std::string::npos) {
+        err << "threshold '" << text << "' is not <rule>=<N> or <rule>.<field>=<N>\n";
+        return false;
+    }
+
+    const std::string limit = text.substr(equals + 1);
+    char* end = nullptr;
+    threshold.limit = std::strtod(limit.c_str(), &end);
+    if(limit.empty() || *end != '\0') {
+        err << "threshold '" << text << "' has no numeric limit\n";
+        return false;
+    }
+
+    const std::string name = text.substr(0, equals);
+    const std::size_t dot = name.find('.');
+    const std::string ruleName = name.substr(0, dot);
+
+    threshold.text = text;
+    threshold.rule = rules.size();
+    for(std::size_t rule = 0; rule < rules.size(); rule++) {
+        if(rules.rules()[rule].name == ruleName) {
+            threshold.rule = rule;
+        }
+    }
+    if(threshold.rule == rules.size()) {
+        err << "threshold '" << text << "': no rule '" << ruleName << "'\n";
+        return false;
+    }
+
+    if(dot != std::string::npos) {
+        const ScanRule& rule = rules.rules()[threshold.rule];
+        const std::string fieldName = name.substr(dot + 1);
+        threshold.isField = true;
+        threshold.field = rule.fields.size();
+        for(std::size_t field = 0; field < rule.fields.size(); field++) {
+            if(rule.fields[field] == fieldName) {
+                threshold.field = field;
+            }
+        }
+        if(threshold.field == rule.fields.size()) {
+            err << "threshold '" << text << "': rule '" << ruleName << "' has no field '" << fieldName << "'\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void writeJsonString(std::ostream& out, std::string_view text)
+{
+    out << '"';
+    for(char c : text) {
+        switch(c) {
+        case '"':  out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            if(static_cast<unsigned char>(c) < 0x20) {
+                static const char hex[] = "0123456789abcdef";
+                out << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+            }
+            else {
+                out << c;
+            }
+        }
+    }
+    out << '"';
+}
+
+
+// a field as a number: its typed value, or for a text field what it reads as if it is a
+// number. false if it is neither.
+bool numericField(const FieldValue& value, std::string_view text, double& number)
+{
+    const FieldValue parsed = (value.type == FieldType::Text) ? parseField(FieldType::Float, text) : value;
+    number = parsed.real;
+    return parsed.error == FieldError::None;
+}
+
+
+// a typed field as a JSON number (a duration in seconds), any other as a string.
+void writeJsonField(std::ostream& out, const FieldValue& value, std::string_view text)
+{
+    if(!value.isNumber()) {
+        writeJsonString(out, text);
+    }
+    else if(value.type == FieldType::Integer || value.type == FieldType::Hex) {
+        out << value.integer;
+    }
+    else {
+        char number[32];
+        std::snprintf(number, sizeof(number), "%.15g", value.real);
+        out << number;
+    }
+}
+
+
+// the current time, as the label of a run stored without --run.
+std::string timeLabel()
+{
+    const std::time_t now = std::time(nullptr);
+    char label[32] = {};
+    std::strftime(label, sizeof(label), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    return label;
+}
+
+
+// --query: aggregates of what earlier scans stored, no log is read.
+BatchScanStatus runQuery(const Options& options, std::ostream& out, std::ostream& err)
+{
+    MetricStore store;
+    std::string error;
+    if(!store.openReadOnly(options.storePath, error)) {
+        err << error << "\n";
+        return BatchScanStatus::ScanFailed;
+    }
+
+    MetricQuery query;
+    query.field = options.queryField;
+    query.allStages = !options.haveStage;
+    query.stage = options.stage;
+    query.groupBy = options.groupBy;
+    query.percentiles = queryPercentiles;
+    if(!options.runLabel.empty()) {
+        query.firstRun = store.findRun(options.runLabel);
+        if(query.firstRun == MetricStore::noRun) {
+            err << "no run '" << options.runLabel << "' in " << options.storePath << "\n";
+            return BatchScanStatus::UsageError;
+        }
+        query.lastRun = query.firstRun;
+    }
+    else if(!options.runWindow.empty()) {
+        const std::size_t colon = options.runWindow.find(':');
+        if(colon == std::string::npos) {
+            err << "run window '" << options.runWindow << "' is not <first>:<last>\n";
+            return BatchScanStatus::UsageError;
+        }
+        query.firstRun = static_cast<std::uint32_t>(std::strtoul(options.runWindow.c_str(), nullptr, 10));
+        query.lastRun = static_cast<std::uint32_t>(std::strtoul(options.runWindow.c_str() + colon + 1, nullptr, 10));
+    }
+    else if(options.lastRuns > 0) {
+        query.firstRun = store.runCount() - std::min(store.runCount(), static_cast<std::uint32_t>(options.lastRuns));
+    }
+
+    const std::vector<MetricAggregate> aggregates = store.aggregate(query);
+    // sums of many values need more than the default 6 digits.
+    const std::streamsize precision = out.precision(15);
+    const char* keyName = (query.groupBy == MetricQuery::GroupBy::Run) ? "run" : "stage";
+    auto writeKey = [&](const MetricAggregate& aggregate, bool json) {
+        if(query.groupBy == MetricQuery::GroupBy::Run) {
+            const std::string& label = store.runLabel(aggregate.key);
+            if(json) {
+                writeJsonString(out, label);
+            }
+            else {
+                out << (label.empty() ? std::to_string(aggregate.key) : label);
+            }
+        }
+        else {
+            out << aggregate.key;
+        }
+    };
+
+    if(options.format == OutputFormat::Json) {
+        out << "{\"field\":";
+        writeJsonString(out, query.field);
+        out << ",\"runs\":" << store.runCount() << ",\"rows\":" << store.rowCount() << ",\"groups\":[";
+        for(std::size_t index = 0; index < aggregates.size(); index++) {
+            const MetricAggregate& aggregate = aggregates[index];
+            out << (index == 0 ? "" : ",") << "\n{";
+            if(query.groupBy != MetricQuery::GroupBy::None) {
+                out << '"' << keyName << "\":";
+                writeKey(aggregate, true);
+                out << ',';
+            }
+            out << "\"count\":" << aggregate.count << ",\"min\":" << aggregate.min << ",\"max\":" << aggregate.max
+                << ",\"sum\":" << aggregate.sum << ",\"mean\":" << aggregate.mean();
+            for(std::size_t i = 0; i < queryPercentiles.size(); i++) {
+                out << ",\"p" << queryPercentiles[i] * 100 << "\":" << aggregate.percentiles[i];
+            }
+            out << '}';
+        }
+        out << "\n]}\n";
+    }
+    else {
+        for(const MetricAggregate& aggregate : aggregates) {
+            if(query.groupBy != MetricQuery::GroupBy::None) {
+                out << keyName << ' ';
+                writeKey(aggregate, false);
+                out << ": ";
+            }
+            out << "count=" << aggregate.count << " min=" << aggregate.min << " max=" << aggregate.max
+                << " mean=" << aggregate.mean();
+            for(std::size_t i = 0; i < queryPercentiles.size(); i++) {
+                out << " p" << queryPercentiles[i] * 100 << '=' << aggregate.percentiles[i];
+            }
+            out << '\n';
+        }
+    }
+    out.precision(precision);
+    out.flush();
+    return BatchScanStatus::Passed;
+}
+
+} // namespace
+
+
+bool isBatchScan(int argc, char* argv[])
+{
+    for(int i = 1; i < argc; i++) {
+        if(std::strcmp(argv[i], "--scan") == 0 || std::strcmp(argv[i], "--query") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+BatchScanStatus runBatchScan(int argc, char* argv[], std::ostream& out, std::ostream& err)
+{
+    Options options;
+    if(!parseOptions(argc, argv, options, err)) {
+        printUsage(err);
+        return BatchScanStatus::UsageError;
+    }
+
+    if(options.query) {
+        return runQuery(options, out, err);
+    }
+
+    RuleSet rules;
+    std::string error;
+    if(options.rulesPath.empty()) {
+        std::istringstream stream(defaultRules);
+        rules.parse(stream, error);
+    }
+    else if(!rules.load(options.rulesPath, error)) {
+        err << error << "\n";
+        return BatchScanStatus::UsageError;
+    }
+
+    std::vector<Threshold> thresholds(options.thresholds.size());
+    for(std::size_t i = 0; i < thresholds.size(); i++) {
+        if(!parseThreshold(options.thresholds[i], rules, thresholds[i], err)) {
+            return BatchScanStatus::UsageError;
+        }
+    }
+
+    std::unique_ptr<DirectoryScanner> scanner;
+    try {
+        scanner = std::make_unique<DirectoryScanner>(rules, options.backend);
+    }
+    catch(const std::regex_error& exception) {
+        err << "invalid rules: " << exception.what() << "\n";
+        return BatchScanStatus::UsageError;
+    }
+    scanner->setThreadCount(options.threads);
+
+    // --store: the numeric fields of the records, as one run for the whole batch. a rule named
+    // "stage" is not stored itself, it sets the stage of the records after it.
+    const bool storing = !options.storePath.empty();
+    MetricStore store;
+    if(storing && !store.open(options.storePath, error)) {
+        err << error << "\n";
+        return BatchScanStatus::ScanFailed;
+    }
+    std::size_t stageRule = rules.size();
+    std::vector<std::vector<std::string>> fieldNames(rules.size());
+    for(std::size_t rule = 0; rule < rules.size(); rule++) {
+        const ScanRule& definition = rules.rules()[rule];
+        if(definition.name == "stage" && !definition.fields.empty()) {
+            stageRule = rule;
+        }
+        for(const std::string& field : definition.fields) {
+            fieldNames[rule].push_back(definition.name + "." + field);
+        }
+    }
+    // the rows point into these until they are stored.
+    std::deque<std::string> storedPaths;
+    std::vector<MetricRow> storedRows;
+
+    if(!options.tracePath.empty()) {
+        ScanMetrics::startTracing();
+    }
+
+    const bool json = (options.format == OutputFormat::Json);
+    bool exceeded = false;
+    bool failed = false;
+    bool firstFile = true;
+
+    if(json) {
+        out << "{\"files\":[";
+    }
+
+    // files are written out as they complete, so in completion order.
+    scanner->scan(DirectoryScanner::expand(options.files),
+                  [&](const FileScanResult& result) {
+        const std::string& path = result.path;
+        std::vector<std::uint64_t> counts(rules.size(), 0);
+        // a file cut short would skew the trends, it is not stored.
+        const bool storeRun = storing && result.completed;
+        std::uint32_t stage = 0;
+        if(storeRun) {
+            storedPaths.push_back(path);
+        }
+        for(Threshold& threshold : thresholds) {
+            threshold.value = 0;
+            threshold.seen = false;
+        }
+
+        if(json) {
+            out << (firstFile ? "" : ",") << "\n{\"path\":";
+            writeJsonString(out, path);
+            out << ",\"matches\":[";
+        }
+        firstFile = false;
+
+        for(std::size_t index = 0; index < result.records.size(); index++) {
+            const RuleRecord& record = result.records[index];
+            const ScanRule& rule = rules.rules()[record.rule];
+            counts[record.rule]++;
+
+            double value = 0;
+            if(storeRun && record.rule == stageRule) {
+                if(numericField(result.value(record, 0), result.field(record, 0), value)) {
+                    stage = static_cast<std::uint32_t>(value);
+                }
+            }
+            else if(storeRun) {
+                for(std::size_t field = 0; field < rule.fields.size(); field++) {
+                    if(numericField(result.value(record, field), result.field(record, field), value)) {
+                        storedRows.push_back(MetricRow{storedPaths.back(), stage, fieldNames[record.rule][field],
+                                                       value, record.offset});
+                    }
+                }
+            }
+
+            for(Threshold& threshold : thresholds) {
+                if(threshold.rule == record.rule && threshold.isField &&
+                   numericField(result.value(record, threshold.field), result.field(record, threshold.field), value)) {
+                    if(!threshold.seen || value > threshold.value) {
+                        threshold.value = value;
+                        threshold.seen = true;
+                    }
+                }
+            }
+
+            if(json) {
+                out << (index == 0 ? "" : ",") << "\n{\"rule\":";
+                writeJsonString(out, rule.name);
+                out << ",\"line\":" << record.line << ",\"offset\":" << record.offset << ",\"fields\":{";
+                bool errors = false;
+                for(std::size_t field = 0; field < rule.fields.size(); field++) {
+                    out << (field == 0 ? "" : ",");
+                    writeJsonString(out, rule.fields[field]);
+                    out << ':';
+                    writeJsonField(out, result.value(record, field), result.field(record, field));
+                    errors = errors || result.value(record, field).error != FieldError::None;
+                }
+                out << '}';
+                if(errors) {
+                    // the fields that are not a value of their type, and why.
+                    out << ",\"errors\":{";
+                    bool firstError = true;
+                    for(std::size_t field = 0; field < rule.fields.size(); field++) {
+                        const FieldError fieldError = result.value(record, field).error;
+                        if(fieldError != FieldError::None) {
+                            out << (firstError ? "" : ",");
+                            writeJsonString(out, rule.fields[field]);
+                            out << ':';
+                            writeJsonString(out, fieldErrorName(fieldError));
+                            firstError = false;
+                        }
+                    }
+                    out << '}';
+                }
+                out << '}';
+            }
+            else {
+                out << path << ':' << record.line << ": " << rule.name;
+                for(std::size_t field = 0; field < rule.fields.size(); field++) {
+                    out << ' ' << rule.fields[field] << '=' << result.field(record, field);
+                    const FieldError fieldError = result.value(record, field).error;
+                    if(fieldError != FieldError::None) {
+                        out << " (" << fieldErrorName(fieldError) << ')';
+                    }
+                }
+                out << '\n';
+            }
+        }
+
+        if(!result.completed) {
+            failed = true;
+            err << path << ": cannot scan the file\n";
+        }
+        if(result.fieldErrors > 0) {
+            err << path << ": fields that are not a value of their type: " << result.fieldErrors << "\n";
+        }
+
+        for(Threshold& threshold : thresholds) {
+            if(!threshold.isField) {
+                threshold.value = static_cast<double>(counts[threshold.rule]);
+                threshold.seen = true;
+            }
+        }
+
+        if(json) {
+            out << "],\"complete\":" << (result.completed ? "true" : "false") << ",\"field_errors\":"
+                << result.fieldErrors << ",\"counts\":{";
+            for(std::size_t rule = 0; rule < rules.size(); rule++) {
+                out << (rule == 0 ? "" : ",");
+                writeJsonString(out, rules.rules()[rule].name);
+                out << ':' << counts[rule];
+            }
+            out << "},\"thresholds\":[";
+        }
+        else {
+            out << path << ':';
+            for(std::size_t rule = 0; rule < rules.size(); rule++) {
+                out << ' ' << rules.rules()[rule].name << '=' << counts[rule];
+            }
+            out << '\n';
+        }
+
+        for(std::size_t i = 0; i < thresholds.size(); i++) {
+            const Threshold& threshold = thresholds[i];
+            const bool over = threshold.seen && threshold.value > threshold.limit;
+            exceeded = exceeded || over;
+
+            if(json) {
+                out << (i == 0 ? "" : ",") << "{\"check\":";
+                writeJsonString(out, threshold.text);
+                out << ",\"value\":" << threshold.value << ",\"exceeded\":" << (over ? "true" : "false") << '}';
+            }
+            else if(over) {
+                out << path << ": threshold " << threshold.text << " exceeded: " << threshold.value << '\n';
+            }
+        }
+
+        if(json) {
+            out << "]}";
+        }
+        out.flush();
+        return true;
+    });
+
+    if(storing) {
+        std::uint32_t run = 0;
+        if(!store.appendRun(options.runLabel.empty() ? timeLabel() : options.runLabel, storedRows, run, error)) {
+            err << error << "\n";
+            failed = true;
+        }
+    }
+
+    BatchScanStatus status = BatchScanStatus::Passed;
+    if(failed) {
+        status = BatchScanStatus::ScanFailed;
+    }
+    else if(exceeded) {
+        status = BatchScanStatus::ThresholdExceeded;
+    }
+
+    if(json) {
+        out << "\n],\"status\":" << static_cast<int>(status) << "}\n";
+    }
+    out.flush();
+
+    if(!options.tracePath.empty()) {
+        ScanMetrics::stopTracing();
+        if(!ScanMetrics::writeTrace(options.tracePath)) {
+            err << options.tracePath << ": cannot write the trace\n";
+        }
+    }
+    return status;
+}
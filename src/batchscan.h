@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef BATCHSCAN_H
+#define BATCHSCAN_H
+
+#include <iostream>
+
+
+// headless batch mode, for CI and scripts:
+//
+//   quetzalcoatlus --scan <files...> [--rules <file>] [--format text|json]
+//                  [--max <rule>=<N>] [--max <rule>.<field>=<N>] [--threads <N>]
+//                  [--trace <file>] [--store <directory> [--run <label>]]
+//   quetzalcoatlus --query <directory> [--field <rule>.<field>]
+//                  [--run <label> | --runs <first>:<last> | --last <N>] [--stage <N>]
+//                  [--by stage|run|all] [--format text|json]
+//
+// the files, directories (recursively) and globs (e.g. "logs/**/*.log") are scanned on all cores
+// with the rules (by default: stage headers and "errors : N"), and the matches of each file are
+// written to 'out' as soon as it is done, so in completion order. '--max rule=N' fails a file in
+// which the rule matches more than N times, '--max rule.field=N' fails a file in which the field
+// is ever above N. '--trace file' writes where the scan time went as Chrome trace-event JSON
+// (see src/scanmetrics.h).
+//
+// '--store dir' appends the numeric fields of the matches to the metric store in 'dir' (see
+// src/metricstore.h), as one run labelled '--run' (by default: the time), and '--query dir'
+// reads no log at all, it aggregates the stored values per stage, per run or over all, in a
+// window of runs.
+//
+// it needs neither Qt nor a display: no QApplication, no resources, no widgets.
+enum class BatchScanStatus
+{
+    Passed = 0,
+    ThresholdExceeded = 1,
+    UsageError = 2,         // bad arguments, or a bad rule file
+    ScanFailed = 3,         // a file could not be read
+};
+
+
+// true if the command line asks for the batch mode.
+bool isBatchScan(int argc, char* argv[]);
+
+// returns the exit status of the process.
+BatchScanStatus runBatchScan(int argc, char* argv[], std::ostream& out = std::cout, std::ostream& err = std::cerr);
+
+#endif // #ifndef BATCHSCAN_H
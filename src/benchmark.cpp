@@ -0,0 +1,546 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+// quetzalcoatlus_bench: measures the scan path (StageSeriesExtractor, as used by the GUI) on
+// synthetic logs of given sizes, or on existing logs, and writes the results as JSON to stdout.
+
+#include "builtinpatterns.h"
+#include "loggenerator.h"
+#include "logscanner.h"
+#include "mappedfile.h"
+#include "scanmetrics.h"
+#include "stageseries.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif // #ifdef _WIN32
+
+
+namespace
+{
+
+// the GUI's, which matches exactly the value lines of the generated logs.
+constexpr const char* defaultPattern = BuiltinPatterns::errors;
+
+
+struct Options
+{
+    std::vector<std::uint64_t> sizes;
+    std::vector<std::string> files;     // existing logs, instead of generated ones
+    LogGeneratorOptions generator;
+    std::string pattern = defaultPattern;
+    LogScanner::ScanMode mode = LogScanner::ScanMode::Auto;
+    MatcherBackend backend = MatcherBackend::Builtin;
+    unsigned int threads = 0;
+    unsigned int repeat = 3;
+    std::string directory;
+    bool keep = false;
+    std::string tracePath;
+};
+
+
+// one benchmark case: a log, generated or given.
+struct Case
+{
+    std::string path;
+    bool generated = false;
+    LogGeneratorStats expected;
+    double generateSeconds = 0;
+};
+
+
+struct Measurement
+{
+    double seconds = 0;
+    double userSeconds = 0;
+    double systemSeconds = 0;
+    std::uint64_t matches = 0;
+    std::uint64_t peakRss = 0;
+    bool completed = false;
+#if QUETZALCOATLUS_SCAN_METRICS
+    ScanMetrics::Snapshot metrics;      // added during the scan
+#endif
+};
+
+
+void printUsage(std::ostream& stream)
+{
+    stream << "usage: quetzalcoatlus_bench [--size <N>[K|M|G]]... [--file <log>]... [--density <fraction>]\n"
+              "                            [--line-length <N>] [--stage-lines <N>] [--seed <N>]\n"
+              "                            [--pattern <regex>] [--mode auto|mapped|streamed] [--threads <N>]\n"
+              "                            [--matcher builtin|automaton|regex|qregularexpression] [--repeat <N>]\n"
+              "                            [--dir <directory>] [--keep] [--trace <file>]\n"
+              "\n"
+              "generates a log of each size (default: 1M 16M 256M) in --dir (default: the temp directory),\n"
+              "scans it --repeat times and writes the results to stdout as JSON. generated logs are\n"
+              "deleted afterwards unless --keep is given, and kept ones are reused by later runs.\n"
+              "--matcher automaton runs the built-in patterns on the runtime engine, to compare it with\n"
+              "the code generated for them (builtin, the default).\n"
+              "--trace writes the spans of all the scans as Chrome trace-event JSON.\n";
+}
+
+
+// "64K", "16M", "2G" or plain bytes, 0 if it is not a size.
+std::uint64_t parseSize(const std::string& text)
+{
+    char* end = nullptr;
+    const double value = std::strtod(text.c_str(), &end);
+    std::uint64_t unit = 1;
+    if(*end == 'K' || *end == 'k') {
+        unit = 1024;
+        end++;
+    }
+    else if(*end == 'M' || *end == 'm') {
+        unit = 1024 * 1024;
+        end++;
+    }
+    else if(*end == 'G' || *end == 'g') {
+        unit = 1024 * 1024 * 1024;
+        end++;
+    }
+    if(text.empty() || *end != '\0' || value <= 0) {
+        return 0;
+    }
+    return static_cast<std::uint64_t>(value * static_cast<double>(unit));
+}
+
+
+bool parseOptions(int argc, char* argv[], Options& options, std::ostream& err)
+{
+    for(int i = 1; i < argc; i++) {
+        const std::string_view argument(argv[i]);
+
+        std::string text;
+        auto value = [&]() {
+            if(i + 1 >= argc) {
+                err << "missing value for " << argument << "\n";
+                return false;
+            }
+            text = argv[++i];
+            return true;
+        };
+
+        if(argument == "--keep") {
+            options.keep = true;
+        }
+        else if(argument == "--help" || argument == "-h") {
+            return false;
+        }
+        else if(argument.size() > 1 && argument[0] == '-' && !value()) {
+            return false;
+        }
+        else if(argument == "--size") {
+            const std::uint64_t size = parseSize(text);
+            if(size == 0) {
+                err << "invalid size '" << text << "'\n";
+                return false;
+            }
+            options.sizes.push_back(size);
+        }
+        else if(argument == "--file") {
+            options.files.push_back(text);
+        }
+        else if(argument == "--density") {
+            options.generator.density = std::strtod(text.c_str(), nullptr);
+        }
+        else if(argument == "--line-length") {
+            options.generator.lineLength = std::max<std::size_t>(std::strtoul(text.c_str(), nullptr, 10), 1);
+        }
+        else if(argument == "--stage-lines") {
+            options.generator.stageLines = std::max<std::size_t>(std::strtoul(text.c_str(), nullptr, 10), 1);
+        }
+        else if(argument == "--seed") {
+            options.generator.seed = std::strtoull(text.c_str(), nullptr, 10);
+        }
+        else if(argument == "--pattern") {
+            options.pattern = text;
+        }
+        else if(argument == "--mode") {
+            if(text == "auto") {
+                options.mode = LogScanner::ScanMode::Auto;
+            }
+            else if(text == "mapped") {
+                options.mode = LogScanner::ScanMode::Mapped;
+            }
+            else if(text == "streamed") {
+                options.mode = LogScanner::ScanMode::Streamed;
+            }
+            else {
+                err << "unknown mode '" << text << "'\n";
+                return false;
+            }
+        }
+        else if(argument == "--matcher") {
+            if(!parseMatcherBackend(text, options.backend)) {
+                err << "unknown matcher '" << text << "'\n";
+                return false;
+            }
+        }
+        else if(argument == "--threads") {
+            options.threads = static_cast<unsigned int>(std::strtoul(text.c_str(), nullptr, 10));
+        }
+        else if(argument == "--repeat") {
+            options.repeat = std::max(static_cast<unsigned int>(std::strtoul(text.c_str(), nullptr, 10)), 1u);
+        }
+        else if(argument == "--dir") {
+            options.directory = text;
+        }
+        else if(argument == "--trace") {
+#if !QUETZALCOATLUS_SCAN_METRICS
+            err << "--trace needs a build with QUETZALCOATLUS_SCAN_METRICS\n";
+            return false;
+#endif
+            options.tracePath = text;
+        }
+        else {
+            err << "unknown argument '" << argument << "'\n";
+            return false;
+        }
+    }
+
+    if(options.sizes.empty() && options.files.empty()) {
+        options.sizes = {1024 * 1024, 16 * 1024 * 1024, 256 * 1024 * 1024};
+    }
+    return true;
+}
+
+
+double toSeconds(std::chrono::steady_clock::duration duration)
+{
+    return std::chrono::duration<double>(duration).count();
+}
+
+
+// user and system CPU time of the process so far.
+void processTimes(double& user, double& system)
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, userTime;
+    GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &userTime);
+    auto seconds = [](const FILETIME& time) {
+        const ULARGE_INTEGER value{{time.dwLowDateTime, time.dwHighDateTime}};
+        return static_cast<double>(value.QuadPart) * 1e-7;
+    };
+    user = seconds(userTime);
+    system = seconds(kernel);
+#else
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    user = static_cast<double>(usage.ru_utime.tv_sec) + static_cast<double>(usage.ru_utime.tv_usec) * 1e-6;
+    system = static_cast<double>(usage.ru_stime.tv_sec) + static_cast<double>(usage.ru_stime.tv_usec) * 1e-6;
+#endif // #ifdef _WIN32
+}
+
+
+// start a new peak RSS measurement, where the platform can (linux). elsewhere the peak is that of
+// the whole process so far, so the cases are best run from small to large.
+void resetPeakRss()
+{
+#ifdef __linux__
+    std::ofstream clearRefs("/proc/self/clear_refs");
+    clearRefs << "5";
+#endif // #ifdef __linux__
+}
+
+
+std::uint64_t peakRss()
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+#ifdef __linux__
+    // VmHWM is the one clear_refs resets, ru_maxrss is not.
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while(std::getline(status, line)) {
+        if(line.compare(0, 6, "VmHWM:") == 0) {
+            return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+        }
+    }
+#endif // #ifdef __linux__
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif // #ifdef __APPLE__
+#endif // #ifdef _WIN32
+}
+
+
+// reads the log the way the scan does, without matching anything: the I/O part of a scan.
+double readSeconds(const std::string& path, LogScanner::ScanMode mode)
+{
+    const auto start = std::chrono::steady_clock::now();
+    volatile std::uint64_t sum = 0;
+
+    MappedFile file;
+    if(mode != LogScanner::ScanMode::Streamed && file.open(path)) {
+        const std::string_view data = file.view();
+        std::uint64_t pageSum = 0;
+        for(std::size_t offset = 0; offset < data.size(); offset += 4096) {
+            pageSum += static_cast<unsigned char>(data[offset]);
+        }
+        sum = pageSum;
+    }
+    else {
+        std::ifstream stream(path, std::ios::binary);
+        std::vector<char> buffer(LogScanner::defaultChunkSize);
+        while(stream.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || stream.gcount() > 0) {
+            sum = sum + static_cast<unsigned char>(buffer[0]);
+        }
+    }
+    return toSeconds(std::chrono::steady_clock::now() - start);
+}
+
+
+Measurement measureScan(StageSeriesExtractor& extractor, const std::string& path)
+{
+    Measurement measurement;
+    std::vector<StageRecord> records;
+
+    resetPeakRss();
+    double userBefore = 0;
+    double systemBefore = 0;
+    processTimes(userBefore, systemBefore);
+#if QUETZALCOATLUS_SCAN_METRICS
+    const ScanMetrics::Snapshot metricsBefore = ScanMetrics::snapshot();
+#endif
+    const auto start = std::chrono::steady_clock::now();
+
+    measurement.completed = extractor.extract(path, records);
+
+    measurement.seconds = toSeconds(std::chrono::steady_clock::now() - start);
+    double userAfter = 0;
+    double systemAfter = 0;
+    processTimes(userAfter, systemAfter);
+    measurement.userSeconds = userAfter - userBefore;
+    measurement.systemSeconds = systemAfter - systemBefore;
+    measurement.matches = records.size();
+    measurement.peakRss = peakRss();
+#if QUETZALCOATLUS_SCAN_METRICS
+    const ScanMetrics::Snapshot metricsAfter = ScanMetrics::snapshot();
+    for(int counter = 0; counter < ScanMetrics::CounterCount; counter++) {
+        measurement.metrics.values[counter] = metricsAfter.values[counter] - metricsBefore.values[counter];
+    }
+#endif
+    return measurement;
+}
+
+
+void writeJsonString(std::ostream& out, std::string_view text)
+{
+    out << '"';
+    for(char c : text) {
+        if(c == '"' || c == '\\') {
+            out << '\\' << c;
+        }
+        else if(static_cast<unsigned char>(c) < 0x20) {
+            static const char hex[] = "0123456789abcdef";
+            out << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+        }
+        else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+
+void writeMeasurement(std::ostream& out, const Measurement& measurement, std::uint64_t bytes)
+{
+    const double megabytes = static_cast<double>(bytes) / (1024.0 * 1024.0);
+    const double seconds = std::max(measurement.seconds, 1e-9);
+    out << "{\"seconds\":" << measurement.seconds
+        << ",\"user_seconds\":" << measurement.userSeconds
+        << ",\"system_seconds\":" << measurement.systemSeconds
+        << ",\"cpu_utilization\":" << (measurement.userSeconds + measurement.systemSeconds) / seconds
+        << ",\"mb_per_s\":" << megabytes / seconds
+        << ",\"matches\":" << measurement.matches
+        << ",\"matches_per_s\":" << static_cast<double>(measurement.matches) / seconds
+        << ",\"peak_rss_bytes\":" << measurement.peakRss;
+#if QUETZALCOATLUS_SCAN_METRICS
+    out << ",\"metrics\":{";
+    for(int counter = 0; counter < ScanMetrics::CounterCount; counter++) {
+        out << (counter == 0 ? "" : ",") << '"' << ScanMetrics::counterName(static_cast<ScanMetrics::Counter>(counter))
+            << "\":" << measurement.metrics.values[counter];
+    }
+    out << "}";
+#endif
+    out << ",\"completed\":" << (measurement.completed ? "true" : "false") << "}";
+}
+
+
+const char* modeName(LogScanner::ScanMode mode)
+{
+    switch(mode) {
+    case LogScanner::ScanMode::Auto:
+        return "auto";
+    case LogScanner::ScanMode::Mapped:
+        return "mapped";
+    case LogScanner::ScanMode::Streamed:
+        return "streamed";
+    }
+    return "";
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[])
+{
+    std::ios::sync_with_stdio(false);
+
+    Options options;
+    if(!parseOptions(argc, argv, options, std::cerr)) {
+        printUsage(std::cerr);
+        return 2;
+    }
+
+    std::unique_ptr<StageSeriesExtractor> extractor;
+    try {
+        extractor = std::make_unique<StageSeriesExtractor>(options.pattern, StageSeriesExtractor::defaultStagePattern,
+                                                           options.backend);
+    }
+    catch(const std::regex_error& exception) {
+        std::cerr << "invalid pattern: " << exception.what() << "\n";
+        return 2;
+    }
+    extractor->scanner().setScanMode(options.mode);
+    extractor->scanner().setThreadCount(options.threads);
+
+    namespace fs = std::filesystem;
+    const fs::path directory = options.directory.empty() ? fs::temp_directory_path() : fs::path(options.directory);
+
+    std::vector<Case> cases;
+    for(const std::string& file : options.files) {
+        Case benchCase;
+        benchCase.path = file;
+        cases.push_back(benchCase);
+    }
+    for(std::uint64_t size : options.sizes) {
+        LogGeneratorOptions generator = options.generator;
+        generator.size = size;
+
+        // the name holds everything the content depends on, so a kept log can be reused.
+        char name[160];
+        std::snprintf(name, sizeof(name), "quetzalcoatlus_bench_%llu_%g_%zu_%zu_%llu.log",
+                      static_cast<unsigned long long>(size), generator.density, generator.lineLength,
+                      generator.stageLines, static_cast<unsigned long long>(generator.seed));
+
+        Case benchCase;
+        benchCase.path = (directory / name).string();
+        benchCase.generated = true;
+
+        const auto start = std::chrono::steady_clock::now();
+        std::error_code error;
+        if(options.keep && fs::exists(benchCase.path, error)) {
+            // only the counts are needed, so count into a stream that discards everything.
+            std::ostream discard(nullptr);
+            generateLog(discard, generator, benchCase.expected);
+        }
+        else if(!generateLog(benchCase.path, generator, benchCase.expected)) {
+            std::cerr << "cannot write '" << benchCase.path << "'\n";
+            return 3;
+        }
+        benchCase.generateSeconds = toSeconds(std::chrono::steady_clock::now() - start);
+        cases.push_back(benchCase);
+    }
+
+    std::ostream& out = std::cout;
+    out << "{\"pattern\":";
+    writeJsonString(out, options.pattern);
+    out << ",\"mode\":\"" << modeName(options.mode) << "\",\"matcher\":\"" << matcherBackendName(options.backend)
+        << "\",\"engine\":\"" << extractor->scanner().patternMatcher().name() << "\",\"threads\":" << options.threads
+        << ",\"repeat\":" << options.repeat << ",\"cases\":[";
+
+    if(!options.tracePath.empty()) {
+        ScanMetrics::startTracing();
+    }
+
+    bool allCompleted = true;
+    for(std::size_t index = 0; index < cases.size(); index++) {
+        const Case& benchCase = cases[index];
+        std::error_code error;
+        const std::uint64_t bytes = static_cast<std::uint64_t>(fs::file_size(benchCase.path, error));
+
+        out << (index == 0 ? "" : ",") << "\n{\"path\":";
+        writeJsonString(out, benchCase.path);
+        out << ",\"bytes\":" << (error ? 0 : bytes);
+        if(benchCase.generated) {
+            out << ",\"generated\":{\"lines\":" << benchCase.expected.lines
+                << ",\"stages\":" << benchCase.expected.stages
+                << ",\"values\":" << benchCase.expected.values
+                << ",\"density\":" << options.generator.density
+                << ",\"line_length\":" << options.generator.lineLength
+                << ",\"seed\":" << options.generator.seed
+                << ",\"seconds\":" << benchCase.generateSeconds << "}";
+        }
+
+        // I/O alone first, which also leaves the log in the page cache for all the scans alike.
+        const double ioSeconds = readSeconds(benchCase.path, options.mode);
+        out << ",\"read\":{\"seconds\":" << ioSeconds
+            << ",\"mb_per_s\":" << static_cast<double>(bytes) / (1024.0 * 1024.0) / std::max(ioSeconds, 1e-9) << "}";
+
+        Measurement best;
+        out << ",\"runs\":[";
+        for(unsigned int run = 0; run < options.repeat; run++) {
+            const Measurement measurement = measureScan(*extractor, benchCase.path);
+            allCompleted = allCompleted && measurement.completed;
+            if(run == 0 || measurement.seconds < best.seconds) {
+                best = measurement;
+            }
+            out << (run == 0 ? "" : ",");
+            writeMeasurement(out, measurement, bytes);
+        }
+        out << "],\"best\":";
+        writeMeasurement(out, best, bytes);
+        // the share of the fastest scan that reading the log alone takes.
+        out << ",\"io_fraction\":" << std::min(ioSeconds / std::max(best.seconds, 1e-9), 1.0);
+        if(benchCase.generated && options.pattern == defaultPattern) {
+            const bool verified = best.completed && best.matches == benchCase.expected.values;
+            allCompleted = allCompleted && verified;
+            out << ",\"verified\":" << (verified ? "true" : "false");
+        }
+        out << "}";
+        out.flush();
+
+        if(benchCase.generated && !options.keep) {
+            fs::remove(benchCase.path, error);
+        }
+    }
+    out << "\n]}\n";
+
+    if(!options.tracePath.empty()) {
+        ScanMetrics::stopTracing();
+        if(!ScanMetrics::writeTrace(options.tracePath)) {
+            std::cerr << "cannot write '" << options.tracePath << "'\n";
+            return 3;
+        }
+    }
+
+    return allCompleted ? 0 : 1;
+}
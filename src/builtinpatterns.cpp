@@ -0,0 +1,323 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "builtinpatterns.h"
+#include "staticpattern.h"
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include <vector>
+
+
+namespace
+{
+
+using namespace staticpattern;
+
+// \d+(?:\.\d+)?
+using Decimal = Sequence<Plus<Digit>, Optional<Sequence<Literal<'.'>, Plus<Digit>>>>;
+
+// stage\s+(\d+)\s*:
+using StagePattern = Sequence<Literal<'s', 't', 'a', 'g', 'e'>, Plus<Space>, Capture<1, Plus<Digit>>, Star<Space>,
+                              Literal<':'>>;
+
+// errors\s*:\s*(\d+)
+using ErrorsPattern = Sequence<Literal<'e', 'r', 'r', 'o', 'r', 's'>, Star<Space>, Literal<':'>, Star<Space>,
+                               Capture<1, Plus<Digit>>>;
+
+// warnings\s*:\s*(\d+)
+using WarningsPattern = Sequence<Literal<'w', 'a', 'r', 'n', 'i', 'n', 'g', 's'>, Star<Space>, Literal<':'>, Star<Space>,
+                                 Capture<1, Plus<Digit>>>;
+
+// (\w+) took (\d+(?:\.\d+)?\s*(?:ms|s))\b
+using TimingPattern = Sequence<Capture<1, Plus<Word>>, Literal<' ', 't', 'o', 'o', 'k', ' '>,
+                               Capture<2, Sequence<Decimal, Star<Space>, Alternation<Literal<'m', 's'>, Literal<'s'>>>>,
+                               WordBoundary>;
+
+// peak memory\s*:\s*(\d+)\s*MB
+using MemoryPattern = Sequence<Literal<'p', 'e', 'a', 'k', ' ', 'm', 'e', 'm', 'o', 'r', 'y'>, Star<Space>, Literal<':'>,
+                               Star<Space>, Capture<1, Plus<Digit>>, Star<Space>, Literal<'M', 'B'>>;
+
+// cpu usage\s*:\s*(\d+(?:\.\d+)?)\s*%
+using CpuPattern = Sequence<Literal<'c', 'p', 'u', ' ', 'u', 's', 'a', 'g', 'e'>, Star<Space>, Literal<':'>, Star<Space>,
+                            Capture<1, Decimal>, Star<Space>, Literal<'%'>>;
+
+
+struct Builtin
+{
+    const char* pattern;
+    std::unique_ptr<Matcher> (*create)();
+    bool (*canStart)(unsigned char c);
+    const char* (*resume)(const char* at, const char* end);
+    bool nullable;
+};
+
+template<typename Pattern, std::size_t Captures>
+constexpr Builtin builtin(const char* pattern)
+{
+    return Builtin{pattern,
+                   []() -> std::unique_ptr<Matcher> { return std::make_unique<StaticMatcher<Pattern, Captures>>(); },
+                   &Pattern::canStart,
+                   &resumeAfterFailure<Pattern>,
+                   Pattern::nullable};
+}
+
+// the string has to be exactly the one the type spells, the automaton is the reference.
+const Builtin builtins[] = {
+    builtin<StagePattern, 1>(BuiltinPatterns::stage),
+    builtin<ErrorsPattern, 1>(BuiltinPatterns::errors),
+    builtin<WarningsPattern, 1>(BuiltinPatterns::warnings),
+    builtin<TimingPattern, 2>(BuiltinPatterns::timing),
+    builtin<MemoryPattern, 1>(BuiltinPatterns::memory),
+    builtin<CpuPattern, 1>(BuiltinPatterns::cpu),
+};
+
+
+const Builtin* findBuiltin(std::string_view pattern)
+{
+    for(const Builtin& entry : builtins) {
+        if(pattern == entry.pattern) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+
+// index just past the group that opens at 'open', npos if it is not closed.
+std::size_t skipGroup(std::string_view pattern, std::size_t open)
+{
+    int depth = 0;
+    bool inClass = false;
+    for(std::size_t at = open; at < pattern.size(); at++) {
+        const char c = pattern[at];
+        if(c == '\\') {
+            at++;
+        }
+        else if(inClass) {
+            inClass = (c != ']');
+        }
+        else if(c == '[') {
+            inClass = true;
+        }
+        else if(c == '(') {
+            depth++;
+        }
+        else if(c == ')' && --depth == 0) {
+            return at + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+
+// the top level alternatives of the pattern, empty if its parentheses or brackets do not match.
+std::vector<std::string_view> splitAlternatives(std::string_view pattern)
+{
+    std::vector<std::string_view> alternatives;
+    std::size_t start = 0;
+    int depth = 0;
+    bool inClass = false;
+    for(std::size_t at = 0; at < pattern.size(); at++) {
+        const char c = pattern[at];
+        if(c == '\\') {
+            at++;
+        }
+        else if(inClass) {
+            inClass = (c != ']');
+        }
+        else if(c == '[') {
+            inClass = true;
+        }
+        else if(c == '(') {
+            depth++;
+        }
+        else if(c == ')') {
+            if(--depth < 0) {
+                return std::vector<std::string_view>();
+            }
+        }
+        else if(c == '|' && depth == 0) {
+            alternatives.push_back(pattern.substr(start, at - start));
+            start = at + 1;
+        }
+    }
+    if(depth != 0 || inClass) {
+        return std::vector<std::string_view>();
+    }
+    alternatives.push_back(pattern.substr(start));
+    return alternatives;
+}
+
+
+// alternatives of built-in patterns, as RuleScanner and StageSeriesExtractor combine them, each
+// either in a capturing group of its own, in a non-capturing one, or as it is. every alternative
+// is tried in order at a position, so the leftmost match of the first alternative wins, as with
+// the automaton running the whole alternation.
+class BuiltinAlternation : public Matcher
+{
+public:
+    struct Alternative
+    {
+        std::unique_ptr<Matcher> matcher;
+        std::size_t firstGroup;     // of the alternative in the whole pattern
+        bool captured;              // whether the alternative is a group itself, at firstGroup
+        const char* (*resume)(const char* at, const char* end);
+    };
+
+    explicit BuiltinAlternation(std::vector<Alternative> list, const std::vector<const Builtin*>& entries)
+        : alternatives(std::move(list))
+    {
+        starts.fill(false);
+        for(const Builtin* entry : entries) {
+            for(int c = 0; c < 256; c++) {
+                starts[static_cast<std::size_t>(c)] = starts[static_cast<std::size_t>(c)] ||
+                                                      entry->canStart(static_cast<unsigned char>(c));
+            }
+            nullable = nullable || entry->nullable;
+        }
+        for(const Alternative& alternative : alternatives) {
+            captures = std::max(captures, alternative.firstGroup - 1 + (alternative.captured ? 1 : 0) +
+                                          alternative.matcher->captureCount());
+        }
+    }
+
+    bool search(const char* begin, const char* end, const char* from, MatchResult& result) const override
+    {
+        // where each alternative may match again, as in StaticMatcher::search().
+        AlternationScratch& scratch = scratchOf(result);
+        scratch.resumeAt.assign(alternatives.size(), from);
+
+        const char* partial = nullptr;
+        bool found = false;
+        for(const char* at = from; at <= end && !found; at++) {
+            if(!nullable) {
+                while(at < end && !starts[static_cast<unsigned char>(*at)]) {
+                    at++;
+                }
+                if(at == end) {
+                    break;
+                }
+            }
+            found = matchAlternatives(begin, end, at, result, scratch, true);
+            partial = (partial != nullptr) ? partial : result.partialBegin;
+        }
+        result.partialBegin = partial;
+        return found;
+    }
+
+    bool matchAt(const char* begin, const char* end, const char* at, MatchResult& result) const override
+    {
+        return matchAlternatives(begin, end, at, result, scratchOf(result), false);
+    }
+
+    std::size_t captureCount() const override { return captures; }
+    const char* name() const override { return "static"; }
+
+private:
+    class AlternationScratch : public MatchScratch
+    {
+    public:
+        MatchResult match;
+        std::vector<const char*> resumeAt;      // by alternative
+
+        void subjectChanged() override { match.subjectChanged(); }
+    };
+
+    static AlternationScratch& scratchOf(MatchResult& result)
+    {
+        AlternationScratch* scratch = dynamic_cast<AlternationScratch*>(result.scratch.get());
+        if(scratch == nullptr) {
+            result.scratch = std::make_unique<AlternationScratch>();
+            scratch = static_cast<AlternationScratch*>(result.scratch.get());
+        }
+        return *scratch;
+    }
+
+    // with 'resume', an alternative is not tried before scratch.resumeAt, and one that fails
+    // moves it on.
+    bool matchAlternatives(const char* begin, const char* end, const char* at, MatchResult& result,
+                           AlternationScratch& scratch, bool resume) const
+    {
+        result.partialBegin = nullptr;
+        if(!nullable && (at == end || !starts[static_cast<unsigned char>(*at)])) {
+            return false;
+        }
+
+        MatchResult& match = scratch.match;
+        for(std::size_t index = 0; index < alternatives.size(); index++) {
+            const Alternative& alternative = alternatives[index];
+            if(resume && at < scratch.resumeAt[index]) {
+                continue;
+            }
+            // an alternative tried first takes precedence, even one that ran into the end.
+            const bool matched = alternative.matcher->matchAt(begin, end, at, match);
+            if(match.partialBegin != nullptr) {
+                result.partialBegin = at;
+            }
+            if(!matched) {
+                if(resume) {
+                    scratch.resumeAt[index] = alternative.resume(at, end);
+                }
+                continue;
+            }
+            result.groups.assign(2 * (captures + 1), nullptr);
+            result.groups[0] = match.groups[0];
+            result.groups[1] = match.groups[1];
+            std::size_t group = alternative.firstGroup;
+            if(alternative.captured) {
+                result.groups[2 * group] = match.groups[0];
+                result.groups[2 * group + 1] = match.groups[1];
+                group++;
+            }
+            std::copy(match.groups.begin() + 2, match.groups.end(), result.groups.begin() + 2 * group);
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<Alternative> alternatives;
+    std::array<bool, 256> starts;
+    bool nullable = false;
+    std::size_t captures = 0;
+};
+
+} // namespace
+
+
+std::unique_ptr<Matcher> createBuiltinMatcher(const std::string& pattern)
+{
+    if(const Builtin* entry = findBuiltin(pattern)) {
+        return entry->create();
+    }
+
+    const std::vector<std::string_view> parts = splitAlternatives(pattern);
+    std::vector<BuiltinAlternation::Alternative> alternatives;
+    std::vector<const Builtin*> entries;
+    std::size_t group = 1;
+    for(std::string_view part : parts) {
+        // "(a)" or "(?:a)" around the whole alternative.
+        bool captured = false;
+        if(!part.empty() && part.front() == '(' && skipGroup(part, 0) == part.size()) {
+            if(part.substr(0, 3) == "(?:") {
+                part = part.substr(3, part.size() - 4);
+            }
+            else if(part.size() > 1 && part[1] != '?') {
+                part = part.substr(1, part.size() - 2);
+                captured = true;
+            }
+        }
+
+        const Builtin* entry = findBuiltin(part);
+        if(entry == nullptr) {
+            return nullptr;
+        }
+        alternatives.push_back(BuiltinAlternation::Alternative{entry->create(), group, captured, entry->resume});
+        entries.push_back(entry);
+        group += (captured ? 1 : 0) + alternatives.back().matcher->captureCount();
+    }
+    if(alternatives.empty()) {
+        return nullptr;
+    }
+    return std::make_unique<BuiltinAlternation>(std::move(alternatives), entries);
+}
@@ -0,0 +1,31 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef BUILTINPATTERNS_H
+#define BUILTINPATTERNS_H
+
+#include "matcher.h"
+
+#include <memory>
+#include <string>
+
+
+// the patterns that ship with the tool: the GUI's, the batch scan's default rules and those of
+// resources/scan_rules.txt. they are known when the tool is compiled, so each is matched by code
+// generated for it (see staticpattern.h), and the automaton only ever runs user patterns.
+struct BuiltinPatterns
+{
+    static constexpr const char* stage = "stage\\s+(\\d+)\\s*:";
+    static constexpr const char* errors = "errors\\s*:\\s*(\\d+)";
+    static constexpr const char* warnings = "warnings\\s*:\\s*(\\d+)";
+    static constexpr const char* timing = "(\\w+) took (\\d+(?:\\.\\d+)?\\s*(?:ms|s))\\b";
+    static constexpr const char* memory = "peak memory\\s*:\\s*(\\d+)\\s*MB";
+    static constexpr const char* cpu = "cpu usage\\s*:\\s*(\\d+(?:\\.\\d+)?)\\s*%";
+};
+
+
+// the compiled-in matcher for a built-in pattern, or for an alternation of built-in patterns as
+// RuleScanner and StageSeriesExtractor combine them ("(a)|(b)", "(?:a)|(?:b)").
+// nullptr for any other pattern, which is left to the runtime engines.
+std::unique_ptr<Matcher> createBuiltinMatcher(const std::string& pattern);
+
+#endif // #ifndef BUILTINPATTERNS_H
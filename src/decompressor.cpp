@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "decompressor.h"
+#include "quetzalcoatlus_config.h"
+#include "scanmetrics.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if QUETZALCOATLUS_USE_ZLIB
+#include <zlib.h>
+#endif // #if QUETZALCOATLUS_USE_ZLIB
+
+#if QUETZALCOATLUS_USE_ZSTD
+#include <zstd.h>
+#endif // #if QUETZALCOATLUS_USE_ZSTD
+
+
+// compressed input is read in blocks of this size.
+static constexpr std::size_t inputBlockSize = 256 * 1024;
+
+
+Compression detectCompression(const std::string& filepath)
+{
+    unsigned char magic[4] = {0, 0, 0, 0};
+    std::FILE* file = std::fopen(filepath.c_str(), "rb");
+    if(file == nullptr) {
+        return Compression::None;
+    }
+    const std::size_t size = std::fread(magic, 1, sizeof(magic), file);
+    std::fclose(file);
+
+    if(size >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) {
+        return Compression::Gzip;
+    }
+    if(size >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) {
+        return Compression::Zstd;
+    }
+    return Compression::None;
+}
+
+
+bool compressionSupported(Compression compression)
+{
+    switch(compression) {
+    case Compression::None:
+        return true;
+    case Compression::Gzip:
+        return QUETZALCOATLUS_USE_ZLIB;
+    case Compression::Zstd:
+        return QUETZALCOATLUS_USE_ZSTD;
+    }
+    return false;
+}
+
+
+DecompressingStreamBuf::DecompressingStreamBuf(const std::string& filepath, Compression compression,
+                                               std::size_t bufferSize, std::size_t bufferCount)
+    : filepath(filepath),
+      compression(compression),
+      buffers(std::max<std::size_t>(bufferCount, 2))
+{
+    for(Buffer& buffer : buffers) {
+        buffer.data.resize(bufferSize);
+        freeBuffers.push_back(&buffer);
+    }
+    SCAN_METRICS_ADD(Allocations, buffers.size());
+    thread = std::thread(&DecompressingStreamBuf::produce, this);
+}
+
+
+DecompressingStreamBuf::~DecompressingStreamBuf()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    freeAvailable.notify_all();
+    thread.join();
+}
+
+
+DecompressingStreamBuf::int_type DecompressingStreamBuf::underflow()
+{
+    if(gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // the current buffer has been read, hand it back.
+    if(current != nullptr) {
+        freeBuffers.push_back(current);
+        current = nullptr;
+        freeAvailable.notify_one();
+    }
+
+    for(;;) {
+        fullAvailable.wait(lock, [this]() { return finished || !fullBuffers.empty(); });
+        if(fullBuffers.empty()) {
+            setg(nullptr, nullptr, nullptr);
+            return traits_type::eof();
+        }
+
+        current = fullBuffers.front();
+        fullBuffers.pop_front();
+        if(current->size > 0) {
+            break;
+        }
+        freeBuffers.push_back(current);
+        current = nullptr;
+        freeAvailable.notify_one();
+    }
+
+    char* data = current->data.data();
+    setg(data, data, data + current->size);
+    return traits_type::to_int_type(*gptr());
+}
+
+
+DecompressingStreamBuf::Buffer* DecompressingStreamBuf::takeFree()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    freeAvailable.wait(lock, [this]() { return stopping || !freeBuffers.empty(); });
+    if(stopping) {
+        return nullptr;
+    }
+    Buffer* buffer = freeBuffers.front();
+    freeBuffers.pop_front();
+    buffer->size = 0;
+    return buffer;
+}
+
+
+void DecompressingStreamBuf::pushFull(Buffer* buffer)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fullBuffers.push_back(buffer);
+    }
+    fullAvailable.notify_one();
+}
+
+
+void DecompressingStreamBuf::produce()
+{
+    std::FILE* file = std::fopen(filepath.c_str(), "rb");
+    if(file == nullptr) {
+        error = true;
+    }
+    else {
+        bool ok = false;
+        switch(compression) {
+        case Compression::Gzip:
+            ok = produceGzip(file);
+            break;
+        case Compression::Zstd:
+            ok = produceZstd(file);
+            break;
+        case Compression::None:
+            break;
+        }
+        error = !ok;
+        std::fclose(file);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    fullAvailable.notify_all();
+}
+
+
+#if QUETZALCOATLUS_USE_ZLIB
+
+bool DecompressingStreamBuf::produceGzip(std::FILE* file)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    // 15 + 32: the largest window, and detect the gzip (or zlib) header.
+    if(inflateInit2(&stream, 15 + 32) != Z_OK) {
+        return false;
+    }
+
+    std::vector<unsigned char> input(inputBlockSize);
+    Buffer* output = takeFree();
+    bool inMember = false;
+    bool ok = true;
+
+    while(output != nullptr) {
+        if(stream.avail_in == 0) {
+            const std::size_t size = std::fread(input.data(), 1, input.size(), file);
+            compressedRead += size;
+            if(size == 0) {
+                // a member cut short is a damaged file, not the end of it.
+                ok = !inMember && !std::ferror(file);
+                break;
+            }
+            stream.next_in = input.data();
+            stream.avail_in = static_cast<uInt>(size);
+        }
+
+        const std::size_t space = output->data.size() - output->size;
+        stream.next_out = reinterpret_cast<Bytef*>(output->data.data() + output->size);
+        stream.avail_out = static_cast<uInt>(space);
+        inMember = true;
+        const int result = inflate(&stream, Z_NO_FLUSH);
+        output->size += space - stream.avail_out;
+
+        if(result == Z_STREAM_END) {
+            // concatenated members (e.g. from appending to a .gz) are one stream, like gunzip does.
+            inMember = false;
+            inflateReset(&stream);
+        }
+        else if(result != Z_OK && result != Z_BUF_ERROR) {
+            ok = false;
+            break;
+        }
+
+        if(output->size == output->data.size()) {
+            pushFull(output);
+            output = takeFree();
+        }
+    }
+
+    if(output != nullptr) {
+        pushFull(output);
+    }
+    inflateEnd(&stream);
+    return ok;
+}
+
+#else // #if QUETZALCOATLUS_USE_ZLIB
+
+bool DecompressingStreamBuf::produceGzip(std::FILE* file)
+{
+    (void)file;
+    return false;
+}
+
+#endif // #if QUETZALCOATLUS_USE_ZLIB
+
+
+#if QUETZALCOATLUS_USE_ZSTD
+
+bool DecompressingStreamBuf::produceZstd(std::FILE* file)
+{
+    ZSTD_DCtx* context = ZSTD_createDCtx();
+    if(context == nullptr) {
+        return false;
+    }
+
+    std::vector<char> input(ZSTD_DStreamInSize());
+    Buffer* output = takeFree();
+    // 0 once a frame is complete, so a file that ends with anything else was cut short.
+    std::size_t lastResult = 0;
+    bool ok = true;
+
+    while(ok && output != nullptr) {
+        const std::size_t size = std::fread(input.data(), 1, input.size(), file);
+        compressedRead += size;
+        if(size == 0) {
+            ok = (lastResult == 0) && !std::ferror(file);
+            break;
+        }
+
+        ZSTD_inBuffer in = {input.data(), size, 0};
+        for(;;) {
+            ZSTD_outBuffer out = {output->data.data() + output->size, output->data.size() - output->size, 0};
+            lastResult = ZSTD_decompressStream(context, &out, &in);
+            if(ZSTD_isError(lastResult)) {
+                ok = false;
+                break;
+            }
+            output->size += out.pos;
+
+            // a full output buffer may leave decompressed data behind in the context.
+            const bool full = (output->size == output->data.size());
+            if(full) {
+                pushFull(output);
+                output = takeFree();
+                if(output == nullptr) {
+                    break;
+                }
+            }
+            if(in.pos == in.size && !full) {
+                break;
+            }
+        }
+    }
+
+    if(output != nullptr) {
+        pushFull(output);
+    }
+    ZSTD_freeDCtx(context);
+    return ok;
+}
+
+#else // #if QUETZALCOATLUS_USE_ZSTD
+
+bool DecompressingStreamBuf::produceZstd(std::FILE* file)
+{
+    (void)file;
+    return false;
+}
+
+#endif // #if QUETZALCOATLUS_USE_ZSTD
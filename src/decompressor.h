@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DECOMPRESSOR_H
+#define DECOMPRESSOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+enum class Compression
+{
+    None,
+    Gzip,
+    Zstd,
+};
+
+
+// by the magic bytes at the start of the file, not by the extension.
+Compression detectCompression(const std::string& filepath);
+
+// whether this build can decompress it (zlib and zstd are optional dependencies).
+bool compressionSupported(Compression compression);
+
+
+// decompresses a file on a thread of its own, and serves the result as a stream buffer,
+// so decompression and whatever reads the stream (the LogScanner) run at the same time.
+//
+// the two sides hand a fixed set of buffers back and forth through a bounded queue: the
+// decompressor fills free buffers, the reader drains full ones and gives them back. the memory
+// used is bufferCount * bufferSize whatever the size of the log, a fast decompressor waits for
+// the reader when all buffers are full, and the whole pipeline runs at the speed of the slower
+// of the two stages.
+class DecompressingStreamBuf : public std::streambuf
+{
+public:
+    static constexpr std::size_t defaultBufferSize = 1024 * 1024;
+    static constexpr std::size_t defaultBufferCount = 4;
+
+    DecompressingStreamBuf(const std::string& filepath, Compression compression,
+                           std::size_t bufferSize = defaultBufferSize,
+                           std::size_t bufferCount = defaultBufferCount);
+    ~DecompressingStreamBuf() override;
+
+    DecompressingStreamBuf(const DecompressingStreamBuf&) = delete;
+    DecompressingStreamBuf& operator=(const DecompressingStreamBuf&) = delete;
+
+    // the file could not be read, or is not valid compressed data. the stream just ends early,
+    // so check this once it has been read to the end.
+    bool failed() const { return error; }
+
+    // compressed bytes consumed so far, for progress against the size of the file.
+    std::uint64_t compressedBytesRead() const { return compressedRead; }
+
+protected:
+    int_type underflow() override;
+
+private:
+    struct Buffer
+    {
+        std::vector<char> data;
+        std::size_t size = 0;
+    };
+
+    // the decompression thread.
+    void produce();
+    bool produceGzip(std::FILE* file);
+    bool produceZstd(std::FILE* file);
+
+    // decompressor side: wait for a free buffer, nullptr if the reader went away.
+    Buffer* takeFree();
+    void pushFull(Buffer* buffer);
+
+    std::string filepath;
+    Compression compression;
+
+    std::vector<Buffer> buffers;
+    std::deque<Buffer*> freeBuffers;
+    std::deque<Buffer*> fullBuffers;
+    Buffer* current = nullptr;      // being read, owned by the reader
+    std::mutex mutex;
+    std::condition_variable freeAvailable;
+    std::condition_variable fullAvailable;
+    bool finished = false;          // the decompressor produced its last buffer
+    bool stopping = false;          // the reader went away
+
+    std::atomic<bool> error{false};
+    std::atomic<std::uint64_t> compressedRead{0};
+
+    std::thread thread;
+};
+
+#endif // #ifndef DECOMPRESSOR_H
@@ -0,0 +1,322 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "directoryscanner.h"
+#include "decompressor.h"
+#include "lineindex.h"
+#include "mappedfile.h"
+#include "scanmetrics.h"
+#include "taskscheduler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <system_error>
+
+
+// also cap the number of files per batch, so tiny files still spread over all the threads.
+static constexpr std::size_t maxBatchFiles = 64;
+
+
+// a file split into shards, shared by the tasks scanning them.
+struct DirectoryScanner::FileJob
+{
+    std::string path;
+    MappedFile file;
+    std::vector<std::pair<std::size_t, std::size_t>> shards;
+    std::vector<FileScanResult> shardResults;
+    std::vector<std::uint64_t> shardNewlines;
+    // end of each shard's last match, which can run on into the next shard.
+    std::vector<std::uint64_t> shardMatchEnds;
+    std::atomic<std::size_t> remaining{0};
+};
+
+
+bool matchWildcard(std::string_view pattern, std::string_view name)
+{
+    std::size_t p = 0;
+    std::size_t n = 0;
+    // where to resume after the last '*' if the rest does not match.
+    std::size_t starPattern = std::string_view::npos;
+    std::size_t starName = 0;
+
+    while(n < name.size()) {
+        if(p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            p++;
+            n++;
+        }
+        else if(p < pattern.size() && pattern[p] == '*') {
+            starPattern = p++;
+            starName = n;
+        }
+        else if(starPattern != std::string_view::npos) {
+            p = starPattern + 1;
+            n = ++starName;
+        }
+        else {
+            return false;
+        }
+    }
+    while(p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+
+DirectoryScanner::DirectoryScanner(const RuleSet& rules, MatcherBackend backend)
+    : scanner(rules, backend)
+{
+    // the parallelism comes from the scheduler, each task scans on its own thread.
+    scanner.scanner().setThreadCount(1);
+    scanner.scanner().setProgressCallback([this](std::uint64_t) { return !stopRequested; });
+}
+
+
+std::vector<std::string> DirectoryScanner::expand(const std::vector<std::string>& paths)
+{
+    namespace fs = std::filesystem;
+    std::vector<std::string> files;
+
+    auto addTree = [&files](const fs::path& directory, bool recursive, std::string_view namePattern) {
+        std::error_code error;
+        auto add = [&](const fs::directory_entry& entry) {
+            std::error_code entryError;
+            if(entry.is_regular_file(entryError) &&
+               (namePattern.empty() || matchWildcard(namePattern, entry.path().filename().string()))) {
+                files.push_back(entry.path().string());
+            }
+        };
+        if(recursive) {
+            for(fs::recursive_directory_iterator it(directory, fs::directory_options::skip_permission_denied, error), end;
+                !error && it != end; it.increment(error)) {
+                add(*it);
+            }
+        }
+        else {
+            for(fs::directory_iterator it(directory, fs::directory_options::skip_permission_denied, error), end;
+                !error && it != end; it.increment(error)) {
+                add(*it);
+            }
+        }
+    };
+
+    for(const std::string& path : paths) {
+        const fs::path fsPath(path);
+        const std::string name = fsPath.filename().string();
+        std::error_code error;
+
+        if(name.find_first_of("*?") != std::string::npos) {
+            fs::path directory = fsPath.parent_path();
+            bool recursive = false;
+            if(directory.filename() == "**") {
+                directory = directory.parent_path();
+                recursive = true;
+            }
+            addTree(directory.empty() ? fs::path(".") : directory, recursive, name);
+        }
+        else if(fs::is_directory(fsPath, error)) {
+            addTree(fsPath, true, std::string_view());
+        }
+        else {
+            // even if it does not exist, so that it is reported as failed.
+            files.push_back(path);
+        }
+    }
+
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+    return files;
+}
+
+
+void DirectoryScanner::addRecord(const RuleMatch& match, std::uint64_t offset, std::uint64_t line,
+                                 FileScanResult& result) const
+{
+    result.records.push_back(RuleRecord{offset, line, static_cast<std::uint32_t>(match.rule),
+                                        static_cast<std::uint32_t>(result.fields.size())});
+    for(std::size_t field = 0; field < match.fieldCount(); field++) {
+        const std::string_view text = match.field(field);
+        const FieldValue value = match.value(field);
+        result.fieldErrors += (value.error != FieldError::None) ? 1 : 0;
+        result.fields.push_back(RecordField{result.fieldText.size(), static_cast<std::uint32_t>(text.size()), value});
+        result.fieldText.append(text);
+    }
+}
+
+
+void DirectoryScanner::scanWhole(const std::string& path, std::uint64_t size, FileScanResult& result) const
+{
+    result.path = path;
+    result.size = size;
+    result.completed = scanner.scanFile(path,
+                                        [this, &result](const RuleMatch& match) {
+                                            addRecord(match, match.match->offset, match.match->line, result);
+                                            return true;
+                                        });
+}
+
+
+bool DirectoryScanner::scan(const std::vector<std::string>& files, const FileCallback& callback)
+{
+    stopRequested = false;
+
+    std::mutex deliverMutex;
+    auto deliver = [this, &deliverMutex, &callback](const FileScanResult& result) {
+        std::lock_guard<std::mutex> lock(deliverMutex);
+        if(!stopRequested && !callback(result)) {
+            stopRequested = true;
+        }
+    };
+
+    TaskScheduler scheduler(threadCount);
+
+    // submitted after the batches: a thread takes its own tasks last in, first out, so the shards
+    // are what every thread starts with.
+    std::vector<TaskScheduler::Task> shardTasks;
+    std::vector<std::pair<std::string, std::uint64_t>> smallFiles;
+    for(const std::string& path : files) {
+        std::error_code error;
+        const std::uint64_t size = static_cast<std::uint64_t>(std::filesystem::file_size(path, error));
+        // a compressed log can only be read from the start, so it is scanned whole.
+        if(error || size <= shardSize || detectCompression(path) != Compression::None) {
+            smallFiles.emplace_back(path, error ? 0 : size);
+            continue;
+        }
+
+        auto job = std::make_shared<FileJob>();
+        job->path = path;
+        if(!job->file.open(path)) {
+            smallFiles.emplace_back(path, size);
+            continue;
+        }
+
+        // shards end just after a newline, so no line is split, and each reads on into the next
+        // only to complete a match that started in it.
+        const std::string_view data = job->file.view();
+        for(std::size_t begin = 0; begin < data.size();) {
+            std::size_t end = static_cast<std::size_t>(std::min<std::uint64_t>(begin + shardSize, data.size()));
+            if(end < data.size()) {
+                const void* newline = std::memchr(data.data() + end, '\n', data.size() - end);
+                end = (newline != nullptr) ? static_cast<std::size_t>(static_cast<const char*>(newline) - data.data()) + 1
+                                           : data.size();
+            }
+            job->shards.emplace_back(begin, end);
+            begin = end;
+        }
+        job->shardResults.resize(job->shards.size());
+        job->shardNewlines.resize(job->shards.size(), 0);
+        job->shardMatchEnds.resize(job->shards.size(), 0);
+        job->remaining = job->shards.size();
+
+        for(std::size_t shard = 0; shard < job->shards.size(); shard++) {
+            shardTasks.push_back([this, job, shard, size, &deliver]() {
+                const std::string_view fileData = job->file.view();
+                const std::size_t shardBegin = job->shards[shard].first;
+                const std::size_t shardEnd = job->shards[shard].second;
+
+                // lines are fixed up once the shards before are counted.
+                auto scanShard = [this, fileData](std::size_t from, std::size_t until, FileScanResult& part,
+                                                  std::uint64_t& matchEnd) {
+                    part.completed = scanner.scanRange(fileData, from, until,
+                                                       [this, &part, &matchEnd](const RuleMatch& match) {
+                                                           addRecord(match, match.match->offset, match.match->line, part);
+                                                           matchEnd = match.match->offset + match.match->length;
+                                                           return true;
+                                                       });
+                };
+
+                if(!stopRequested) {
+                    SCAN_METRICS_SPAN("shard");
+                    scanShard(shardBegin, shardEnd, job->shardResults[shard], job->shardMatchEnds[shard]);
+                    job->shardNewlines[shard] = countNewlines(fileData.data() + shardBegin, fileData.data() + shardEnd);
+                }
+
+                if(job->remaining.fetch_sub(1) != 1) {
+                    return;
+                }
+
+                // the last shard to finish merges them, in file order.
+                FileScanResult result;
+                result.path = job->path;
+                result.size = size;
+                result.completed = true;
+                std::uint64_t linesBefore = 0;
+                std::uint64_t reportedUntil = 0;
+                for(std::size_t index = 0; index < job->shards.size(); index++) {
+                    FileScanResult& part = job->shardResults[index];
+                    std::uint64_t lineBase = linesBefore;
+                    // the last match of the shards before ran on into this one, past where this one's
+                    // first match starts: scan it again from the end of that match, as a whole file
+                    // scan would.
+                    if(!part.records.empty() && part.records.front().offset < reportedUntil) {
+                        const std::size_t from = static_cast<std::size_t>(reportedUntil);
+                        part = FileScanResult();
+                        job->shardMatchEnds[index] = 0;
+                        scanShard(from, job->shards[index].second, part, job->shardMatchEnds[index]);
+                        lineBase += countNewlines(fileData.data() + job->shards[index].first, fileData.data() + from);
+                    }
+                    if(!part.records.empty()) {
+                        reportedUntil = job->shardMatchEnds[index];
+                    }
+
+                    result.completed = result.completed && part.completed;
+                    const std::uint32_t fieldBase = static_cast<std::uint32_t>(result.fields.size());
+                    for(RuleRecord record : part.records) {
+                        record.line += lineBase;
+                        record.firstField += fieldBase;
+                        result.records.push_back(record);
+                    }
+                    const std::uint64_t textBase = result.fieldText.size();
+                    for(RecordField field : part.fields) {
+                        field.textBegin += textBase;
+                        result.fields.push_back(field);
+                    }
+                    result.fieldText += part.fieldText;
+                    result.fieldErrors += part.fieldErrors;
+                    linesBefore += job->shardNewlines[index];
+                }
+                job->shardResults.clear();
+                deliver(result);
+            });
+        }
+    }
+
+    // batches of small files, before the shards of the large ones.
+    std::vector<std::pair<std::string, std::uint64_t>> batch;
+    std::uint64_t batchBytes = 0;
+    auto submitBatch = [this, &scheduler, &batch, &batchBytes, &deliver]() {
+        if(batch.empty()) {
+            return;
+        }
+        scheduler.submit([this, files = std::move(batch), &deliver]() {
+            for(const auto& file : files) {
+                if(stopRequested) {
+                    return;
+                }
+                FileScanResult result;
+                scanWhole(file.first, file.second, result);
+                deliver(result);
+            }
+        });
+        batch.clear();
+        batchBytes = 0;
+    };
+    for(auto& file : smallFiles) {
+        batchBytes += file.second;
+        batch.push_back(std::move(file));
+        if(batchBytes >= batchSize || batch.size() >= maxBatchFiles) {
+            submitBatch();
+        }
+    }
+    submitBatch();
+
+    for(TaskScheduler::Task& task : shardTasks) {
+        scheduler.submit(std::move(task));
+    }
+    shardTasks.clear();
+
+    scheduler.wait();
+    return !stopRequested;
+}
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef DIRECTORYSCANNER_H
+#define DIRECTORYSCANNER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ruleset.h"
+
+
+// one match of a rule, with its fields stored in the FileScanResult.
+struct RuleRecord
+{
+    std::uint64_t offset;   // byte offset of the match in the file
+    std::uint64_t line;     // line number (1 based) of the match
+    std::uint32_t rule;     // index of the rule in the RuleSet
+    std::uint32_t firstField;   // index of the record's first field in FileScanResult::fields
+};
+
+
+// a field of a record: where its text is in FileScanResult::fieldText, and its typed value.
+struct RecordField
+{
+    std::uint64_t textBegin;
+    std::uint32_t textLength;
+    FieldValue value;
+};
+
+
+// everything found in one file.
+struct FileScanResult
+{
+    std::string path;
+    std::uint64_t size = 0;
+    bool completed = false;     // false if the file could not be read, or the scan was stopped
+    std::vector<RuleRecord> records;
+    // the fields of all the records, as many per record as its rule has. their texts share one
+    // buffer, so a match costs no allocation of its own.
+    std::vector<RecordField> fields;
+    std::string fieldText;
+    // fields that are not a value of their type (see FieldValue::error).
+    std::uint64_t fieldErrors = 0;
+
+    std::string_view field(const RuleRecord& record, std::size_t index) const
+    {
+        const RecordField& field = fields[record.firstField + index];
+        return std::string_view(fieldText.data() + field.textBegin, field.textLength);
+    }
+    const FieldValue& value(const RuleRecord& record, std::size_t index) const
+    {
+        return fields[record.firstField + index].value;
+    }
+};
+
+
+// scans many files (whole directory trees) with a RuleSet, on a work-stealing TaskScheduler.
+//
+// small files are batched into tasks of about batchSize bytes, so the per task overhead does not
+// dominate when there are tens of thousands of them, and files larger than shardSize are split
+// into newline aligned shards (each reading on into the next to complete a match that started in
+// it), so one huge log is spread over all the threads instead of keeping one busy long after the
+// others ran out of work. the shards go first, as the largest pieces of work are best started early.
+//
+// each file's result is handed to the callback as soon as that file is done (the last of its
+// shards merges them), so results stream out in completion order, not in the order given.
+class DirectoryScanner
+{
+public:
+    static constexpr std::uint64_t defaultShardSize = 64 * 1024 * 1024;
+    static constexpr std::uint64_t defaultBatchSize = 4 * 1024 * 1024;
+
+    // called for one file at a time, never concurrently. return false to stop the scan.
+    using FileCallback = std::function<bool(const FileScanResult& result)>;
+
+    // throws std::regex_error if a pattern is not valid.
+    explicit DirectoryScanner(const RuleSet& rules, MatcherBackend backend = MatcherBackend::Builtin);
+
+    // 0 means one per hardware thread.
+    void setThreadCount(unsigned int count) { threadCount = count; }
+    void setShardSize(std::uint64_t size) { shardSize = size; }
+    void setBatchSize(std::uint64_t size) { batchSize = size; }
+
+    // the regular files of the given paths: a file as is, a directory recursively, and a glob
+    // with wildcards (* and ?) in its last component, e.g. "logs/*.log", or "logs/**/*.log"
+    // for all the matching files in the tree. sorted, without duplicates.
+    static std::vector<std::string> expand(const std::vector<std::string>& paths);
+
+    // returns false if the scan was stopped by the callback.
+    // a file that cannot be read is still reported, as not completed.
+    bool scan(const std::vector<std::string>& files, const FileCallback& callback);
+
+    const RuleScanner& ruleScanner() const { return scanner; }
+
+private:
+    struct FileJob;
+
+    void scanWhole(const std::string& path, std::uint64_t size, FileScanResult& result) const;
+    void addRecord(const RuleMatch& match, std::uint64_t offset, std::uint64_t line, FileScanResult& result) const;
+
+    RuleScanner scanner;
+    unsigned int threadCount = 0;
+    std::uint64_t shardSize = defaultShardSize;
+    std::uint64_t batchSize = defaultBatchSize;
+    std::atomic<bool> stopRequested{false};
+};
+
+
+// shell style wildcard match of a whole name: '*' any run of characters, '?' any one character.
+bool matchWildcard(std::string_view pattern, std::string_view name);
+
+#endif // #ifndef DIRECTORYSCANNER_H
@@ -0,0 +1,299 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "fieldvalue.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <system_error>
+
+
+namespace
+{
+
+std::string_view trim(std::string_view text)
+{
+    while(!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+        text.remove_prefix(1);
+    }
+    while(!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+
+FieldError fromCharsError(std::errc error)
+{
+    if(error == std::errc::result_out_of_range) {
+        return FieldError::Overflow;
+    }
+    return error == std::errc() ? FieldError::None : FieldError::Malformed;
+}
+
+
+// the number at the start of [begin, last), 'end' is where it stops.
+FieldError parseDouble(const char* begin, const char* last, double& value, const char*& end)
+{
+    if(begin < last && *begin == '+') {
+        begin++;
+    }
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    const std::from_chars_result parsed = std::from_chars(begin, last, value);
+    end = parsed.ptr;
+    return fromCharsError(parsed.ec);
+#else
+    // no floating point std::from_chars in this standard library: strtod, on a copy that is
+    // null terminated (numbers longer than the buffer are not numbers we can represent anyway).
+    char buffer[128];
+    const std::size_t length = std::min<std::size_t>(static_cast<std::size_t>(last - begin), sizeof(buffer) - 1);
+    std::memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    char* stop = nullptr;
+    errno = 0;
+    value = std::strtod(buffer, &stop);
+    end = begin + (stop - buffer);
+    if(stop == buffer) {
+        return FieldError::Malformed;
+    }
+    return (errno == ERANGE && std::isinf(value)) ? FieldError::Overflow : FieldError::None;
+#endif
+}
+
+
+FieldError parseInteger(std::string_view text, FieldValue& value)
+{
+    const char* begin = text.data();
+    const char* end = text.data() + text.size();
+    if(begin < end && *begin == '+') {
+        begin++;
+    }
+    const std::from_chars_result parsed = std::from_chars(begin, end, value.integer);
+    if(parsed.ec == std::errc() && parsed.ptr != end) {
+        return FieldError::Malformed;
+    }
+    value.real = static_cast<double>(value.integer);
+    return fromCharsError(parsed.ec);
+}
+
+
+FieldError parseHex(std::string_view text, FieldValue& value)
+{
+    if(text.size() > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        text.remove_prefix(2);
+    }
+    if(!text.empty() && (text[0] == '-' || text[0] == '+')) {
+        return FieldError::Malformed;
+    }
+    std::uint64_t number = 0;
+    const std::from_chars_result parsed = std::from_chars(text.data(), text.data() + text.size(), number, 16);
+    if(parsed.ec == std::errc() && parsed.ptr != text.data() + text.size()) {
+        return FieldError::Malformed;
+    }
+    if(parsed.ec == std::errc() && number > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max())) {
+        return FieldError::Overflow;
+    }
+    value.integer = static_cast<std::int64_t>(number);
+    value.real = static_cast<double>(number);
+    return fromCharsError(parsed.ec);
+}
+
+
+// nanoseconds per unit, 0 if 'unit' is none.
+double unitNanoseconds(std::string_view unit)
+{
+    if(unit == "ns") {
+        return 1;
+    }
+    if(unit == "us" || unit == "\xc2\xb5s") {
+        return 1e3;
+    }
+    if(unit == "ms") {
+        return 1e6;
+    }
+    if(unit == "s" || unit == "sec") {
+        return 1e9;
+    }
+    if(unit == "m" || unit == "min") {
+        return 60e9;
+    }
+    if(unit == "h") {
+        return 3600e9;
+    }
+    if(unit == "d") {
+        return 86400e9;
+    }
+    return 0;
+}
+
+
+FieldError parseDuration(std::string_view text, FieldValue& value)
+{
+    const char* at = text.data();
+    const char* end = text.data() + text.size();
+    const bool negative = (at < end && *at == '-');
+    if(negative) {
+        at++;
+    }
+
+    double nanoseconds = 0;
+    if(text.find(':') != std::string_view::npos) {
+        // [[h:]mm:]ss[.fff]: each part is worth 60 of the next.
+        while(at < end) {
+            double part = 0;
+            const char* stop = nullptr;
+            const FieldError error = parseDouble(at, end, part, stop);
+            if(error != FieldError::None) {
+                return error;
+            }
+            nanoseconds = nanoseconds * 60 + part * 1e9;
+            if(stop == end) {
+                break;
+            }
+            if(*stop != ':' || stop + 1 == end) {
+                return FieldError::Malformed;
+            }
+            at = stop + 1;
+        }
+    }
+    else {
+        // a number with a unit, as often as needed ("1h30m"), or a number alone, in seconds.
+        while(at < end) {
+            double number = 0;
+            const char* stop = nullptr;
+            const FieldError error = parseDouble(at, end, number, stop);
+            if(error != FieldError::None) {
+                return error;
+            }
+            while(stop < end && *stop == ' ') {
+                stop++;
+            }
+            const char* unitEnd = stop;
+            while(unitEnd < end && !(*unitEnd >= '0' && *unitEnd <= '9') && *unitEnd != '.' && *unitEnd != ' ') {
+                unitEnd++;
+            }
+            double unit = 1e9;
+            if(unitEnd != stop) {
+                unit = unitNanoseconds(std::string_view(stop, static_cast<std::size_t>(unitEnd - stop)));
+                if(unit == 0) {
+                    return FieldError::Malformed;
+                }
+            }
+            else if(stop != end) {
+                return FieldError::Malformed;
+            }
+            nanoseconds += number * unit;
+            at = unitEnd;
+            while(at < end && *at == ' ') {
+                at++;
+            }
+        }
+    }
+
+    if(!(std::fabs(nanoseconds) < 9.2e18)) {
+        return FieldError::Overflow;
+    }
+    if(negative) {
+        nanoseconds = -nanoseconds;
+    }
+    value.integer = std::llround(nanoseconds);
+    value.real = nanoseconds / 1e9;
+    return FieldError::None;
+}
+
+} // namespace
+
+
+FieldValue parseField(FieldType type, std::string_view text)
+{
+    FieldValue value;
+    value.type = type;
+    if(type == FieldType::Text) {
+        return value;
+    }
+
+    text = trim(text);
+    if(text.empty()) {
+        value.error = FieldError::Empty;
+        return value;
+    }
+
+    switch(type) {
+    case FieldType::Integer:
+        value.error = parseInteger(text, value);
+        break;
+    case FieldType::Float: {
+        const char* end = nullptr;
+        value.error = parseDouble(text.data(), text.data() + text.size(), value.real, end);
+        if(value.error == FieldError::None && end != text.data() + text.size()) {
+            value.error = FieldError::Malformed;
+        }
+        break;
+    }
+    case FieldType::Duration:
+        value.error = parseDuration(text, value);
+        break;
+    case FieldType::Hex:
+        value.error = parseHex(text, value);
+        break;
+    case FieldType::Text:
+        break;
+    }
+
+    if(value.error != FieldError::None) {
+        value.integer = 0;
+        value.real = 0;
+    }
+    return value;
+}
+
+
+bool parseFieldType(std::string_view name, FieldType& type)
+{
+    const FieldType types[] = {FieldType::Text, FieldType::Integer, FieldType::Float, FieldType::Duration, FieldType::Hex};
+    for(FieldType candidate : types) {
+        if(name == fieldTypeName(candidate)) {
+            type = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+const char* fieldTypeName(FieldType type)
+{
+    switch(type) {
+    case FieldType::Text:
+        return "text";
+    case FieldType::Integer:
+        return "int";
+    case FieldType::Float:
+        return "float";
+    case FieldType::Duration:
+        return "duration";
+    case FieldType::Hex:
+        return "hex";
+    }
+    return "";
+}
+
+
+const char* fieldErrorName(FieldError error)
+{
+    switch(error) {
+    case FieldError::None:
+        return "";
+    case FieldError::Empty:
+        return "empty";
+    case FieldError::Malformed:
+        return "malformed";
+    case FieldError::Overflow:
+        return "overflow";
+    }
+    return "";
+}
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef FIELDVALUE_H
+#define FIELDVALUE_H
+
+#include <cstdint>
+#include <string_view>
+
+
+// what the capture of a field is parsed as.
+enum class FieldType : std::uint8_t
+{
+    Text,       // kept as it is
+    Integer,    // decimal, with an optional sign
+    Float,      // decimal or scientific
+    Duration,   // "1.5s", "250 ms", "1h30m", "01:02:03.5", or seconds
+    Hex,        // with or without "0x"
+};
+
+
+// why a capture is not a value of its field's type.
+enum class FieldError : std::uint8_t
+{
+    None,
+    Empty,
+    Malformed,
+    Overflow,   // out of range of the type
+};
+
+
+// a capture, parsed as its field's type. without an error every numeric type also has the
+// value as a double, and Integer, Hex and Duration (in nanoseconds) as an integer.
+struct FieldValue
+{
+    std::int64_t integer = 0;
+    double real = 0;
+    FieldType type = FieldType::Text;
+    FieldError error = FieldError::None;
+
+    bool isNumber() const { return type != FieldType::Text && error == FieldError::None; }
+};
+
+
+// straight from the capture, with std::from_chars: no allocation, no locale and no streams, so
+// it is cheap enough to run on every match. a bad capture is reported in the value's error.
+FieldValue parseField(FieldType type, std::string_view text);
+
+// "text", "int", "float", "duration" and "hex", as in the rule files. false for anything else.
+bool parseFieldType(std::string_view name, FieldType& type);
+const char* fieldTypeName(FieldType type);
+const char* fieldErrorName(FieldError error);
+
+#endif // #ifndef FIELDVALUE_H
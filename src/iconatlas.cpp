@@ -0,0 +1,215 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "iconatlas.h"
+
+#include <QFile>
+#include <QImageReader>
+#include <QPainter>
+#include <QPoint>
+#include <QStringList>
+#include <QTextStream>
+#include <QVector>
+
+#include <algorithm>
+
+
+// atlas rows are packed up to this width, or the widest rendering if that is wider.
+static constexpr int atlasWidth = 1024;
+
+
+QImage IconAtlas::render(const QString &filepath, const QSize &box)
+{
+    QImageReader reader(filepath);
+    QSize size = reader.size();
+    QImage image;
+
+    if(size.isValid() && !box.isEmpty()) {
+        size.scale(box, Qt::KeepAspectRatio);
+        // vector formats (SVG) render straight at the size, raster ones are scaled after reading.
+        if(reader.supportsOption(QImageIOHandler::ScaledSize)) {
+            reader.setScaledSize(size);
+            image = reader.read();
+        }
+        else {
+            image = reader.read();
+            if(!image.isNull() && image.size() != size) {
+                image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            }
+        }
+    }
+    else {
+        image = reader.read();
+        if(!image.isNull() && !box.isEmpty()) {
+            image = image.scaled(box, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        }
+    }
+
+    if(image.isNull()) {
+        return image;
+    }
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
+
+
+QString IconAtlas::key(const QString &resource, const QSize &box)
+{
+    return resource + QLatin1Char(' ') + QString::number(box.width()) + QLatin1Char('x') + QString::number(box.height());
+}
+
+
+bool IconAtlas::load(const QString &imagePath, const QString &indexPath)
+{
+    atlas = QImage();
+    entries.clear();
+
+    QFile index(indexPath);
+    if(!index.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return false;
+    }
+    QImage image(imagePath);
+    if(image.isNull()) {
+        return false;
+    }
+
+    QHash<QString, QRect> loaded;
+    QTextStream stream(&index);
+    while(!stream.atEnd()) {
+        const QString line = stream.readLine().simplified();
+        if(line.isEmpty()) {
+            continue;
+        }
+        const QStringList parts = line.split(QLatin1Char(' '));
+        if(parts.size() != 7) {
+            return false;
+        }
+        const QSize box(parts[1].toInt(), parts[2].toInt());
+        const QRect rect(parts[3].toInt(), parts[4].toInt(), parts[5].toInt(), parts[6].toInt());
+        if(!image.rect().contains(rect)) {
+            return false;
+        }
+        loaded.insert(key(parts[0], box), rect);
+    }
+
+    atlas = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    entries = loaded;
+    return true;
+}
+
+
+QImage IconAtlas::find(const QString &resource, const QSize &box) const
+{
+    const auto entry = entries.constFind(key(resource, box));
+    if(entry == entries.constEnd()) {
+        return QImage();
+    }
+    return atlas.copy(entry.value());
+}
+
+
+bool IconAtlas::build(const QString &listPath, const QString &sourceDirectory, const QList<qreal> &devicePixelRatios,
+                      const QString &imagePath, const QString &indexPath, QString &error)
+{
+    struct Rendering
+    {
+        QString resource;
+        QSize box;
+        QImage image;
+        QPoint position;
+    };
+
+    QFile list(listPath);
+    if(!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        error = QString("cannot read '%1'").arg(listPath);
+        return false;
+    }
+
+    // <resource> <source file> <width>x<height>...
+    QVector<Rendering> renderings;
+    QHash<QString, bool> seen;
+    QTextStream stream(&list);
+    int lineNumber = 0;
+    while(!stream.atEnd()) {
+        const QString line = stream.readLine().simplified();
+        lineNumber++;
+        if(line.isEmpty() || line.startsWith(QLatin1Char('#'))) {
+            continue;
+        }
+        const QStringList parts = line.split(QLatin1Char(' '));
+        if(parts.size() < 3) {
+            error = QString("%1:%2: expected <resource> <source file> <width>x<height>...").arg(listPath).arg(lineNumber);
+            return false;
+        }
+
+        const QString source = sourceDirectory + QLatin1Char('/') + parts[1];
+        for(int part = 2; part < parts.size(); part++) {
+            const QStringList size = parts[part].split(QLatin1Char('x'));
+            if(size.size() != 2 || size[0].toInt() <= 0 || size[1].toInt() <= 0) {
+                error = QString("%1:%2: invalid size '%3'").arg(listPath).arg(lineNumber).arg(parts[part]);
+                return false;
+            }
+            for(qreal ratio : devicePixelRatios) {
+                const QSize box(qRound(size[0].toInt() * ratio), qRound(size[1].toInt() * ratio));
+                if(seen.contains(key(parts[0], box))) {
+                    continue;
+                }
+                seen.insert(key(parts[0], box), true);
+
+                Rendering rendering{parts[0], box, render(source, box), QPoint()};
+                if(rendering.image.isNull()) {
+                    error = QString("%1:%2: cannot render '%3'").arg(listPath).arg(lineNumber).arg(source);
+                    return false;
+                }
+                renderings.append(rendering);
+            }
+        }
+    }
+
+    // shelf packing: tallest first, rows filled left to right.
+    std::sort(renderings.begin(), renderings.end(), [](const Rendering &a, const Rendering &b) {
+        return a.image.height() > b.image.height();
+    });
+    int width = atlasWidth;
+    for(const Rendering &rendering : renderings) {
+        width = std::max(width, rendering.image.width());
+    }
+    int x = 0;
+    int y = 0;
+    int rowHeight = 0;
+    for(Rendering &rendering : renderings) {
+        if(x + rendering.image.width() > width) {
+            x = 0;
+            y += rowHeight;
+            rowHeight = 0;
+        }
+        rendering.position = QPoint(x, y);
+        x += rendering.image.width();
+        rowHeight = std::max(rowHeight, rendering.image.height());
+    }
+
+    QImage atlas(width, std::max(y + rowHeight, 1), QImage::Format_ARGB32_Premultiplied);
+    atlas.fill(Qt::transparent);
+    QPainter painter(&atlas);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    for(const Rendering &rendering : renderings) {
+        painter.drawImage(rendering.position, rendering.image);
+    }
+    painter.end();
+
+    if(!atlas.save(imagePath, "PNG")) {
+        error = QString("cannot write '%1'").arg(imagePath);
+        return false;
+    }
+
+    QFile index(indexPath);
+    if(!index.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate)) {
+        error = QString("cannot write '%1'").arg(indexPath);
+        return false;
+    }
+    QTextStream out(&index);
+    for(const Rendering &rendering : renderings) {
+        out << rendering.resource << ' ' << rendering.box.width() << ' ' << rendering.box.height() << ' '
+            << rendering.position.x() << ' ' << rendering.position.y() << ' '
+            << rendering.image.width() << ' ' << rendering.image.height() << '\n';
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef ICONATLAS_H
+#define ICONATLAS_H
+
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QRect>
+#include <QSize>
+#include <QString>
+
+
+// images (SVGs mostly) pre-rendered at build time, packed into one image, with an index of
+// where each rendering is:
+//
+//   <resource> <box width> <box height> <x> <y> <width> <height>
+//
+// the box is the size in device pixels (logical size * device pixel ratio) the image was fitted
+// into, keeping its aspect ratio, so a rendering is found by what it was asked for with.
+// the renderings are exactly what render() returns at runtime for the same box.
+class IconAtlas
+{
+public:
+    // the image at 'filepath' (a file or a ":/" resource), as large as fits into 'box' with its
+    // aspect ratio kept. a null image if it cannot be read.
+    static QImage render(const QString &filepath, const QSize &box);
+
+    // on failure the atlas is left empty.
+    bool load(const QString &imagePath, const QString &indexPath);
+
+    // a null image if the atlas has no rendering of the resource for this box.
+    QImage find(const QString &resource, const QSize &box) const;
+
+    bool isEmpty() const { return entries.isEmpty(); }
+
+    // build time: renders every resource of the list file (see resources/icon_atlas.txt) at each of
+    // the device pixel ratios, and writes the atlas image and its index.
+    static bool build(const QString &listPath, const QString &sourceDirectory, const QList<qreal> &devicePixelRatios,
+                      const QString &imagePath, const QString &indexPath, QString &error);
+
+private:
+    static QString key(const QString &resource, const QSize &box);
+
+    QImage atlas;
+    QHash<QString, QRect> entries;
+};
+
+#endif // #ifndef ICONATLAS_H
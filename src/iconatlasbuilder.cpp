@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+// quetzalcoatlus_iconatlas: build time tool, pre-renders the icons into the atlas compiled into
+// the application, see IconAtlas and resources/icon_atlas.txt.
+//
+// usage: quetzalcoatlus_iconatlas <list file> <source directory> <device pixel ratios, e.g. 1,2>
+//                                 <atlas image> <atlas index>
+
+#include <QGuiApplication>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <iostream>
+
+#include "iconatlas.h"
+
+
+int main(int argc, char *argv[])
+{
+    // no display at build time, but the SVGs with text need the font database of a gui application.
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    const QStringList arguments = QCoreApplication::arguments();
+    if(arguments.size() != 6) {
+        std::cerr << "usage: quetzalcoatlus_iconatlas <list file> <source directory> <device pixel ratios>"
+                     " <atlas image> <atlas index>\n";
+        return 2;
+    }
+
+    QList<qreal> devicePixelRatios;
+    for(const QString &ratio : arguments[3].split(QLatin1Char(','))) {
+        bool ok = false;
+        const qreal value = ratio.toDouble(&ok);
+        if(!ok || value <= 0) {
+            std::cerr << "invalid device pixel ratio '" << ratio.toStdString() << "'\n";
+            return 2;
+        }
+        devicePixelRatios.append(value);
+    }
+
+    QString error;
+    if(!IconAtlas::build(arguments[1], arguments[2], devicePixelRatios, arguments[4], arguments[5], error)) {
+        std::cerr << error.toStdString() << "\n";
+        return 1;
+    }
+    return 0;
+}
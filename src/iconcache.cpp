@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "iconcache.h"
+#include "iconatlas.h"
+#include "quetzalcoatlus_config.h"
+
+#include <QApplication>
+#include <QHash>
+#include <QIconEngine>
+#include <QPainter>
+#include <QStyle>
+#include <QStyleOption>
+
+
+namespace
+{
+
+IconAtlas& atlas()
+{
+    static IconAtlas iconAtlas;
+    static bool loaded = false;
+    if(!loaded) {
+        loaded = true;
+#if QUETZALCOATLUS_USE_ICON_ATLAS
+        iconAtlas.load(":/iconatlas/icons.png", ":/iconatlas/icons.txt");
+#endif // #if QUETZALCOATLUS_USE_ICON_ATLAS
+    }
+    return iconAtlas;
+}
+
+
+// by resource, size in device pixels and ratio.
+QHash<QString, QPixmap>& pixmaps()
+{
+    static QHash<QString, QPixmap> cache;
+    return cache;
+}
+
+
+// the ratio is part of the key so the cached pixmap already has it: setting it on a copy would
+// copy the pixels.
+QPixmap cachedPixmap(const QString &resource, const QSize &box, qreal devicePixelRatio)
+{
+    const QString key = resource + QLatin1Char(' ') + QString::number(box.width()) + QLatin1Char('x') +
+                        QString::number(box.height()) + QLatin1Char('@') + QString::number(devicePixelRatio);
+    const auto cached = pixmaps().constFind(key);
+    if(cached != pixmaps().constEnd()) {
+        return cached.value();
+    }
+
+    QImage image = atlas().find(resource, box);
+    if(image.isNull()) {
+        image = IconAtlas::render(resource, box);
+    }
+    QPixmap pixmap = QPixmap::fromImage(image);
+    pixmap.setDevicePixelRatio(devicePixelRatio);
+    pixmaps().insert(key, pixmap);
+    return pixmap;
+}
+
+
+class CachedIconEngine : public QIconEngine
+{
+public:
+    explicit CachedIconEngine(const QString &resource) : resource(resource) {}
+
+    // QIcon asks for sizes in device pixels (logical size * ratio), and sets the ratio itself.
+    QPixmap pixmap(const QSize &size, QIcon::Mode mode, QIcon::State state) override
+    {
+        Q_UNUSED(state);
+        return modePixmap(cachedPixmap(resource, size, 1.0), mode);
+    }
+
+    QSize actualSize(const QSize &size, QIcon::Mode mode, QIcon::State state) override
+    {
+        Q_UNUSED(mode);
+        Q_UNUSED(state);
+        return cachedPixmap(resource, size, 1.0).size();
+    }
+
+    void paint(QPainter *painter, const QRect &rect, QIcon::Mode mode, QIcon::State state) override
+    {
+        Q_UNUSED(state);
+        const qreal ratio = painter->device()->devicePixelRatioF();
+        const QPixmap pixmap = modePixmap(cachedPixmap(resource, rect.size() * ratio, ratio), mode);
+        const QSize size = pixmap.size() / ratio;
+        painter->drawPixmap(QRect(rect.topLeft() + QPoint((rect.width() - size.width()) / 2,
+                                                          (rect.height() - size.height()) / 2),
+                                  size),
+                            pixmap);
+    }
+
+    QIconEngine *clone() const override { return new CachedIconEngine(resource); }
+
+    QString key() const override { return QStringLiteral("CachedIconEngine"); }
+
+private:
+    static QPixmap modePixmap(QPixmap pixmap, QIcon::Mode mode)
+    {
+        if(mode != QIcon::Normal && !pixmap.isNull()) {
+            // disabled/selected look, the way the default engine makes it.
+            QStyleOption option(0);
+            option.palette = QGuiApplication::palette();
+            pixmap = QApplication::style()->generatedIconPixmap(mode, pixmap, &option);
+        }
+        return pixmap;
+    }
+
+    QString resource;
+};
+
+} // namespace
+
+
+QPixmap IconCache::pixmap(const QString &resource, const QSize &size, qreal devicePixelRatio)
+{
+    return cachedPixmap(resource, size * devicePixelRatio, devicePixelRatio);
+}
+
+
+QIcon IconCache::icon(const QString &resource)
+{
+    return QIcon(new CachedIconEngine(resource));
+}
@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <QIcon>
+#include <QPixmap>
+#include <QSize>
+#include <QString>
+
+
+// pixmaps of the image resources (SVGs mostly), by (resource, size, device pixel ratio).
+//
+// a pixmap comes from the icon atlas pre-rendered at build time if it has it (see IconAtlas),
+// otherwise the resource is rendered then, and either way it is kept for the rest of the run,
+// so each one is rendered at most once, and only if it is actually needed.
+//
+// gui thread only, like QPixmap.
+class IconCache
+{
+public:
+    // 'size' is logical, the pixmap is size * devicePixelRatio pixels (less in one direction
+    // if the aspect ratio of the resource is not that of 'size').
+    static QPixmap pixmap(const QString &resource, const QSize &size, qreal devicePixelRatio);
+
+    // an icon whose pixmaps, at whatever size and ratio they are asked for, come from the cache.
+    static QIcon icon(const QString &resource);
+};
+
+#endif // #ifndef ICONCACHE_H
@@ -0,0 +1,365 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "lineindex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LINEINDEX_X86 1
+#include <immintrin.h>
+#else
+#define LINEINDEX_X86 0
+#endif
+
+
+namespace
+{
+
+// "QZLI", then the format version. bump the version when the layout changes.
+constexpr char indexMagic[4] = {'Q', 'Z', 'L', 'I'};
+constexpr std::uint32_t indexVersion = 1;
+
+
+// the newline counting of one pass, with the line starts to sample, if any.
+struct NewlineScan
+{
+    std::uint64_t newlines;
+    std::uint32_t sampling;
+    // when 'newlines' gets here the next line is sampled.
+    std::uint64_t nextSample;
+    std::vector<std::uint64_t>* starts;
+};
+
+
+void scanPortable(const char* data, std::uint64_t begin, std::uint64_t end, NewlineScan& scan)
+{
+    if(scan.starts == nullptr) {
+        // the compilers vectorize this on their own.
+        std::uint64_t count = 0;
+        for(const char* at = data + begin; at < data + end; at++) {
+            count += (*at == '\n') ? 1 : 0;
+        }
+        scan.newlines += count;
+        return;
+    }
+    for(std::uint64_t position = begin; position < end; position++) {
+        if(data[position] == '\n' && ++scan.newlines == scan.nextSample) {
+            scan.starts->push_back(position + 1);
+            scan.nextSample += scan.sampling;
+        }
+    }
+}
+
+
+#if LINEINDEX_X86
+
+// the newlines of a block, as a bit mask: mostly only counted, and only looked at bit by bit
+// when a sampled line starts in the block.
+inline void takeNewlines(std::uint32_t mask, std::uint64_t position, NewlineScan& scan)
+{
+    const std::uint64_t count = static_cast<std::uint64_t>(__builtin_popcount(mask));
+    if(scan.starts == nullptr || scan.newlines + count < scan.nextSample) {
+        scan.newlines += count;
+        return;
+    }
+    while(mask != 0) {
+        const unsigned int bit = static_cast<unsigned int>(__builtin_ctz(mask));
+        if(++scan.newlines == scan.nextSample) {
+            scan.starts->push_back(position + bit + 1);
+            scan.nextSample += scan.sampling;
+        }
+        mask &= mask - 1;
+    }
+}
+
+
+#if defined(__x86_64__) || defined(__SSE2__)
+void scanSse2(const char* data, std::uint64_t begin, std::uint64_t end, NewlineScan& scan)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    std::uint64_t position = begin;
+    for(; position + 16 <= end; position += 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+        takeNewlines(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline))), position, scan);
+    }
+    scanPortable(data, position, end, scan);
+}
+#endif // #if defined(__x86_64__) || defined(__SSE2__)
+
+
+__attribute__((target("avx2,popcnt")))
+void scanAvx2(const char* data, std::uint64_t begin, std::uint64_t end, NewlineScan& scan)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    std::uint64_t position = begin;
+    for(; position + 32 <= end; position += 32) {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+        takeNewlines(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline))), position, scan);
+    }
+    scanPortable(data, position, end, scan);
+}
+
+#endif // #if LINEINDEX_X86
+
+
+using ScanFunction = void (*)(const char*, std::uint64_t, std::uint64_t, NewlineScan&);
+
+
+ScanFunction selectImplementation()
+{
+#if LINEINDEX_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")) {
+        return scanAvx2;
+    }
+#if defined(__x86_64__) || defined(__SSE2__)
+    return scanSse2;
+#endif
+#endif // #if LINEINDEX_X86
+    return scanPortable;
+}
+
+
+void scanNewlines(const char* data, std::uint64_t begin, std::uint64_t end, NewlineScan& scan)
+{
+    static const ScanFunction implementation = selectImplementation();
+    implementation(data, begin, end, scan);
+}
+
+
+// the position just after the 'count'-th newline from 'offset', or 'end' if there are fewer.
+std::uint64_t skipLines(std::string_view data, std::uint64_t offset, std::uint64_t count, std::uint64_t end)
+{
+    for(; count > 0 && offset < end; count--) {
+        const void* newline = std::memchr(data.data() + offset, '\n', static_cast<std::size_t>(end - offset));
+        if(newline == nullptr) {
+            return end;
+        }
+        offset = static_cast<std::uint64_t>(static_cast<const char*>(newline) - data.data()) + 1;
+    }
+    return offset;
+}
+
+
+template<typename T>
+void writeValue(std::ostream& stream, const T& value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+template<typename T>
+bool readValue(std::istream& stream, T& value)
+{
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+
+// the bytes from the read position to the end of the stream, 0 if the stream cannot seek.
+std::uint64_t remainingBytes(std::istream& stream)
+{
+    const std::istream::pos_type position = stream.tellg();
+    if(position < 0 || !stream.seekg(0, std::ios::end)) {
+        return 0;
+    }
+    const std::istream::pos_type end = stream.tellg();
+    stream.seekg(position);
+    return end > position ? static_cast<std::uint64_t>(end - position) : 0;
+}
+
+} // namespace
+
+
+std::uint64_t countNewlines(const char* begin, const char* end)
+{
+    NewlineScan scan{0, 1, 0, nullptr};
+    if(begin < end) {
+        scanNewlines(begin, 0, static_cast<std::uint64_t>(end - begin), scan);
+    }
+    return scan.newlines;
+}
+
+
+LineIndex::LineIndex(std::uint32_t sampling)
+    : sampling(std::max<std::uint32_t>(sampling, 1))
+{
+    clear();
+}
+
+
+void LineIndex::clear()
+{
+    size = 0;
+    newlines = 0;
+    partialLine = false;
+    anchors.clear();
+    deltas.clear();
+    wideSamples.clear();
+    // line 1 starts at 0.
+    addSample(0);
+}
+
+
+void LineIndex::addSample(std::uint64_t offset)
+{
+    const std::size_t sample = deltas.size();
+    if(sample % samplesPerAnchor == 0) {
+        anchors.push_back(offset);
+    }
+    const std::uint64_t delta = offset - anchors.back();
+    if(delta >= wideDelta) {
+        deltas.push_back(wideDelta);
+        wideSamples[sample] = offset;
+    }
+    else {
+        deltas.push_back(static_cast<std::uint32_t>(delta));
+    }
+}
+
+
+std::uint64_t LineIndex::sampleOffset(std::size_t sample) const
+{
+    const std::uint32_t delta = deltas[sample];
+    if(delta == wideDelta) {
+        return wideSamples.at(sample);
+    }
+    return anchors[sample / samplesPerAnchor] + delta;
+}
+
+
+void LineIndex::extend(std::string_view data)
+{
+    if(data.size() <= size) {
+        return;
+    }
+
+    std::vector<std::uint64_t> starts;
+    NewlineScan scan{newlines, sampling, (newlines / sampling + 1) * sampling, &starts};
+    scanNewlines(data.data(), size, data.size(), scan);
+
+    for(std::uint64_t start : starts) {
+        addSample(start);
+    }
+    newlines = scan.newlines;
+    size = data.size();
+    partialLine = data.back() != '\n';
+}
+
+
+bool LineIndex::lineOffset(std::string_view data, std::uint64_t line, std::uint64_t& offset) const
+{
+    if(line == 0 || line > lineCount()) {
+        return false;
+    }
+    const std::uint64_t index = line - 1;
+    const std::uint64_t start = sampleOffset(static_cast<std::size_t>(index / sampling));
+    offset = skipLines(data, start, index % sampling, std::min<std::uint64_t>(size, data.size()));
+    return true;
+}
+
+
+std::uint64_t LineIndex::lineAt(std::string_view data, std::uint64_t offset) const
+{
+    offset = std::min(offset, size);
+
+    // the last anchor, then the last sample at or before the offset.
+    const auto anchor = std::upper_bound(anchors.begin(), anchors.end(), offset);
+    const std::size_t firstSample = static_cast<std::size_t>(std::prev(anchor) - anchors.begin()) * samplesPerAnchor;
+    const std::size_t lastSample = std::min(deltas.size(), firstSample + samplesPerAnchor);
+    std::size_t sample = firstSample;
+    while(sample + 1 < lastSample && sampleOffset(sample + 1) <= offset) {
+        sample++;
+    }
+
+    const std::uint64_t start = sampleOffset(sample);
+    return static_cast<std::uint64_t>(sample) * sampling + countNewlines(data.data() + start, data.data() + offset) + 1;
+}
+
+
+bool LineIndex::write(std::ostream& stream) const
+{
+    stream.write(indexMagic, sizeof(indexMagic));
+    writeValue(stream, indexVersion);
+    writeValue(stream, sampling);
+    writeValue(stream, size);
+    writeValue(stream, newlines);
+    writeValue(stream, static_cast<std::uint8_t>(partialLine ? 1 : 0));
+    writeValue(stream, static_cast<std::uint64_t>(deltas.size()));
+    for(std::size_t sample = 0; sample < deltas.size(); sample++) {
+        // wide samples are stored with their offset after the marker.
+        writeValue(stream, deltas[sample]);
+        if(deltas[sample] == wideDelta) {
+            writeValue(stream, wideSamples.at(sample));
+        }
+    }
+    writeValue(stream, static_cast<std::uint64_t>(anchors.size()));
+    stream.write(reinterpret_cast<const char*>(anchors.data()),
+                 static_cast<std::streamsize>(anchors.size() * sizeof(std::uint64_t)));
+    return stream.good();
+}
+
+
+bool LineIndex::read(std::istream& stream)
+{
+    char magic[sizeof(indexMagic)];
+    std::uint32_t version = 0;
+    LineIndex loaded;
+    std::uint8_t partial = 0;
+    std::uint64_t sampleCount = 0;
+    if(!stream.read(magic, sizeof(magic)) || std::memcmp(magic, indexMagic, sizeof(magic)) != 0 ||
+       !readValue(stream, version) || version != indexVersion ||
+       !readValue(stream, loaded.sampling) || loaded.sampling == 0 ||
+       !readValue(stream, loaded.size) || !readValue(stream, loaded.newlines) ||
+       !readValue(stream, partial) || !readValue(stream, sampleCount) ||
+       loaded.newlines > loaded.size || sampleCount != loaded.newlines / loaded.sampling + 1) {
+        return false;
+    }
+    loaded.partialLine = partial != 0;
+
+    // every sample takes at least its delta and every anchor its offset: a damaged count that the
+    // rest of the file cannot hold is rejected before anything is sized by it.
+    const std::uint64_t remaining = remainingBytes(stream);
+    if(sampleCount > remaining / sizeof(std::uint32_t)) {
+        return false;
+    }
+    const std::uint64_t anchorsNeeded = (sampleCount + samplesPerAnchor - 1) / samplesPerAnchor;
+    if(sampleCount * sizeof(std::uint32_t) + (1 + anchorsNeeded) * sizeof(std::uint64_t) > remaining) {
+        return false;
+    }
+
+    loaded.deltas.resize(static_cast<std::size_t>(sampleCount));
+    loaded.wideSamples.clear();
+    for(std::size_t sample = 0; sample < loaded.deltas.size(); sample++) {
+        if(!readValue(stream, loaded.deltas[sample])) {
+            return false;
+        }
+        if(loaded.deltas[sample] == wideDelta) {
+            std::uint64_t offset = 0;
+            if(!readValue(stream, offset) || offset > loaded.size) {
+                return false;
+            }
+            loaded.wideSamples[sample] = offset;
+        }
+    }
+
+    std::uint64_t anchorCount = 0;
+    if(!readValue(stream, anchorCount) || anchorCount != anchorsNeeded) {
+        return false;
+    }
+    loaded.anchors.resize(static_cast<std::size_t>(anchorCount));
+    if(!stream.read(reinterpret_cast<char*>(loaded.anchors.data()),
+                    static_cast<std::streamsize>(anchorCount * sizeof(std::uint64_t)))) {
+        return false;
+    }
+    // lookups search the anchors and offset into the data with them.
+    if(!std::is_sorted(loaded.anchors.begin(), loaded.anchors.end()) || loaded.anchors.front() != 0 ||
+       loaded.anchors.back() > loaded.size) {
+        return false;
+    }
+
+    *this = std::move(loaded);
+    return true;
+}
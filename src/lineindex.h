@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef LINEINDEX_H
+#define LINEINDEX_H
+
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+// newlines in [begin, end), vectorized (AVX2 or SSE2, picked at runtime) where available.
+std::uint64_t countNewlines(const char* begin, const char* end);
+
+
+// where the lines of a log start, so line N is found without counting from the start of the log.
+//
+// only the start of every 'sampling'-th line is kept, and delta-encoded: a 64 bit anchor every
+// 64 samples, and per sample a 32 bit distance from its anchor. at the default sampling that is
+// about 4.1 bytes per 64 lines, 3 MiB for a 50M line log. a line is then at most 'sampling' - 1
+// newlines away from a sample, which is what the lookups count in the log itself.
+//
+// the index is built in one vectorized pass, and extended with what gets appended to the log.
+class LineIndex
+{
+public:
+    static constexpr std::uint32_t defaultSampling = 64;
+
+    explicit LineIndex(std::uint32_t sampling = defaultSampling);
+
+    // indexes what 'data' (the whole log, as it is now) has beyond indexedSize(). the indexed part
+    // has to be unchanged, which is the caller's to ensure.
+    void extend(std::string_view data);
+    void clear();
+
+    std::uint64_t indexedSize() const { return size; }
+    // lines in the indexed part, the last one counts even without a newline.
+    std::uint64_t lineCount() const { return newlines + (partialLine ? 1 : 0); }
+    std::uint32_t samplingInterval() const { return sampling; }
+
+    // start of line 'line' (1 based), false if the indexed part has no such line.
+    // 'data' is the log, as given to extend().
+    bool lineOffset(std::string_view data, std::uint64_t line, std::uint64_t& offset) const;
+    // number (1 based) of the line that byte 'offset' is in.
+    std::uint64_t lineAt(std::string_view data, std::uint64_t offset) const;
+
+    // binary, for the result cache. false if the stream fails, or holds no valid index.
+    bool write(std::ostream& stream) const;
+    bool read(std::istream& stream);
+
+private:
+    static constexpr std::uint32_t samplesPerAnchor = 64;
+    static constexpr std::uint32_t wideDelta = ~std::uint32_t(0);
+
+    std::uint64_t sampleOffset(std::size_t sample) const;
+    void addSample(std::uint64_t offset);
+
+    std::uint32_t sampling;
+    std::uint64_t size = 0;         // bytes indexed
+    std::uint64_t newlines = 0;     // in them
+    bool partialLine = false;       // the indexed part does not end with a newline
+
+    std::vector<std::uint64_t> anchors;
+    std::vector<std::uint32_t> deltas;
+    // samples too far from their anchor for 32 bits (lines of several MiB on average), by sample.
+    std::unordered_map<std::size_t, std::uint64_t> wideSamples;
+};
+
+#endif // #ifndef LINEINDEX_H
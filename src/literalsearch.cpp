@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "literalsearch.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LITERALSEARCH_X86 1
+#include <immintrin.h>
+#else
+#define LITERALSEARCH_X86 0
+#endif
+
+
+namespace
+{
+
+const char* findLiteralPortable(const char* begin, const char* end, std::string_view literal)
+{
+    const std::size_t length = literal.size();
+    const char first = literal[0];
+
+    for(const char* at = begin; static_cast<std::size_t>(end - at) >= length;) {
+        at = static_cast<const char*>(std::memchr(at, first, static_cast<std::size_t>(end - at) - length + 1));
+        if(at == nullptr) {
+            return nullptr;
+        }
+        if(std::memcmp(at + 1, literal.data() + 1, length - 1) == 0) {
+            return at;
+        }
+        at++;
+    }
+    return nullptr;
+}
+
+
+#if LITERALSEARCH_X86
+
+// compare the first and the last byte of the literal against a whole block at once,
+// and only memcmp() the positions where both agree, which are rare in practice.
+// http://0x80.pl/articles/simd-strfind.html
+
+#if defined(__x86_64__) || defined(__SSE2__)
+const char* findLiteralSse2(const char* begin, const char* end, std::string_view literal)
+{
+    const std::size_t length = literal.size();
+    const __m128i first = _mm_set1_epi8(literal[0]);
+    const __m128i last = _mm_set1_epi8(literal[length - 1]);
+
+    const char* at = begin;
+    for(; static_cast<std::size_t>(end - at) >= 16 + length - 1; at += 16) {
+        const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at));
+        const __m128i blockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(at + length - 1));
+        unsigned int mask = static_cast<unsigned int>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+        while(mask != 0) {
+            const unsigned int bit = static_cast<unsigned int>(__builtin_ctz(mask));
+            if(std::memcmp(at + bit + 1, literal.data() + 1, length - 1) == 0) {
+                return at + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralPortable(at, end, literal);
+}
+#endif // #if defined(__x86_64__) || defined(__SSE2__)
+
+
+__attribute__((target("avx2")))
+const char* findLiteralAvx2(const char* begin, const char* end, std::string_view literal)
+{
+    const std::size_t length = literal.size();
+    const __m256i first = _mm256_set1_epi8(literal[0]);
+    const __m256i last = _mm256_set1_epi8(literal[length - 1]);
+
+    const char* at = begin;
+    for(; static_cast<std::size_t>(end - at) >= 32 + length - 1; at += 32) {
+        const __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at));
+        const __m256i blockLast = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at + length - 1));
+        std::uint32_t mask = static_cast<std::uint32_t>(
+            _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst),
+                                                  _mm256_cmpeq_epi8(last, blockLast))));
+        while(mask != 0) {
+            const unsigned int bit = static_cast<unsigned int>(__builtin_ctz(mask));
+            if(std::memcmp(at + bit + 1, literal.data() + 1, length - 1) == 0) {
+                return at + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findLiteralPortable(at, end, literal);
+}
+
+#endif // #if LITERALSEARCH_X86
+
+
+using FindLiteralFunction = const char* (*)(const char*, const char*, std::string_view);
+
+struct Implementation
+{
+    FindLiteralFunction function;
+    const char* name;
+};
+
+
+Implementation selectImplementation()
+{
+#if LITERALSEARCH_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+        return Implementation{findLiteralAvx2, "avx2"};
+    }
+#if defined(__x86_64__) || defined(__SSE2__)
+    return Implementation{findLiteralSse2, "sse2"};
+#endif
+#endif // #if LITERALSEARCH_X86
+    return Implementation{findLiteralPortable, "portable"};
+}
+
+
+const Implementation& implementation()
+{
+    static const Implementation selected = selectImplementation();
+    return selected;
+}
+
+} // namespace
+
+
+const char* findLiteral(const char* begin, const char* end, std::string_view literal)
+{
+    if(literal.empty()) {
+        return begin;
+    }
+    if(static_cast<std::size_t>(end - begin) < literal.size()) {
+        return nullptr;
+    }
+    return implementation().function(begin, end, literal);
+}
+
+
+const char* literalSearchImplementation()
+{
+    return implementation().name;
+}
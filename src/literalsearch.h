@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef LITERALSEARCH_H
+#define LITERALSEARCH_H
+
+#include <string_view>
+
+
+// find the first occurrence of 'literal' in [begin, end), or nullptr.
+// vectorized (AVX2 or SSE2, picked at runtime) where available, with a portable fallback.
+const char* findLiteral(const char* begin, const char* end, std::string_view literal);
+
+// name of the implementation findLiteral() uses on this machine: "avx2", "sse2" or "portable".
+const char* literalSearchImplementation();
+
+#endif // #ifndef LITERALSEARCH_H
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "logfollower.h"
+#include "mappedfile.h"
+
+#include <algorithm>
+#include <fstream>
+
+
+LogFollower::LogFollower(const std::string& filepath)
+    : filepath(filepath)
+{
+}
+
+
+void LogFollower::reset()
+{
+    position = LogScanner::AppendedPosition();
+    readUntil = 0;
+    fileId = 0;
+    fingerprint.clear();
+}
+
+
+LogFollower::Update LogFollower::poll(const LogScanner& scanner, const LogScanner::MatchCallback& callback)
+{
+    // read, never mapped: the pages of a mapping past the end of a log that is truncated under it
+    // fault (SIGBUS) when touched. a log that shrinks while it is read just ends early.
+    std::uint64_t size = 0;
+    std::uint64_t id = 0;
+    if(!fileSizeAndId(filepath, size, id)) {
+        return Update::Missing;
+    }
+    std::ifstream stream(filepath, std::ios::in | std::ios::binary);
+    if(!stream.good()) {
+        return Update::Missing;
+    }
+
+    if(readUntil == 0) {
+        // nothing read yet, so nothing to lose if this is not the file we saw last time.
+        fileId = id;
+    }
+    else {
+        std::string head(fingerprint.size(), '\0');
+        if(id != fileId || size < readUntil || !stream.read(head.data(), static_cast<std::streamsize>(head.size())) ||
+           head != fingerprint) {
+            reset();
+            return Update::Restarted;
+        }
+    }
+
+    if(size == readUntil) {
+        return Update::Unchanged;
+    }
+
+    stream.seekg(static_cast<std::streamoff>(position.lineStart));
+    LogScanner::AppendedPosition scanned = position;
+    if(!stream.good() || !scanner.scanAppended(stream, size, scanned, callback)) {
+        return Update::Stopped;
+    }
+
+    const bool moved = scanned.searchFrom != position.searchFrom || scanned.lineStart != position.lineStart;
+    position = scanned;
+    readUntil = size;
+    if(fingerprint.size() < fingerprintSize) {
+        fingerprint.resize(static_cast<std::size_t>(std::min<std::uint64_t>(fingerprintSize, readUntil)));
+        stream.clear();
+        stream.seekg(0);
+        if(!stream.read(fingerprint.data(), static_cast<std::streamsize>(fingerprint.size()))) {
+            reset();
+            return Update::Restarted;
+        }
+    }
+    return moved ? Update::Appended : Update::Unchanged;
+}
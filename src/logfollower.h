@@ -0,0 +1,61 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef LOGFOLLOWER_H
+#define LOGFOLLOWER_H
+
+#include <cstdint>
+#include <string>
+
+#include "logscanner.h"
+
+
+// follows a log that is still being written, like 'tail -f'.
+//
+// every poll() reads only what was appended since the previous poll, through the scanner's chunk
+// buffer, so the cost of a refresh is proportional to the new data, not to the size of the log.
+// the log is never mapped, a mapping of a file that is truncated under it faults when touched.
+// a trailing line without its newline yet, and a match that runs into the end of what is there
+// (a stage header whose value is on the next line, not written yet), are left for the next poll,
+// so a match is never cut in half by a writer. with the std::regex backend, which cannot tell
+// where a match is cut off, a match that runs over a line boundary can still be missed.
+//
+// a log that got truncated (copytruncate) or replaced (rename/create rotation) is detected by
+// its size, its file id and a fingerprint of its first bytes, and is then scanned again from
+// the start.
+class LogFollower
+{
+public:
+    enum class Update
+    {
+        Unchanged,  // nothing new
+        Appended,   // new lines were scanned
+        Restarted,  // the log was truncated or replaced, the next poll() scans it from the start
+        Missing,    // the log does not exist (e.g. between rotation and re-creation), or cannot be read
+        Stopped,    // the scan was stopped by a callback or a read failed, the lines are scanned again next time
+    };
+
+    explicit LogFollower(const std::string& filepath);
+
+    // the offsets and line numbers of the matches are those in the whole log,
+    // the bytes passed to the scanner's progress callback count from scannedUntil().
+    Update poll(const LogScanner& scanner, const LogScanner::MatchCallback& callback);
+
+    // forget everything, the next poll() scans the log from the start.
+    void reset();
+
+    const std::string& path() const { return filepath; }
+    // file offset from which the next poll() reads, the start of a line.
+    std::uint64_t scannedUntil() const { return position.lineStart; }
+
+private:
+    // the first bytes of the log are remembered, so a replaced log of a similar size is noticed.
+    static constexpr std::size_t fingerprintSize = 256;
+
+    std::string filepath;
+    LogScanner::AppendedPosition position;
+    std::uint64_t readUntil = 0;        // size of the log at the last poll
+    std::uint64_t fileId = 0;
+    std::string fingerprint;
+};
+
+#endif // #ifndef LOGFOLLOWER_H
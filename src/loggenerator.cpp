@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "loggenerator.h"
+
+#include <algorithm>
+#include <fstream>
+
+
+namespace
+{
+
+// filler, none of which can form a stage header or a value line.
+constexpr const char* words[] = {
+    "compiling", "linking", "src/module.cpp", "object", "cache", "hit", "miss", "done", "info",
+    "debug", "timing", "ms", "checking", "dependencies", "of", "target", "for", "the", "warnings",
+    "generated", "0x7ffd3c", "[100%]", "built", "scanning", "files", "in", "--", "ok",
+};
+constexpr std::size_t wordCount = sizeof(words) / sizeof(words[0]);
+
+// the spellings of testfiles/test1.log.
+constexpr const char* valueFormats[][2] = {
+    {"  number of errors : ", ""},
+    {"  number of errors :", ""},
+    {"  number of errors: ", ""},
+    {"  number of errors: ", " found"},
+};
+constexpr std::size_t valueFormatCount = sizeof(valueFormats) / sizeof(valueFormats[0]);
+
+// flush to the stream in blocks of about this size.
+constexpr std::size_t blockSize = 1024 * 1024;
+
+
+// splitmix64, small and the same everywhere.
+class Random
+{
+public:
+    explicit Random(std::uint64_t seed) : state(seed) {}
+
+    std::uint64_t next()
+    {
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // in [0, bound)
+    std::uint64_t below(std::uint64_t bound) { return (bound == 0) ? 0 : next() % bound; }
+
+    // in [0, 1)
+    double unit() { return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+private:
+    std::uint64_t state;
+};
+
+} // namespace
+
+
+void generateLog(std::ostream& stream, const LogGeneratorOptions& options, LogGeneratorStats& stats)
+{
+    Random random(options.seed);
+    stats = LogGeneratorStats();
+
+    std::string block;
+    block.reserve(blockSize + 4096);
+    std::size_t lineInStage = options.stageLines;
+
+    while(stats.bytes < options.size) {
+        const std::size_t lineStart = block.size();
+
+        if(lineInStage >= options.stageLines) {
+            lineInStage = 0;
+            stats.stages++;
+            if(stats.stages > 1) {
+                block += '\n';
+                stats.lines++;
+            }
+            block += "stage " + std::to_string(stats.stages) + ":";
+        }
+        else if(random.unit() < options.density) {
+            const auto& format = valueFormats[random.below(valueFormatCount)];
+            block += format[0];
+            block += std::to_string(random.below(1000));
+            block += format[1];
+            stats.values++;
+        }
+        else {
+            // uniform in [lineLength / 2, lineLength * 3 / 2]
+            const std::size_t length = options.lineLength / 2 + random.below(options.lineLength + 1);
+            block += "  ";
+            while(block.size() - lineStart < length) {
+                block += words[random.below(wordCount)];
+                block += ' ';
+            }
+            block.resize(std::max(lineStart + length, lineStart + 3));
+        }
+        block += '\n';
+        lineInStage++;
+        stats.lines++;
+        stats.bytes += block.size() - lineStart;
+
+        if(block.size() >= blockSize) {
+            stream.write(block.data(), static_cast<std::streamsize>(block.size()));
+            block.clear();
+        }
+    }
+    stream.write(block.data(), static_cast<std::streamsize>(block.size()));
+}
+
+
+bool generateLog(const std::string& filepath, const LogGeneratorOptions& options, LogGeneratorStats& stats)
+{
+    std::ofstream stream(filepath, std::ios::binary | std::ios::trunc);
+    if(!stream) {
+        return false;
+    }
+    generateLog(stream, options, stats);
+    stream.flush();
+    return static_cast<bool>(stream);
+}
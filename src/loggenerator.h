@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef LOGGENERATOR_H
+#define LOGGENERATOR_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+
+struct LogGeneratorOptions
+{
+    std::uint64_t size = 1024 * 1024;   // bytes, the last line may go a little over
+    double density = 0.05;              // fraction of the lines that are "number of errors : N"
+    std::size_t lineLength = 80;        // average length of the other lines
+    std::size_t stageLines = 200;       // lines per "stage N:" block
+    std::uint64_t seed = 1;
+};
+
+
+// what was generated, for checking a scan of it.
+struct LogGeneratorStats
+{
+    std::uint64_t bytes = 0;
+    std::uint64_t lines = 0;
+    std::uint64_t stages = 0;
+    std::uint64_t values = 0;           // "number of errors" lines
+};
+
+
+// writes a synthetic log in the format of testfiles/test1.log: "stage N:" blocks of filler lines
+// with "number of errors : N" lines (in the spellings found in real logs) among them.
+//
+// the output only depends on the options, on every platform (the random numbers do not come from
+// <random>, whose distributions differ between standard libraries), so logs of any size can be
+// generated again instead of being kept around.
+void generateLog(std::ostream& stream, const LogGeneratorOptions& options, LogGeneratorStats& stats);
+
+// returns false if the file cannot be written.
+bool generateLog(const std::string& filepath, const LogGeneratorOptions& options, LogGeneratorStats& stats);
+
+#endif // #ifndef LOGGENERATOR_H
@@ -0,0 +1,582 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "logscanner.h"
+#include "mappedfile.h"
+#include "literalsearch.h"
+#include "decompressor.h"
+#include "lineindex.h"
+#include "scanmetrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// offset of the start of the last (partial) line in [begin, begin + size).
+static std::size_t trailingLineStart(const char* begin, std::size_t size)
+{
+    const auto lastNewline = std::find(std::make_reverse_iterator(begin + size),
+                                       std::make_reverse_iterator(begin),
+                                       '\n');
+    return static_cast<std::size_t>(lastNewline.base() - begin);
+}
+
+
+// count the newlines of the chunk (at bufferOffset) up to 'until', from where counting stopped.
+static void countNewlinesUntil(const char* begin, std::uint64_t bufferOffset, std::uint64_t until,
+                               std::uint64_t& countedUntil, std::uint64_t& newlines)
+{
+    if(until > countedUntil) {
+        newlines += countNewlines(begin + (countedUntil - bufferOffset), begin + (until - bufferOffset));
+        countedUntil = until;
+    }
+}
+
+
+LogScanner::LogScanner(const std::string& pattern, std::size_t chunkSize, MatcherBackend backend)
+    : matcher(createMatcher(pattern, backend)),
+      literalPrefixes(requiredLiteralPrefixes(pattern)),
+      chunkSize(std::max(chunkSize, minimumChunkSize))
+{
+}
+
+
+bool LogScanner::scanStream(std::istream& stream, const MatchCallback& callback) const
+{
+    return scanStreamed(stream, callback, progressCallback);
+}
+
+
+bool LogScanner::scanStreamed(std::istream& stream, const MatchCallback& callback,
+                              const ProgressCallback& progress) const
+{
+    ChunkState state;
+    return scanStreamedUntil(stream, ~std::uint64_t(0), nullptr, state, callback, progress);
+}
+
+
+bool LogScanner::scanAppended(std::istream& stream, std::uint64_t until, AppendedPosition& position,
+                              const MatchCallback& callback) const
+{
+    const AppendedPosition start = position;
+    ChunkState state;
+    state.countedUntil = start.lineStart;
+    state.reportedUntil = start.searchFrom;
+
+    ProgressCallback progress;
+    if(progressCallback) {
+        progress = [this, &start](std::uint64_t offset) {
+            return progressCallback(offset - start.lineStart);
+        };
+    }
+
+    AppendedPosition rest;
+    const bool completed = scanStreamedUntil(stream, until, &rest, state,
+                                             [&callback, &start](const ScanMatch& match) {
+                                                 ScanMatch shifted = match;
+                                                 shifted.line += start.lines;
+                                                 return callback(shifted);
+                                             },
+                                             progress);
+    if(!completed) {
+        return false;
+    }
+    position.lineStart = rest.lineStart;
+    position.lines = start.lines + rest.lines;
+    position.searchFrom = rest.searchFrom;
+    return true;
+}
+
+
+bool LogScanner::scanStreamedUntil(std::istream& stream, std::uint64_t until, AppendedPosition* rest,
+                                   ChunkState& state, const MatchCallback& callback,
+                                   const ProgressCallback& progress) const
+{
+    // the only allocations for the whole scan.
+    std::vector<char> buffer(chunkSize);
+    SCAN_METRICS_ADD(Allocations, 1);
+
+    std::size_t carry = 0;              // bytes at the front of the buffer, kept from the previous chunk
+    std::uint64_t bufferOffset = state.countedUntil;    // file offset of buffer[0]
+    bool eof = false;
+
+    while(!eof) {
+
+        const std::uint64_t wanted = std::min<std::uint64_t>(buffer.size() - carry, until - (bufferOffset + carry));
+        {
+            SCAN_METRICS_TIMED_SPAN("read", IoWaitNanoseconds);
+            stream.read(buffer.data() + carry, static_cast<std::streamsize>(wanted));
+        }
+        SCAN_METRICS_ADD(BytesRead, static_cast<std::uint64_t>(stream.gcount()));
+        const std::size_t size = carry + static_cast<std::size_t>(stream.gcount());
+        if(stream.bad()) {
+            return false;
+        }
+        eof = stream.eof() || bufferOffset + size == until;
+        const bool final = eof && rest == nullptr;
+
+        const char* begin = buffer.data();
+
+        // by default, carry the trailing partial line over into the next chunk.
+        std::size_t keepFrom = final ? size : trailingLineStart(begin, size);
+        // at the end of a log that goes on, its last line is not complete yet.
+        const std::size_t lastLine = keepFrom;
+        if(eof && !final) {
+            state.reportLimit = bufferOffset + lastLine;
+        }
+
+        if(!matchChunk(begin, size, bufferOffset, final, keepFrom, state, callback)) {
+            return false;
+        }
+
+        if(eof && !final) {
+            keepFrom = std::min(keepFrom, lastLine);
+            const std::size_t lineStart = trailingLineStart(begin, keepFrom);
+            countNewlinesUntil(begin, bufferOffset, bufferOffset + lineStart, state.countedUntil, state.newlines);
+            rest->lineStart = bufferOffset + lineStart;
+            rest->lines = state.newlines;
+            rest->searchFrom = std::max(bufferOffset + keepFrom, state.reportedUntil);
+        }
+
+        if(progress && !progress(bufferOffset + (final ? size : keepFrom))) {
+            return false;
+        }
+
+        if(eof) {
+            break;
+        }
+
+        // a single line longer than the buffer: keep the buffer budget fixed, and carry over
+        // only the last half of the chunk.
+        if(size - keepFrom > buffer.size() / 2) {
+            keepFrom = size - buffer.size() / 2;
+        }
+
+        // the part of the chunk that is dropped has to be counted now.
+        countNewlinesUntil(begin, bufferOffset, bufferOffset + keepFrom, state.countedUntil, state.newlines);
+
+        carry = size - keepFrom;
+        std::memmove(buffer.data(), begin + keepFrom, carry);
+        bufferOffset += keepFrom;
+    }
+
+    return true;
+}
+
+
+bool LogScanner::scanView(std::string_view data, const MatchCallback& callback) const
+{
+    unsigned int threads = threadCount;
+    if(threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    SCAN_METRICS_ADD(BytesRead, data.size());
+
+    if(threads > 1 && data.size() > chunkSize) {
+        return scanParallel(data, threads, callback);
+    }
+
+    ChunkState state;
+    return scanWindowed(data, 0, data.size(), state, callback, true);
+}
+
+
+bool LogScanner::scanRange(std::string_view data, std::size_t from, std::size_t until,
+                           const MatchCallback& callback) const
+{
+    ChunkState state;
+    return scanWindowed(data, from, std::min(until, data.size()), state, callback, true);
+}
+
+
+bool LogScanner::scanWindowed(std::string_view data, std::size_t from, std::size_t until, ChunkState& state,
+                              const MatchCallback& callback, bool reportProgress) const
+{
+    // the first chunk starts at the start of the line, for \b and the line count.
+    std::size_t chunkBegin = trailingLineStart(data.data(), from);
+    state.reportedUntil = from;
+    state.reportLimit = until;
+    state.countedUntil = chunkBegin;
+    state.newlines = 0;
+    if(from >= until) {
+        return true;
+    }
+
+    // the windows end at 'until', unless a match (or a partial one) starting before it runs past it.
+    std::size_t windowEnd = until;
+
+    // same chunking as the streaming reader, but the 'chunks' are windows over the data in place.
+    for(;;) {
+        const std::size_t size = std::min(chunkSize, windowEnd - chunkBegin);
+        const bool final = (chunkBegin + size == data.size());
+        const char* begin = data.data() + chunkBegin;
+
+        std::size_t keepFrom = final ? size : trailingLineStart(begin, size);
+
+        if(!matchChunk(begin, size, chunkBegin, final, keepFrom, state, callback)) {
+            return false;
+        }
+
+        if(reportProgress && progressCallback && !progressCallback(chunkBegin + (final ? size : keepFrom))) {
+            return false;
+        }
+
+        if(!final && size - keepFrom > chunkSize / 2) {
+            keepFrom = size - chunkSize / 2;
+        }
+
+        if(final || chunkBegin + keepFrom >= until) {
+            countNewlinesUntil(begin, chunkBegin, until, state.countedUntil, state.newlines);
+            break;
+        }
+
+        countNewlinesUntil(begin, chunkBegin, chunkBegin + keepFrom, state.countedUntil, state.newlines);
+        if(chunkBegin + size == until) {
+            windowEnd = data.size();
+        }
+        chunkBegin += keepFrom;
+    }
+
+    return true;
+}
+
+
+bool LogScanner::scanParallel(std::string_view data, unsigned int threads,
+                              const MatchCallback& callback) const
+{
+    // several shards per thread, so that a slow shard does not leave the other threads idle,
+    // but large enough that the per shard overhead does not matter.
+    const std::size_t shardSize = std::max(chunkSize, data.size() / (threads * 8) + 1);
+
+    // split at newline boundaries: each shard ends just after a newline (or at the end of data).
+    // a shard only reports the matches that start in it, but reads on to complete them.
+    std::vector<std::pair<std::size_t, std::size_t>> shards;
+    for(std::size_t shardBegin = 0; shardBegin < data.size();) {
+        std::size_t shardEnd = std::min(shardBegin + shardSize, data.size());
+        if(shardEnd < data.size()) {
+            const char* newline = static_cast<const char*>(
+                std::memchr(data.data() + shardEnd, '\n', data.size() - shardEnd));
+            shardEnd = newline ? static_cast<std::size_t>(newline - data.data()) + 1 : data.size();
+        }
+        shards.emplace_back(shardBegin, shardEnd);
+        shardBegin = shardEnd;
+    }
+
+    // matches are kept with their groups flattened into one vector per shard,
+    // and line numbers relative to the start of the shard.
+    struct ShardResult
+    {
+        std::vector<ScanMatch> matches;
+        std::vector<std::string_view> groups;
+        std::uint64_t newlines = 0;
+        bool done = false;
+    };
+    std::vector<ShardResult> results(shards.size());
+
+    std::mutex mutex;
+    std::condition_variable shardDone;
+    std::atomic<std::size_t> nextShard{0};
+    std::atomic<bool> stop{false};
+
+    // the matches of [from, until) into 'shard'.
+    auto scanShard = [this, data, &stop](ShardResult& shard, std::size_t from, std::size_t until) {
+        ChunkState state;
+        scanWindowed(data, from, until, state,
+                     [&shard, &stop](const ScanMatch& match) {
+#if QUETZALCOATLUS_SCAN_METRICS
+                        if(shard.matches.size() == shard.matches.capacity()) {
+                            ScanMetrics::add(ScanMetrics::Allocations, 1);
+                        }
+                        if(shard.groups.size() + match.groupCount > shard.groups.capacity()) {
+                            ScanMetrics::add(ScanMetrics::Allocations, 1);
+                        }
+#endif
+                        shard.matches.push_back(match);
+                        shard.matches.back().groups = nullptr;
+                        shard.groups.insert(shard.groups.end(), match.groups, match.groups + match.groupCount);
+                        return !stop;
+                     },
+                     false);
+        return state.newlines;
+    };
+
+    // shards are picked up in file order, so the front of the file is ready first,
+    // and the matches can be handed over while the rest is still being scanned.
+    auto worker = [&]() {
+        for(std::size_t index = nextShard++; index < shards.size() && !stop; index = nextShard++) {
+            SCAN_METRICS_SPAN("shard");
+            ShardResult shard;
+            shard.newlines = scanShard(shard, shards[index].first, shards[index].second);
+            shard.done = true;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            results[index] = std::move(shard);
+            shardDone.notify_all();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    const unsigned int poolSize = static_cast<unsigned int>(std::min<std::size_t>(threads, shards.size()));
+    for(unsigned int i = 0; i < poolSize; i++) {
+        pool.emplace_back(worker);
+    }
+
+    // merge: hand over the matches shard by shard, in file order.
+    // the captures point into 'data', which outlives the scan.
+    bool completed = true;
+    std::uint64_t newlinesBefore = 0;
+    std::uint64_t reportedUntil = 0;
+    for(std::size_t index = 0; index < shards.size() && completed; index++) {
+        ShardResult shard;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            shardDone.wait(lock, [&]() { return results[index].done; });
+            shard = std::move(results[index]);
+        }
+
+        // the last match of the shards before ran on into this one, past where this one's first
+        // match starts: scan it again from the end of that match, as the serial scan does.
+        std::uint64_t linesBefore = newlinesBefore;
+        if(!shard.matches.empty() && shard.matches.front().offset < reportedUntil) {
+            const std::size_t from = static_cast<std::size_t>(reportedUntil);
+            const std::uint64_t newlines = shard.newlines;
+            shard = ShardResult();
+            scanShard(shard, from, shards[index].second);
+            shard.newlines = newlines;
+            linesBefore += countNewlines(data.data() + shards[index].first, data.data() + from);
+        }
+
+        std::size_t groupIndex = 0;
+        for(ScanMatch& match : shard.matches) {
+            match.line += linesBefore;
+            match.groups = shard.groups.data() + groupIndex;
+            groupIndex += match.groupCount;
+            reportedUntil = match.offset + match.length;
+            if(!callback(match)) {
+                completed = false;
+                break;
+            }
+        }
+        newlinesBefore += shard.newlines;
+
+        const std::uint64_t bytesScanned = shards[index].second;
+        if(completed && progressCallback && !progressCallback(bytesScanned)) {
+            completed = false;
+        }
+    }
+
+    stop = true;
+    for(std::thread& thread : pool) {
+        thread.join();
+    }
+
+    return completed;
+}
+
+
+bool LogScanner::matchChunk(const char* begin, std::size_t size, std::uint64_t bufferOffset, bool final,
+                            std::size_t& keepFrom, ChunkState& state, const MatchCallback& callback) const
+{
+    SCAN_METRICS_TIMED_SPAN("match chunk", MatchNanoseconds);
+    const char* end = begin + size;
+    MatchResult& result = state.result;
+    state.literalHits.assign(literalPrefixes.size(), nullptr);
+    // the streaming reader refills the same buffer for every chunk.
+    result.subjectChanged();
+    result.subjectContinues = !final;
+
+#if QUETZALCOATLUS_SCAN_METRICS
+    // added once per chunk, however it ends.
+    std::uint64_t matches = 0;
+    struct MetricsFlush
+    {
+        ChunkState& state;
+        std::uint64_t& matches;
+        ~MetricsFlush()
+        {
+            ScanMetrics::add(ScanMetrics::Candidates, state.candidates);
+            ScanMetrics::add(ScanMetrics::Matches, matches);
+            state.candidates = 0;
+        }
+    } metricsFlush{state, matches};
+#endif
+
+    // an attempt that ran into the end of the chunk, from before the limit and not after the match
+    // found, might match (or match something else) once the next chunk is in: it starts there.
+    auto partialPending = [&](const char* until) {
+        return !final && result.partialBegin != nullptr && result.partialBegin <= until &&
+               bufferOffset + static_cast<std::uint64_t>(result.partialBegin - begin) < state.reportLimit;
+    };
+
+    // what was reported from the carried over part of the previous chunk is not searched again.
+    const char* from = begin;
+    if(state.reportedUntil > bufferOffset) {
+        from += std::min<std::uint64_t>(state.reportedUntil - bufferOffset, size);
+    }
+    while(from <= end) {
+        if(!nextMatch(begin, end, from, state)) {
+            if(partialPending(end)) {
+                keepFrom = std::min(keepFrom, static_cast<std::size_t>(result.partialBegin - begin));
+            }
+            break;
+        }
+        const std::size_t matchBegin = static_cast<std::size_t>(result.begin() - begin);
+        const std::size_t matchEnd = static_cast<std::size_t>(result.end() - begin);
+
+        // continue after the match, stepping over empty matches.
+        from = (matchEnd == matchBegin) ? result.end() + 1 : result.end();
+
+        if(partialPending(result.begin())) {
+            keepFrom = std::min(keepFrom, static_cast<std::size_t>(result.partialBegin - begin));
+            break;
+        }
+
+        // everything before the limit is done, the rest is left to whoever scans on from there.
+        if(bufferOffset + matchBegin >= state.reportLimit) {
+            keepFrom = size;
+            break;
+        }
+
+        // a match running up to the end of the chunk might continue in the next one
+        // (e.g. more digits), so defer it until the next chunk is in.
+        if(!final && matchEnd == size) {
+            keepFrom = std::min(keepFrom, matchBegin);
+            break;
+        }
+
+        // already reported from the carried over part of the previous chunk.
+        if(bufferOffset + matchBegin < state.reportedUntil) {
+            continue;
+        }
+
+        countNewlinesUntil(begin, bufferOffset, bufferOffset + matchBegin, state.countedUntil, state.newlines);
+
+        state.groups.resize(result.groupCount());
+        for(std::size_t group = 0; group < result.groupCount(); group++) {
+            state.groups[group] = result.view(group);
+        }
+
+        ScanMatch match;
+        match.offset = bufferOffset + matchBegin;
+        match.length = matchEnd - matchBegin;
+        match.line = state.newlines + 1;
+        match.capture = result.view(1);
+        match.groups = state.groups.data();
+        match.groupCount = state.groups.size();
+        state.reportedUntil = bufferOffset + matchEnd;
+#if QUETZALCOATLUS_SCAN_METRICS
+        matches++;
+#endif
+
+        if(!callback(match)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+bool LogScanner::nextMatch(const char* begin, const char* end, const char* from, ChunkState& state) const
+{
+    if(literalPrefixes.empty()) {
+#if QUETZALCOATLUS_SCAN_METRICS
+        state.candidates++;
+#endif
+        return matcher->search(begin, end, from, state.result);
+    }
+
+    // the earliest partial match of any of the candidates.
+    const char* partial = nullptr;
+    for(;;) {
+        // earliest occurrence of any of the literals, each literal is only searched for again
+        // once the scan has moved past its last occurrence.
+        const char* candidate = end;
+        for(std::size_t i = 0; i < literalPrefixes.size(); i++) {
+            const char*& hit = state.literalHits[i];
+            if(hit == nullptr || hit < from) {
+                hit = findLiteral(from, end, literalPrefixes[i]);
+                if(hit == nullptr) {
+                    hit = end;
+                }
+            }
+            candidate = std::min(candidate, hit);
+        }
+
+        // the literals are never empty, so nothing can match at the very end.
+        if(candidate == end) {
+            state.result.partialBegin = partial;
+            return false;
+        }
+#if QUETZALCOATLUS_SCAN_METRICS
+        state.candidates++;
+#endif
+        const bool matched = matcher->matchAt(begin, end, candidate, state.result);
+        partial = (partial != nullptr) ? partial : state.result.partialBegin;
+        if(matched) {
+            state.result.partialBegin = partial;
+            return true;
+        }
+        from = candidate + 1;
+    }
+}
+
+
+bool LogScanner::scanFile(const std::string& filepath, const MatchCallback& callback) const
+{
+    SCAN_METRICS_SPAN("scan file");
+    const Compression compression = detectCompression(filepath);
+    if(compression != Compression::None) {
+        if(!compressionSupported(compression)) {
+            return false;
+        }
+
+        DecompressingStreamBuf decompressor(filepath, compression);
+        std::istream stream(&decompressor);
+        ProgressCallback progress;
+        if(progressCallback) {
+            progress = [this, &decompressor](std::uint64_t) {
+                return progressCallback(decompressor.compressedBytesRead());
+            };
+        }
+        return scanStreamed(stream, callback, progress) && !decompressor.failed();
+    }
+
+    if(scanMode != ScanMode::Streamed) {
+        MappedFile mappedFile;
+        if(mappedFile.open(filepath)) {
+            return scanView(mappedFile.view(), callback);
+        }
+        if(scanMode == ScanMode::Mapped) {
+            return false;
+        }
+    }
+
+    std::ifstream stream(filepath, std::ios::in | std::ios::binary);
+    if(!stream.good()) {
+        return false;
+    }
+
+    return scanStream(stream, callback);
+}
+
+
+bool LogScanner::findFirst(const std::string& filepath, std::string& value) const
+{
+    bool found = false;
+
+    scanFile(filepath,
+             [&](const ScanMatch& match) {
+                value.assign(match.capture);
+                found = true;
+                return false;
+             });
+
+    return found;
+}
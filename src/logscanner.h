@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef LOGSCANNER_H
+#define LOGSCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "matcher.h"
+#include "quetzalcoatlus_config.h"
+
+
+// a single match reported by the LogScanner.
+// 'capture' and 'groups' point into the scanner's buffer and are only valid for the duration of
+// the callback, copy them out if they need to outlive the callback.
+struct ScanMatch
+{
+    std::uint64_t offset = 0;       // byte offset of the start of the match in the file
+    std::uint64_t length = 0;       // length of the whole match in bytes
+    std::uint64_t line = 0;         // line number (1 based) of the start of the match
+    std::string_view capture;       // first capture group of the pattern (empty if none)
+
+    // all groups, [0] is the whole match. a group that did not take part in the match
+    // has a nullptr data().
+    const std::string_view* groups = nullptr;
+    std::size_t groupCount = 0;
+
+    std::string_view group(std::size_t index) const
+    {
+        return (index < groupCount) ? groups[index] : std::string_view();
+    }
+};
+
+
+// scans a log for a pattern using a fixed size buffer, so that the memory used
+// stays the same regardless of the size of the log.
+//
+// the log is read chunk by chunk, and the trailing partial line of each chunk is carried over
+// to the front of the buffer for the next chunk, so matches straddling a chunk boundary are
+// still found (and reported only once). a match can also run over several lines (\s matches a
+// newline): the matcher reports where the earliest attempt that ran into the end of the chunk
+// began, and the carry starts there instead. std::regex cannot tell, so with that backend a
+// match that runs over a line boundary and is cut by a chunk boundary is missed.
+//
+// regular files are memory mapped by default and matched in place without any copy,
+// anything that cannot be mapped (pipes, special files) falls back to the streaming reader.
+// gzip and zstd compressed logs are streamed through a decompressor running on its own thread,
+// offsets, line numbers and matches are then those of the decompressed log, and progress is
+// reported in compressed bytes, so it still adds up to the size of the file.
+// mapped files are still walked chunk by chunk, so progress is reported the same way.
+//
+// with more than one thread, a mapped file is split into newline aligned shards which are
+// matched on a pool of threads, and the matches are handed to the callback in file order,
+// so the results are identical to the serial scan. a shard reports the matches that start in
+// it, reading on into the next one to complete them (see scanRange()).
+//
+// if every match of the pattern has to start with one of a few literals (e.g. "errors"),
+// the literals are found with a vectorized search first, and the matcher only ever runs
+// anchored at those positions, so most of the log is only touched at memory bandwidth.
+class LogScanner
+{
+public:
+    enum class ScanMode
+    {
+        Auto,       // map the file if possible, otherwise stream it
+        Mapped,     // map the file, fail if it cannot be mapped
+        Streamed,   // always stream the file through the chunk buffer
+    };
+
+    // return false from the callback to stop scanning.
+    using MatchCallback = std::function<bool(const ScanMatch& match)>;
+    // called after each chunk with the bytes scanned so far, return false to cancel the scan.
+    using ProgressCallback = std::function<bool(std::uint64_t bytesScanned)>;
+
+    static constexpr std::size_t defaultChunkSize = 4 * 1024 * 1024;
+    static constexpr std::size_t minimumChunkSize = 4 * 1024;
+
+    // throws std::regex_error if the pattern is not valid.
+    explicit LogScanner(const std::string& pattern, std::size_t chunkSize = defaultChunkSize,
+                        MatcherBackend backend = MatcherBackend::Builtin);
+
+    void setScanMode(ScanMode mode) { scanMode = mode; }
+    ScanMode mode() const { return scanMode; }
+
+    void setProgressCallback(ProgressCallback callback) { progressCallback = std::move(callback); }
+
+    // number of threads used to scan a mapped file, 0 means one per hardware thread.
+    void setThreadCount(unsigned int count) { threadCount = count; }
+
+    // returns false if the scan was stopped by a callback, or on a read error.
+    bool scanStream(std::istream& stream, const MatchCallback& callback) const;
+    bool scanView(std::string_view data, const MatchCallback& callback) const;
+    bool scanFile(const std::string& filepath, const MatchCallback& callback) const;
+
+    // the matches that start in [from, until) of 'data', on the calling thread. the rest of
+    // 'data' is only read to complete a match that runs on past 'until'.
+    // 'from' and 'until' are line starts (or the end of the data), offsets are those in 'data',
+    // and line numbers are counted from the line of 'from'.
+    bool scanRange(std::string_view data, std::size_t from, std::size_t until, const MatchCallback& callback) const;
+
+    // how far the scan of a log that is still being written got, see scanAppended().
+    struct AppendedPosition
+    {
+        std::uint64_t lineStart = 0;    // the next scan reads from here, the start of a line (unless
+                                        // that line is longer than half a chunk)
+        std::uint64_t lines = 0;        // newlines before lineStart
+        std::uint64_t searchFrom = 0;   // the matches before this were reported already
+    };
+
+    // scans a log that is still being written, from 'position' up to 'until', reading it from
+    // 'stream' (at position.lineStart) through the chunk buffer. as scanStream(), except that the
+    // log goes on: only the matches that start in complete lines, and that nothing appended can
+    // change, are reported. a match that runs into the end is left to the next scan, and
+    // 'position' is moved on to where that starts (only if the scan completes). offsets and line
+    // numbers are those in the whole log, the progress callback counts from position.lineStart.
+    bool scanAppended(std::istream& stream, std::uint64_t until, AppendedPosition& position,
+                      const MatchCallback& callback) const;
+
+    // convenience: get the first capture of the first match in the file.
+    bool findFirst(const std::string& filepath, std::string& value) const;
+
+    const Matcher& patternMatcher() const { return *matcher; }
+
+private:
+    // state carried from chunk to chunk through one scan.
+    struct ChunkState
+    {
+        std::uint64_t reportedUntil = 0;    // file offset up to which matches have been reported
+        std::uint64_t reportLimit = ~std::uint64_t(0);  // matches from here on are not reported
+        std::uint64_t countedUntil = 0;     // file offset up to which newlines have been counted
+        std::uint64_t newlines = 0;         // newlines before countedUntil
+        MatchResult result;
+        std::vector<std::string_view> groups;
+        // next occurrence of each literal prefix in the current chunk, nullptr if not searched yet.
+        std::vector<const char*> literalHits;
+#if QUETZALCOATLUS_SCAN_METRICS
+        std::uint64_t candidates = 0;       // handed to the matcher, not yet added to the metrics
+#endif
+    };
+
+    bool scanStreamed(std::istream& stream, const MatchCallback& callback, const ProgressCallback& progress) const;
+    // chunked scan of 'stream', which holds the log from state.countedUntil on, up to 'until'.
+    // with 'rest', the log goes on past 'until': what more of it could change is not reported,
+    // and 'rest' is set to where the scan of the rest starts (its lines counted from the start).
+    bool scanStreamedUntil(std::istream& stream, std::uint64_t until, AppendedPosition* rest, ChunkState& state,
+                           const MatchCallback& callback, const ProgressCallback& progress) const;
+
+    // chunked scan of the matches that start in [from, until) of data (the whole file) on the
+    // calling thread, as scanRange(), except that 'from' can be anywhere in a line.
+    bool scanWindowed(std::string_view data, std::size_t from, std::size_t until, ChunkState& state,
+                      const MatchCallback& callback, bool reportProgress) const;
+    bool scanParallel(std::string_view data, unsigned int threads, const MatchCallback& callback) const;
+
+    // match [begin, begin + size), which starts at bufferOffset in the file.
+    // with 'final' false, more data follows and matches touching the end are deferred:
+    // 'keepFrom' is lowered to the start of such a match, or of a partial one.
+    bool matchChunk(const char* begin, std::size_t size, std::uint64_t bufferOffset, bool final,
+                    std::size_t& keepFrom, ChunkState& state, const MatchCallback& callback) const;
+
+    // the next match in [from, end) into state.result, using the literal prefilter if there is one.
+    bool nextMatch(const char* begin, const char* end, const char* from, ChunkState& state) const;
+
+    std::unique_ptr<Matcher> matcher;
+    // every match starts with one of these, so only their occurrences need to go to the matcher.
+    std::vector<std::string> literalPrefixes;
+    std::size_t chunkSize;
+    ScanMode scanMode = ScanMode::Auto;
+    ProgressCallback progressCallback;
+    unsigned int threadCount = 1;
+};
+
+#endif // #ifndef LOGSCANNER_H
@@ -0,0 +1,559 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "logview.h"
+#include "decompressor.h"
+#include "literalsearch.h"
+
+#include <QFontDatabase>
+#include <QKeyEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QWheelEvent>
+
+#include <algorithm>
+#include <cstring>
+
+
+// lines are looked for this far at most, a longer line (or a binary file without any) is shown
+// in pieces of this length, so no scroll step has to go through more than this.
+static constexpr std::uint64_t maximumLineScan = 1024 * 1024;
+// of a line only this much is shown.
+static constexpr std::uint64_t maximumLineBytes = 4096;
+// searched per event loop iteration.
+static constexpr std::uint64_t searchSliceBytes = 16 * 1024 * 1024;
+// the vertical scroll bar maps its range onto the file size.
+static constexpr std::uint64_t scrollRange = 1 << 24;
+static constexpr int margin = 4;
+
+
+static QString decodeLine(const char* data, std::uint64_t length)
+{
+    QString line = QString::fromUtf8(data, static_cast<int>(length));
+    line.replace(QLatin1Char('\t'), QLatin1String("    "));
+    return line;
+}
+
+
+LogView::LogView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    setFocusPolicy(Qt::StrongFocus);
+
+    searchTimer.setInterval(0);
+    connect(&searchTimer, &QTimer::timeout, this, &LogView::searchSlice);
+}
+
+
+bool LogView::open(const QString &filepath)
+{
+    close();
+    if(detectCompression(filepath.toStdString()) != Compression::None || !file.open(filepath.toStdString())) {
+        return false;
+    }
+    path = filepath;
+    topLine = 1;
+    updateScrollBars();
+    viewport()->update();
+    return true;
+}
+
+
+void LogView::close()
+{
+    searchTimer.stop();
+    file.close();
+    path.clear();
+    lineIndex.reset();
+    top = 0;
+    topLine = 0;
+    highlighted = none;
+    matchOffset = none;
+    updateScrollBars();
+    viewport()->update();
+}
+
+
+bool LogView::refresh()
+{
+    if(!file.isOpen()) {
+        return false;
+    }
+    std::uint64_t currentSize = 0;
+    std::uint64_t currentId = 0;
+    if(!fileSizeAndId(path.toStdString(), currentSize, currentId)) {
+        close();
+        return false;
+    }
+    if(currentId != file.fileId() || currentSize < size()) {
+        remap(true);
+    }
+    else if(currentSize > size()) {
+        remap(false);
+    }
+    return file.isOpen();
+}
+
+
+void LogView::remap(bool restarted)
+{
+    file.close();
+    if(!file.open(path.toStdString())) {
+        close();
+        return;
+    }
+
+    if(restarted) {
+        lineIndex.reset();
+        top = 0;
+        topLine = 1;
+        highlighted = none;
+        matchOffset = none;
+        if(searchTimer.isActive()) {
+            searchTimer.stop();
+            emit searchFinished(false);
+        }
+    }
+    else if(lineIndex) {
+        // what was mapped is still there, only the line index needs the appended lines.
+        std::shared_ptr<LineIndex> extended = std::make_shared<LineIndex>(*lineIndex);
+        extended->extend(file.view());
+        lineIndex = extended;
+    }
+    updateScrollBars();
+    viewport()->update();
+}
+
+
+void LogView::jumpTo(quint64 offset, quint64 line)
+{
+    if(!refresh()) {
+        return;
+    }
+    highlighted = lineStart(std::min<std::uint64_t>(offset, size()));
+    top = highlighted;
+    topLine = line;
+    // with some context above it.
+    scrollLines(-(visibleLines() / 3));
+}
+
+
+void LogView::setLineIndex(std::shared_ptr<const LineIndex> index)
+{
+    if(!refresh() || !index || index->indexedSize() > size()) {
+        return;
+    }
+    if(index->indexedSize() < size()) {
+        std::shared_ptr<LineIndex> extended = std::make_shared<LineIndex>(*index);
+        extended->extend(file.view());
+        index = extended;
+    }
+    lineIndex = index;
+    topLine = lineNumberAt(top);
+    viewport()->update();
+}
+
+
+bool LogView::goToLine(quint64 line)
+{
+    std::uint64_t offset = 0;
+    if(!refresh() || !lineIndex || !lineIndex->lineOffset(file.view(), line, offset)) {
+        return false;
+    }
+    jumpTo(offset, line);
+    return true;
+}
+
+
+std::uint64_t LogView::lineNumberAt(std::uint64_t offset) const
+{
+    if(lineIndex) {
+        return lineIndex->lineAt(file.view(), offset);
+    }
+    return (offset == 0) ? 1 : 0;
+}
+
+
+std::uint64_t LogView::lineStart(std::uint64_t offset) const
+{
+    const char* data = file.view().data();
+    const std::uint64_t limit = (offset > maximumLineScan) ? offset - maximumLineScan : 0;
+    for(std::uint64_t position = offset; position > limit; position--) {
+        if(data[position - 1] == '\n') {
+            return position;
+        }
+    }
+    return limit;
+}
+
+
+std::uint64_t LogView::nextLine(std::uint64_t offset) const
+{
+    const std::uint64_t end = std::min(size(), offset + maximumLineScan);
+    if(offset >= end) {
+        return end;
+    }
+    const char* data = file.view().data();
+    const void* found = std::memchr(data + offset, '\n', end - offset);
+    return (found != nullptr) ? static_cast<std::uint64_t>(static_cast<const char*>(found) - data) + 1 : end;
+}
+
+
+std::uint64_t LogView::lineEnd(std::uint64_t offset) const
+{
+    const char* data = file.view().data();
+    std::uint64_t end = nextLine(offset);
+    if(end > offset && data[end - 1] == '\n') {
+        end--;
+    }
+    if(end > offset && data[end - 1] == '\r') {
+        end--;
+    }
+    return end;
+}
+
+
+int LogView::visibleLines() const
+{
+    const int lineHeight = std::max(1, fontMetrics().height());
+    return std::max(1, (viewport()->height() + lineHeight - 1) / lineHeight);
+}
+
+
+void LogView::scrollToOffset(std::uint64_t offset)
+{
+    top = lineStart(std::min(offset, size()));
+    // not an empty last line after the final line break.
+    if(top == size() && size() > 0) {
+        top = lineStart(size() - 1);
+    }
+    topLine = lineNumberAt(top);
+    updateScrollBars();
+    viewport()->update();
+}
+
+
+void LogView::scrollLines(std::int64_t lines)
+{
+    for(; lines > 0; lines--) {
+        const std::uint64_t next = nextLine(top);
+        if(next >= size()) {
+            break;
+        }
+        top = next;
+        if(topLine != 0) {
+            topLine++;
+        }
+    }
+    for(; lines < 0 && top > 0; lines++) {
+        top = lineStart(top - 1);
+        if(topLine > 1) {
+            topLine--;
+        }
+    }
+    if(top == 0) {
+        topLine = 1;
+    }
+    updateScrollBars();
+    viewport()->update();
+}
+
+
+void LogView::updateScrollBars()
+{
+    settingScrollBars = true;
+
+    QScrollBar *vertical = verticalScrollBar();
+    const std::uint64_t range = std::min(size(), scrollRange);
+    vertical->setRange(0, static_cast<int>(range));
+    vertical->setPageStep(std::max(1, static_cast<int>(range / 50)));
+    vertical->setValue((size() > 0) ? static_cast<int>(static_cast<double>(top) / static_cast<double>(size()) *
+                                                       static_cast<double>(range))
+                                    : 0);
+
+    // as wide as the widest line in view.
+    std::uint64_t widest = 0;
+    std::uint64_t offset = top;
+    for(int line = 0; line < visibleLines() && offset < size(); line++) {
+        widest = std::max(widest, std::min(lineEnd(offset) - offset, maximumLineBytes));
+        offset = nextLine(offset);
+    }
+    QScrollBar *horizontal = horizontalScrollBar();
+    const int width = static_cast<int>(widest) * fontMetrics().averageCharWidth() + 8 * margin;
+    horizontal->setRange(0, std::max(0, width - viewport()->width() / 2));
+    horizontal->setPageStep(viewport()->width());
+    horizontal->setSingleStep(fontMetrics().averageCharWidth() * 4);
+
+    settingScrollBars = false;
+}
+
+
+void LogView::showMatch()
+{
+    std::uint64_t offset = top;
+    for(int line = 0; line < visibleLines() - 1 && offset < size(); line++) {
+        const std::uint64_t next = nextLine(offset);
+        if(matchOffset >= offset && matchOffset < next) {
+            viewport()->update();
+            return;
+        }
+        offset = next;
+    }
+    scrollToOffset(matchOffset);
+    scrollLines(-(visibleLines() / 3));
+}
+
+
+void LogView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(viewport());
+    painter.fillRect(viewport()->rect(), palette().base());
+    if(!refresh()) {
+        return;
+    }
+
+    const QFontMetrics metrics = fontMetrics();
+    const int lineHeight = metrics.height();
+    const int lines = visibleLines();
+    const char* data = file.view().data();
+
+    // line numbers, only when they are known.
+    int gutter = 0;
+    if(topLine != 0) {
+        gutter = metrics.horizontalAdvance(QString::number(topLine + static_cast<std::uint64_t>(lines))) + 2 * margin;
+        painter.fillRect(QRect(0, 0, gutter, viewport()->height()), palette().window());
+    }
+    const int x = gutter + margin - horizontalScrollBar()->value();
+
+    std::uint64_t offset = top;
+    for(int line = 0; line < lines && offset < size(); line++) {
+        const int y = line * lineHeight;
+        const std::uint64_t end = lineEnd(offset);
+        const std::uint64_t shown = std::min(end - offset, maximumLineBytes);
+
+        painter.setClipRect(QRect(gutter, y, viewport()->width() - gutter, lineHeight));
+        if(offset == highlighted) {
+            painter.fillRect(QRect(gutter, y, viewport()->width() - gutter, lineHeight), palette().alternateBase());
+        }
+        if(matchOffset != none && matchOffset >= offset && matchOffset < offset + shown) {
+            const int matchX = x + metrics.horizontalAdvance(decodeLine(data + offset, matchOffset - offset));
+            const std::uint64_t matchLength = std::min<std::uint64_t>(static_cast<std::uint64_t>(searchText.size()),
+                                                                      offset + shown - matchOffset);
+            const int matchWidth = metrics.horizontalAdvance(decodeLine(data + matchOffset, matchLength));
+            painter.fillRect(QRect(matchX, y, matchWidth, lineHeight), QColor(255, 220, 0));
+        }
+        painter.setPen(palette().text().color());
+        painter.drawText(x, y + metrics.ascent(), decodeLine(data + offset, shown));
+
+        if(gutter > 0) {
+            painter.setClipping(false);
+            painter.setPen(palette().windowText().color());
+            painter.drawText(QRect(0, y, gutter - margin, lineHeight), Qt::AlignRight | Qt::AlignVCenter,
+                             QString::number(topLine + static_cast<std::uint64_t>(line)));
+        }
+        offset = nextLine(offset);
+    }
+}
+
+
+void LogView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    refresh();
+    updateScrollBars();
+}
+
+
+void LogView::wheelEvent(QWheelEvent *event)
+{
+    const int delta = event->angleDelta().y();
+    if(delta == 0) {
+        QAbstractScrollArea::wheelEvent(event);
+        return;
+    }
+    event->accept();
+    if(!refresh()) {
+        return;
+    }
+    // 3 lines a notch (120), smaller steps (touchpads) add up.
+    wheelDelta += delta;
+    const int lines = wheelDelta / 40;
+    wheelDelta -= lines * 40;
+    scrollLines(-lines);
+}
+
+
+void LogView::keyPressEvent(QKeyEvent *event)
+{
+    refresh();
+    const int page = std::max(1, visibleLines() - 1);
+    switch(event->key()) {
+    case Qt::Key_Up:
+        scrollLines(-1);
+        break;
+    case Qt::Key_Down:
+        scrollLines(1);
+        break;
+    case Qt::Key_PageUp:
+        scrollLines(-page);
+        break;
+    case Qt::Key_PageDown:
+        scrollLines(page);
+        break;
+    case Qt::Key_Home:
+        scrollToOffset(0);
+        break;
+    case Qt::Key_End:
+        scrollToOffset(size());
+        scrollLines(-page);
+        break;
+    case Qt::Key_F3:
+        if(event->modifiers() & Qt::ShiftModifier) {
+            findPrevious();
+        }
+        else {
+            findNext();
+        }
+        break;
+    default:
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    event->accept();
+}
+
+
+void LogView::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    if(settingScrollBars) {
+        return;
+    }
+    if(dy != 0 && refresh()) {
+        // dragged: the scroll bar is a position in the file.
+        QScrollBar *vertical = verticalScrollBar();
+        if(vertical->value() >= vertical->maximum()) {
+            scrollToOffset(size());
+            scrollLines(-std::max(1, visibleLines() - 1));
+        }
+        else {
+            const double position = static_cast<double>(vertical->value()) / std::max(1, vertical->maximum());
+            top = lineStart(static_cast<std::uint64_t>(position * static_cast<double>(size())));
+            topLine = lineNumberAt(top);
+        }
+    }
+    viewport()->update();
+}
+
+
+void LogView::search(const QString &text)
+{
+    searchText = text.toUtf8();
+    if(searchText.isEmpty()) {
+        searchTimer.stop();
+        matchOffset = none;
+        viewport()->update();
+        return;
+    }
+    startSearch((matchOffset != none) ? matchOffset : top, false);
+}
+
+
+void LogView::findNext()
+{
+    if(!searchText.isEmpty()) {
+        startSearch((matchOffset != none) ? matchOffset + 1 : top, false);
+    }
+}
+
+
+void LogView::findPrevious()
+{
+    if(!searchText.isEmpty()) {
+        startSearch((matchOffset != none) ? matchOffset : top, true);
+    }
+}
+
+
+void LogView::startSearch(std::uint64_t from, bool backward)
+{
+    if(!refresh()) {
+        return;
+    }
+    searchPosition = std::min(from, size());
+    searchOrigin = searchPosition;
+    searchBackward = backward;
+    searchWrapped = false;
+    searchTimer.start();
+}
+
+
+void LogView::searchSlice()
+{
+    // a restarted log ends the search.
+    if(!refresh() || !searchTimer.isActive()) {
+        searchTimer.stop();
+        return;
+    }
+    const std::string_view text = file.view();
+    const std::string_view literal(searchText.constData(), static_cast<std::size_t>(searchText.size()));
+
+    auto finish = [this](std::uint64_t found) {
+        searchTimer.stop();
+        if(found != none) {
+            matchOffset = found;
+            showMatch();
+        }
+        emit searchFinished(found != none);
+    };
+
+    if(!searchBackward) {
+        if(searchPosition >= size()) {
+            if(searchWrapped) {
+                finish(none);
+                return;
+            }
+            searchPosition = 0;
+            searchWrapped = true;
+        }
+        // overlapping the next slice by the length of the text, for a match across the boundary.
+        const std::uint64_t end = std::min(size(), searchPosition + searchSliceBytes + literal.size() - 1);
+        const char* found = findLiteral(text.data() + searchPosition, text.data() + end, literal);
+        if(found != nullptr) {
+            finish(static_cast<std::uint64_t>(found - text.data()));
+            return;
+        }
+        searchPosition += searchSliceBytes;
+        if(searchWrapped && searchPosition >= searchOrigin) {
+            finish(none);
+        }
+        return;
+    }
+
+    // backward: the last match starting before searchPosition.
+    if(searchPosition == 0) {
+        if(searchWrapped) {
+            finish(none);
+            return;
+        }
+        searchPosition = size();
+        searchWrapped = true;
+    }
+    const std::uint64_t begin = (searchPosition > searchSliceBytes) ? searchPosition - searchSliceBytes : 0;
+    const std::uint64_t end = std::min(size(), searchPosition + literal.size() - 1);
+    std::uint64_t last = none;
+    for(const char* found = findLiteral(text.data() + begin, text.data() + end, literal);
+        found != nullptr && static_cast<std::uint64_t>(found - text.data()) < searchPosition;
+        found = findLiteral(found + 1, text.data() + end, literal)) {
+        last = static_cast<std::uint64_t>(found - text.data());
+    }
+    if(last != none) {
+        finish(last);
+        return;
+    }
+    searchPosition = begin;
+    if(searchWrapped && searchPosition <= searchOrigin) {
+        finish(none);
+    }
+}
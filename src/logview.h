@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef LOGVIEW_H
+#define LOGVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QByteArray>
+#include <QString>
+#include <QTimer>
+
+#include <cstdint>
+#include <memory>
+
+#include "lineindex.h"
+#include "mappedfile.h"
+
+
+// read-only viewer for logs of any size.
+//
+// the log is memory-mapped, not loaded: only the lines in view are decoded and painted, straight
+// from the mapping, so memory use does not grow with the file (the pages touched are in the page
+// cache, shared and dropped by the OS). the position is a byte offset. the line numbers come from
+// the line index of the log once it is set, until then they are only known from where the view
+// was jumped to (e.g. a match, whose line the scan found).
+//
+// searching is incremental, done a slice at a time from the event loop, so typing in a search
+// field over a multi-GB log does not freeze the GUI.
+//
+// the log may be live (followed): before the mapping is touched, its size and identity are
+// checked, a log that grew is mapped again where the view is, and a log that was truncated or
+// replaced is reopened from the start, so the view never reads pages past the end of the file.
+class LogView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit LogView(QWidget *parent = nullptr);
+
+    // false if the log cannot be mapped (compressed logs, pipes and other special files).
+    bool open(const QString &filepath);
+    void close();
+    const QString& filepath() const { return path; }
+
+    // maps the log again if it has grown, reopens it if it was truncated or replaced.
+    // false if it is not open anymore.
+    bool refresh();
+
+    // scrolls to the line at byte 'offset', whose line number (1 based) is 'line', and highlights it.
+    void jumpTo(quint64 offset, quint64 line);
+
+    // the line index of the open log, extended here if the log has grown since it was built.
+    // ignored if it does not fit the log.
+    void setLineIndex(std::shared_ptr<const LineIndex> index);
+    // false without a line index, or if the log has no such line.
+    bool goToLine(quint64 line);
+
+public slots:
+    // finds 'text' from the current match on (or the top of the view), so typing a longer text
+    // keeps the match where it is as long as it still matches. wraps around at the end.
+    void search(const QString &text);
+    void findNext();
+    void findPrevious();
+
+signals:
+    void searchFinished(bool found);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private:
+    static constexpr std::uint64_t none = ~std::uint64_t(0);
+
+    std::uint64_t size() const { return file.view().size(); }
+    // start of the line 'offset' is in.
+    std::uint64_t lineStart(std::uint64_t offset) const;
+    // start of the line after the one at 'offset', or the end of the log.
+    std::uint64_t nextLine(std::uint64_t offset) const;
+    // end of the line at 'offset', without the line break.
+    std::uint64_t lineEnd(std::uint64_t offset) const;
+
+    // 0 if not known.
+    std::uint64_t lineNumberAt(std::uint64_t offset) const;
+    int visibleLines() const;
+    void scrollToOffset(std::uint64_t offset);
+    void scrollLines(std::int64_t lines);
+    void updateScrollBars();
+    // the match is made visible if it is not.
+    void showMatch();
+
+    // the mapping of the log as it is now, empty (the log closed) if it is gone.
+    void remap(bool restarted);
+
+    void startSearch(std::uint64_t from, bool backward);
+    void searchSlice();
+
+    MappedFile file;
+    QString path;
+    std::shared_ptr<const LineIndex> lineIndex;
+
+    std::uint64_t top = 0;              // offset of the first line in view
+    std::uint64_t topLine = 0;          // its line number, 0 if not known
+    std::uint64_t highlighted = none;   // offset of the line jumped to
+    bool settingScrollBars = false;
+    int wheelDelta = 0;
+
+    QByteArray searchText;
+    std::uint64_t matchOffset = none;
+    std::uint64_t searchPosition = 0;   // next slice starts (forward) or ends (backward) here
+    std::uint64_t searchOrigin = 0;
+    bool searchBackward = false;
+    bool searchWrapped = false;
+    QTimer searchTimer;
+};
+
+#endif // #ifndef LOGVIEW_H
@@ -5,9 +5,14 @@
 #include <QApplication>
 #include <QMessageBox>
 #include <QSplashScreen>
-#include <QTimer>
 #include <QColor>
+#include <QFile>
 #include "quetzalcoatlus_config.h"
+#include "batchscan.h"
+#include "iconcache.h"
+#include "resourcebundle.h"
+#include "scanmetrics.h"
+#include "startuptimer.h"
 #include "window.h"
 
 
@@ -31,8 +36,19 @@
 
 int main(int argc, char *argv[])
 {
+    // headless batch mode: none of the GUI, resources or banner below, just the scan.
+    if(isBatchScan(argc, argv)) {
+        std::ios::sync_with_stdio(false);
+        return static_cast<int>(runBatchScan(argc, argv));
+    }
+
+    StartupTimer startupTimer;
+
+#if !QUETZALCOATLUS_USE_EXTERNAL_RESOURCES
     // initialize the Qt resource system ('quetzalcoatlus.qrc')
     Q_INIT_RESOURCE(quetzalcoatlus);
+    startupTimer.mark("resource init");
+#endif // #if !QUETZALCOATLUS_USE_EXTERNAL_RESOURCES
 
 
     // https://stackoverflow.com/questions/52256264/qt-version-incorrect
@@ -60,6 +76,27 @@ int main(int argc, char *argv[])
 #endif
 
     QApplication app(argc, argv);
+    // for QStandardPaths, e.g. the scan result cache directory.
+    QCoreApplication::setApplicationName("quetzalcoatlus");
+    startupTimer.mark("QApplication");
+
+#if QUETZALCOATLUS_SCAN_METRICS
+    // QUETZALCOATLUS_TRACE=<file>: the spans of all the scans of the session, written to 'file'
+    // at exit as Chrome trace-event JSON.
+    const QString tracePath = qEnvironmentVariable("QUETZALCOATLUS_TRACE");
+    if(!tracePath.isEmpty()) {
+        ScanMetrics::startTracing();
+    }
+#endif // #if QUETZALCOATLUS_SCAN_METRICS
+
+#if QUETZALCOATLUS_USE_EXTERNAL_RESOURCES
+    // the same resources, from quetzalcoatlus.rcc instead of compiled in.
+    QString resourceError;
+    if(!registerResourceBundle(resourceError)) {
+        qWarning().noquote() << resourceError;
+    }
+    startupTimer.mark("resource init");
+#endif // #if QUETZALCOATLUS_USE_EXTERNAL_RESOURCES
 
 #ifndef QT_NO_SYSTEMTRAYICON
     if (!QSystemTrayIcon::isSystemTrayAvailable()) {
@@ -72,22 +109,45 @@ int main(int argc, char *argv[])
 
 
 #if QUETZALCOATLUS_USE_SPLASH_SCREEN
-    QPixmap pixmap = QIcon(":/images/logo.svg").pixmap(QSize(800,800));
+    QPixmap pixmap = IconCache::pixmap(":/images/logo.svg", QSize(800,800), app.devicePixelRatio());
     QSplashScreen splash(pixmap, Qt::SplashScreen | Qt::WindowStaysOnTopHint);
     splash.show();
     splash.windowHandle()->setScreen(QGuiApplication::screenAt(QCursor::pos()));
     splash.showMessage(QObject::tr("Thinking..."), Qt::AlignBottom | Qt::AlignRight, Qt::gray);
-    QTimer::singleShot(2600, &splash, &QWidget::close); // keep displayed for ~3 seconds
+    // get the splash on screen before the heavy lifting below blocks the event loop.
+    app.processEvents();
+    startupTimer.mark("splash screen");
 #endif // #if QUETZALCOATLUS_USE_SPLASH_SCREEN
 
+    // icons, tray icon and GIF are all loaded here, while the splash is up.
     Window window;
-
+    startupTimer.mark("Window constructor");
+
+    // the splash stays up exactly until the window has painted its first frame, however long
+    // (or short) that takes.
+    QObject::connect(&window, &Window::firstFramePainted,
+                     &window,
+                     [&]() {
+                        startupTimer.mark("show and first paint");
 #if QUETZALCOATLUS_USE_SPLASH_SCREEN
-    QTimer::singleShot(2650, &window, &QWidget::show); // show the main window after splash
-    QTimer::singleShot(2650, &window, &Window::setPositionAndSize); // adjust size and position
-#else
-    window.show();
-    window.setPositionAndSize();
+                        splash.close();
 #endif // #if QUETZALCOATLUS_USE_SPLASH_SCREEN
-    return app.exec();
+                        startupTimer.report(QUETZALCOATLUS_STARTUP_BUDGET_MS);
+                     }
+                    );
+
+    // shows the window, adjusting its size and position.
+    window.setPositionAndSize();
+    const int status = app.exec();
+
+#if QUETZALCOATLUS_SCAN_METRICS
+    if(!tracePath.isEmpty()) {
+        ScanMetrics::stopTracing();
+        if(!ScanMetrics::writeTrace(QFile::encodeName(tracePath).toStdString())) {
+            qWarning().noquote() << "cannot write the trace to" << tracePath;
+        }
+    }
+#endif // #if QUETZALCOATLUS_SCAN_METRICS
+
+    return status;
 }
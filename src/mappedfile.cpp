@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // #ifdef _WIN32
+
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& filepath)
+{
+    close();
+
+    HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+                              nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if(GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &fileSize)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    BY_HANDLE_FILE_INFORMATION information;
+    if(GetFileInformationByHandle(file, &information)) {
+        id = (static_cast<std::uint64_t>(information.nFileIndexHigh) << 32) | information.nFileIndexLow;
+    }
+
+    fileHandle = file;
+    size = static_cast<std::size_t>(fileSize.QuadPart);
+    opened = true;
+
+    // zero length files cannot be mapped, but are trivially 'mapped' as an empty view.
+    if(size == 0) {
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mapping == nullptr) {
+        close();
+        return false;
+    }
+    mappingHandle = mapping;
+
+    data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if(data == nullptr) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+
+void MappedFile::close()
+{
+    if(data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if(mappingHandle != nullptr) {
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+    }
+    if(fileHandle != nullptr) {
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+    }
+    data = nullptr;
+    size = 0;
+    opened = false;
+    id = 0;
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+}
+
+
+bool fileSizeAndId(const std::string& filepath, std::uint64_t& size, std::uint64_t& id)
+{
+    HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    BY_HANDLE_FILE_INFORMATION information;
+    const bool known = GetFileType(file) == FILE_TYPE_DISK && GetFileSizeEx(file, &fileSize) &&
+                       GetFileInformationByHandle(file, &information);
+    CloseHandle(file);
+    if(!known) {
+        return false;
+    }
+    size = static_cast<std::uint64_t>(fileSize.QuadPart);
+    id = (static_cast<std::uint64_t>(information.nFileIndexHigh) << 32) | information.nFileIndexLow;
+    return true;
+}
+
+#else // #ifdef _WIN32
+
+bool MappedFile::open(const std::string& filepath)
+{
+    close();
+
+    int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    size = static_cast<std::size_t>(st.st_size);
+    id = static_cast<std::uint64_t>(st.st_ino);
+    opened = true;
+
+    // zero length files cannot be mapped, but are trivially 'mapped' as an empty view.
+    if(size == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    if(address == MAP_FAILED) {
+        size = 0;
+        id = 0;
+        opened = false;
+        return false;
+    }
+
+    // we only ever walk the file front to back.
+    madvise(address, size, MADV_SEQUENTIAL);
+
+    data = static_cast<const char*>(address);
+    return true;
+}
+
+
+void MappedFile::close()
+{
+    if(data != nullptr) {
+        munmap(const_cast<char*>(data), size);
+    }
+    data = nullptr;
+    size = 0;
+    opened = false;
+    id = 0;
+}
+
+
+bool fileSizeAndId(const std::string& filepath, std::uint64_t& size, std::uint64_t& id)
+{
+    struct stat st;
+    if(stat(filepath.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    size = static_cast<std::uint64_t>(st.st_size);
+    id = static_cast<std::uint64_t>(st.st_ino);
+    return true;
+}
+
+#endif // #ifdef _WIN32
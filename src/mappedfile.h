@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+
+// read-only memory mapping of a whole regular file.
+// mapping fails for pipes, sockets, devices and other special files, in which case
+// the caller is expected to fall back to reading the file as a stream.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filepath);
+    void close();
+
+    bool isOpen() const { return opened; }
+    std::string_view view() const { return std::string_view(data, size); }
+
+    // identity of the file on its volume (inode, or file index on Windows), which tells a file
+    // that replaced another one under the same path apart from the original.
+    std::uint64_t fileId() const { return id; }
+
+private:
+    const char* data = nullptr;
+    std::size_t size = 0;
+    bool opened = false;
+    std::uint64_t id = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif // #ifdef _WIN32
+};
+
+
+// size and identity (as MappedFile::fileId()) of a regular file, without mapping it.
+// false if there is no such file, or it is not a regular one.
+bool fileSizeAndId(const std::string& filepath, std::uint64_t& size, std::uint64_t& id);
+
+#endif // #ifndef MAPPEDFILE_H
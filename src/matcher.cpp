@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "matcher.h"
+#include "automatonmatcher.h"
+#include "builtinpatterns.h"
+#include "quetzalcoatlus_config.h"
+
+#include <regex>
+
+#if QUETZALCOATLUS_USE_QREGULAREXPRESSION_MATCHER
+#include <QRegularExpression>
+#include <QString>
+#endif // #if QUETZALCOATLUS_USE_QREGULAREXPRESSION_MATCHER
+
+
+namespace
+{
+
+class StdRegexScratch : public MatchScratch
+{
+public:
+    std::cmatch match;
+};
+
+
+class StdRegexMatcher : public Matcher
+{
+public:
+    explicit StdRegexMatcher(const std::string& pattern)
+        : regex(pattern, std::regex::ECMAScript)
+    {
+    }
+
+    bool search(const char* begin, const char* end, const char* from, MatchResult& result) const override
+    {
+        return run(begin, end, from, std::regex_constants::match_default, result);
+    }
+
+    bool matchAt(const char* begin, const char* end, const char* at, MatchResult& result) const override
+    {
+        return run(begin, end, at, std::regex_constants::match_continuous, result);
+    }
+
+    std::size_t captureCount() const override { return regex.mark_count(); }
+    const char* name() const override { return "std::regex"; }
+
+private:
+    bool run(const char* begin, const char* end, const char* from,
+             std::regex_constants::match_flag_type flags, MatchResult& result) const
+    {
+        StdRegexScratch* scratch = dynamic_cast<StdRegexScratch*>(result.scratch.get());
+        if(scratch == nullptr) {
+            result.scratch = std::make_unique<StdRegexScratch>();
+            scratch = static_cast<StdRegexScratch*>(result.scratch.get());
+        }
+
+        // std::regex has no partial matching.
+        result.partialBegin = nullptr;
+
+        // let ^ and \b see the byte before 'from'.
+        if(from != begin) {
+            flags |= std::regex_constants::match_prev_avail;
+        }
+        if(!std::regex_search(from, end, scratch->match, regex, flags)) {
+            return false;
+        }
+
+        const std::cmatch& match = scratch->match;
+        result.groups.assign(2 * (captureCount() + 1), nullptr);
+        for(std::size_t group = 0; group < match.size() && group <= captureCount(); group++) {
+            if(match[group].matched) {
+                result.groups[2 * group] = match[group].first;
+                result.groups[2 * group + 1] = match[group].second;
+            }
+        }
+        return true;
+    }
+
+    std::regex regex;
+};
+
+
+#if QUETZALCOATLUS_USE_QREGULAREXPRESSION_MATCHER
+
+class QRegularExpressionScratch : public MatchScratch
+{
+public:
+    // the subject converted to a QString, kept as long as the same subject is being searched.
+    // Latin-1 maps every byte to exactly one QChar, so offsets are the same in both.
+    QString subject;
+    const char* subjectBegin = nullptr;
+    const char* subjectEnd = nullptr;
+
+    void subjectChanged() override
+    {
+        subjectBegin = nullptr;
+        subjectEnd = nullptr;
+    }
+};
+
+
+class QRegularExpressionMatcher : public Matcher
+{
+public:
+    explicit QRegularExpressionMatcher(const std::string& pattern)
+        : regex(QString::fromStdString(pattern))
+    {
+        // JIT compile now, rather than on the first match.
+        regex.optimize();
+    }
+
+    bool isValid() const { return regex.isValid(); }
+
+    bool search(const char* begin, const char* end, const char* from, MatchResult& result) const override
+    {
+        return run(begin, end, from, QRegularExpression::NoMatchOption, result);
+    }
+
+    bool matchAt(const char* begin, const char* end, const char* at, MatchResult& result) const override
+    {
+#if (QT_VERSION < QT_VERSION_CHECK(6, 0, 0))
+        return run(begin, end, at, QRegularExpression::AnchoredMatchOption, result);
+#else
+        return run(begin, end, at, QRegularExpression::AnchorAtOffsetMatchOption, result);
+#endif
+    }
+
+    std::size_t captureCount() const override { return static_cast<std::size_t>(regex.captureCount()); }
+    const char* name() const override { return "QRegularExpression"; }
+
+private:
+    bool run(const char* begin, const char* end, const char* from,
+             QRegularExpression::MatchOptions options, MatchResult& result) const
+    {
+        QRegularExpressionScratch* scratch = dynamic_cast<QRegularExpressionScratch*>(result.scratch.get());
+        if(scratch == nullptr) {
+            result.scratch = std::make_unique<QRegularExpressionScratch>();
+            scratch = static_cast<QRegularExpressionScratch*>(result.scratch.get());
+        }
+
+        if(scratch->subjectBegin != begin || scratch->subjectEnd != end) {
+            scratch->subject = QString::fromLatin1(begin, static_cast<int>(end - begin));
+            scratch->subjectBegin = begin;
+            scratch->subjectEnd = end;
+        }
+
+        // a partial match is reported in preference to a complete one, at the first start where
+        // the end of the subject was reached: the complete one might have been different.
+        const QRegularExpression::MatchType type = result.subjectContinues ? QRegularExpression::PartialPreferFirstMatch
+                                                                           : QRegularExpression::NormalMatch;
+        const QRegularExpressionMatch match = regex.match(scratch->subject, static_cast<int>(from - begin), type, options);
+        result.partialBegin = match.hasPartialMatch() ? begin + match.capturedStart(0) : nullptr;
+        if(!match.hasMatch()) {
+            return false;
+        }
+
+        result.groups.assign(2 * (captureCount() + 1), nullptr);
+        for(int group = 0; group <= match.lastCapturedIndex(); group++) {
+            if(match.capturedStart(group) >= 0) {
+                result.groups[2 * group] = begin + match.capturedStart(group);
+                result.groups[2 * group + 1] = begin + match.capturedEnd(group);
+            }
+        }
+        return true;
+    }
+
+    QRegularExpression regex;
+};
+
+#endif // #if QUETZALCOATLUS_USE_QREGULAREXPRESSION_MATCHER
+
+} // namespace
+
+
+bool parseMatcherBackend(std::string_view name, MatcherBackend& backend)
+{
+    const MatcherBackend backends[] = {MatcherBackend::Builtin, MatcherBackend::Automaton, MatcherBackend::StdRegex,
+                                       MatcherBackend::QRegularExpression};
+    for(MatcherBackend candidate : backends) {
+        if(name == matcherBackendName(candidate)) {
+            backend = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+const char* matcherBackendName(MatcherBackend backend)
+{
+    switch(backend) {
+    case MatcherBackend::Builtin:
+        return "builtin";
+    case MatcherBackend::Automaton:
+        return "automaton";
+    case MatcherBackend::StdRegex:
+        return "regex";
+    case MatcherBackend::QRegularExpression:
+        return "qregularexpression";
+    }
+    return "";
+}
+
+
+std::vector<std::string> requiredLiteralPrefixes(const std::string& pattern)
+{
+    // the automaton's parser is used for every backend, patterns it cannot parse get no prefixes.
+    std::unique_ptr<AutomatonMatcher> matcher = AutomatonMatcher::compile(pattern);
+    if(!matcher) {
+        return std::vector<std::string>();
+    }
+    return matcher->literalPrefixes();
+}
+
+
+std::unique_ptr<Matcher> createMatcher(const std::string& pattern, MatcherBackend backend)
+{
+    switch(backend) {
+    case MatcherBackend::Builtin:
+    {
+        std::unique_ptr<Matcher> matcher = createBuiltinMatcher(pattern);
+        if(matcher) {
+            return matcher;
+        }
+        // a user pattern
+        [[fallthrough]];
+    }
+    case MatcherBackend::Automaton:
+    {
+        std::unique_ptr<AutomatonMatcher> matcher = AutomatonMatcher::compile(pattern);
+        if(matcher) {
+            return matcher;
+        }
+        // unsupported feature (or invalid pattern, which std::regex reports)
+        break;
+    }
+    case MatcherBackend::QRegularExpression:
+    {
+#if QUETZALCOATLUS_USE_QREGULAREXPRESSION_MATCHER
+        std::unique_ptr<QRegularExpressionMatcher> matcher = std::make_unique<QRegularExpressionMatcher>(pattern);
+        if(matcher->isValid()) {
+            return matcher;
+        }
+#endif // #if QUETZALCOATLUS_USE_QREGULAREXPRESSION_MATCHER
+        break;
+    }
+    case MatcherBackend::StdRegex:
+        break;
+    }
+
+    return std::make_unique<StdRegexMatcher>(pattern);
+}
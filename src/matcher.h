@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef MATCHER_H
+#define MATCHER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+// per search scratch state of a Matcher.
+// it lives in the MatchResult, so that reusing a MatchResult across searches does not allocate.
+class MatchScratch
+{
+public:
+    virtual ~MatchScratch() = default;
+
+    // the subject changed while its begin and end stayed the same (a buffer refilled in place),
+    // so nothing derived from its content may be reused.
+    virtual void subjectChanged() {}
+};
+
+
+// result of a Matcher search.
+// reuse one MatchResult per Matcher (and per thread) across searches.
+struct MatchResult
+{
+    // begin/end pointer pairs for each group, group 0 is the whole match.
+    // both are nullptr if the group did not take part in the match.
+    std::vector<const char*> groups;
+    std::unique_ptr<MatchScratch> scratch;
+
+    // set by the caller when the subject is cut short, and more of it follows past 'end'.
+    bool subjectContinues = false;
+    // after search() or matchAt(): where the earliest attempt that ran into 'end' started, at or
+    // before the match if there is one. with more of the subject, that attempt might have matched
+    // (or matched differently). nullptr if none did, or if the matcher cannot tell.
+    const char* partialBegin = nullptr;
+
+    std::size_t groupCount() const { return groups.size() / 2; }
+
+    // to call before searching a subject whose content changed in place.
+    void subjectChanged()
+    {
+        if(scratch) {
+            scratch->subjectChanged();
+        }
+    }
+
+    const char* begin(std::size_t group = 0) const { return groups[2 * group]; }
+    const char* end(std::size_t group = 0) const { return groups[2 * group + 1]; }
+
+    std::string_view view(std::size_t group) const
+    {
+        if(group >= groupCount() || begin(group) == nullptr) {
+            return std::string_view();
+        }
+        return std::string_view(begin(group), static_cast<std::size_t>(end(group) - begin(group)));
+    }
+};
+
+
+// interface to a regular expression engine, with ECMAScript-like syntax and semantics.
+class Matcher
+{
+public:
+    virtual ~Matcher() = default;
+
+    // find the leftmost match in [begin, end) that starts at or after 'from'.
+    // 'begin' is the start of the subject, for ^ and \b at 'from'.
+    // safe to call concurrently from several threads, each with its own MatchResult.
+    virtual bool search(const char* begin, const char* end, const char* from, MatchResult& result) const = 0;
+
+    // like search(), but the match has to start exactly at 'at'.
+    // for callers that already know where matches can start, this only looks at the match itself.
+    virtual bool matchAt(const char* begin, const char* end, const char* at, MatchResult& result) const = 0;
+
+    // number of capture groups, not counting group 0.
+    virtual std::size_t captureCount() const = 0;
+
+    virtual const char* name() const = 0;
+};
+
+
+enum class MatcherBackend
+{
+    // code generated at compile time for each of the patterns that ship with the tool (see
+    // builtinpatterns.h), Automaton for any other pattern.
+    Builtin,
+    // non-backtracking automaton, linear in the size of the input.
+    // patterns using features it does not support (backreferences, lookahead) use StdRegex.
+    Automaton,
+    // std::regex, backtracking. it cannot tell where a partial match begins (see partialBegin).
+    StdRegex,
+    // QRegularExpression (PCRE2, JIT compiled where available).
+    QRegularExpression,
+};
+
+
+// "builtin", "automaton", "regex" and "qregularexpression", as on the command line.
+// false for anything else.
+bool parseMatcherBackend(std::string_view name, MatcherBackend& backend);
+const char* matcherBackendName(MatcherBackend backend);
+
+// literals of which every match of the pattern starts with one, e.g. { "errors" } for
+// errors\s*:\s*(\d+), or empty if there is no such (short) set of literals.
+std::vector<std::string> requiredLiteralPrefixes(const std::string& pattern);
+
+// throws std::regex_error if the pattern is not valid.
+std::unique_ptr<Matcher> createMatcher(const std::string& pattern, MatcherBackend backend = MatcherBackend::Builtin);
+
+#endif // #ifndef MATCHER_H
@@ -0,0 +1,611 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "metricstore.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif // #ifdef _WIN32
+
+
+namespace
+{
+
+// "QZMS", then the format version. bump the version when the layout changes.
+constexpr char headerMagic[4] = {'Q', 'Z', 'M', 'S'};
+constexpr std::uint32_t headerVersion = 1;
+
+constexpr const char* headerName = "header.qzms";
+constexpr const char* runsName = "runs.bin";
+constexpr const char* stringsName = "strings.bin";
+constexpr const char* lockName = "writer.lock";
+
+// file name and value width of each column, in the order of MetricStore::Column.
+struct ColumnFile
+{
+    const char* name;
+    std::uint64_t width;
+};
+
+constexpr ColumnFile columnFiles[] = {
+    {"run.u32", sizeof(std::uint32_t)},
+    {"file.u32", sizeof(std::uint32_t)},
+    {"stage.u32", sizeof(std::uint32_t)},
+    {"field.u32", sizeof(std::uint32_t)},
+    {"value.f64", sizeof(double)},
+    {"offset.u64", sizeof(std::uint64_t)},
+};
+
+
+struct Header
+{
+    std::uint64_t rows = 0;
+    std::uint32_t runs = 0;
+    std::uint32_t strings = 0;
+    std::uint64_t stringBytes = 0;  // of strings.bin
+};
+
+
+template<typename T>
+void writeValue(std::ostream& stream, const T& value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+template<typename T>
+bool readValue(std::istream& stream, T& value)
+{
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+
+template<typename T>
+bool appendValues(const std::string& path, const std::vector<T>& values)
+{
+    std::ofstream stream(path, std::ios::out | std::ios::binary | std::ios::app);
+    stream.write(reinterpret_cast<const char*>(values.data()),
+                 static_cast<std::streamsize>(values.size() * sizeof(T)));
+    stream.close();
+    return !stream.fail();
+}
+
+
+// a file of the store cut back to what the header says it holds, which drops whatever an
+// interrupted append left behind. false if it holds less.
+bool truncateTo(const std::string& path, std::uint64_t size)
+{
+    std::error_code error;
+    const std::uintmax_t actual = std::filesystem::file_size(path, error);
+    if(error || actual < size) {
+        return false;
+    }
+    if(actual > size) {
+        std::filesystem::resize_file(path, size, error);
+    }
+    return !error;
+}
+
+
+// whether a file of the store holds at least 'size' bytes.
+bool holdsAtLeast(const std::string& path, std::uint64_t size)
+{
+    std::error_code error;
+    const std::uintmax_t actual = std::filesystem::file_size(path, error);
+    return !error && actual >= size;
+}
+
+
+// the values of a group, partially ordered so that the percentiles are at their ranks.
+void selectPercentiles(std::vector<double>& values, const std::vector<double>& percentiles,
+                       std::vector<double>& result)
+{
+    result.assign(percentiles.size(), 0);
+    if(values.empty()) {
+        return;
+    }
+
+    // in ascending order, so each selection only has to look at what is above the previous one.
+    std::vector<std::size_t> order(percentiles.size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return percentiles[a] < percentiles[b]; });
+
+    const double count = static_cast<double>(values.size());
+    auto from = values.begin();
+    for(std::size_t index : order) {
+        const double rank = std::ceil(std::clamp(percentiles[index], 0.0, 1.0) * count);
+        const std::size_t at = static_cast<std::size_t>(std::clamp(rank, 1.0, count)) - 1;
+        const auto nth = values.begin() + static_cast<std::ptrdiff_t>(at);
+        if(nth >= from) {
+            std::nth_element(from, nth, values.end());
+            from = nth;
+        }
+        result[index] = *nth;
+    }
+}
+
+} // namespace
+
+
+MetricStore::~MetricStore()
+{
+    close();
+}
+
+
+std::string MetricStore::filePath(const char* name) const
+{
+    return (std::filesystem::path(directory) / name).string();
+}
+
+
+bool MetricStore::open(const std::string& directory, std::string& error)
+{
+    close();
+    this->directory = directory;
+
+    std::error_code fileError;
+    std::filesystem::create_directories(directory, fileError);
+    if(fileError) {
+        error = "cannot create '" + directory + "': " + fileError.message();
+        return false;
+    }
+    if(!lockWriter(error)) {
+        return false;
+    }
+
+    const bool exists = std::filesystem::exists(filePath(headerName), fileError);
+    if(fileError) {
+        error = "cannot read '" + filePath(headerName) + "': " + fileError.message();
+        close();
+        return false;
+    }
+    if(!exists) {
+        // a new store: whatever is there without a header was never committed.
+        for(const ColumnFile& file : columnFiles) {
+            std::ofstream(filePath(file.name), std::ios::out | std::ios::binary | std::ios::trunc);
+        }
+        std::ofstream(filePath(runsName), std::ios::out | std::ios::binary | std::ios::trunc);
+        std::ofstream(filePath(stringsName), std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!writeHeader(error)) {
+            close();
+            return false;
+        }
+    }
+
+    writable = true;
+    if(!load(error)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+
+bool MetricStore::openReadOnly(const std::string& directory, std::string& error)
+{
+    close();
+    this->directory = directory;
+
+    std::error_code fileError;
+    if(!std::filesystem::exists(filePath(headerName), fileError)) {
+        error = "there is no metric store in '" + directory + "'";
+        return false;
+    }
+    if(!load(error)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+
+bool MetricStore::load(std::string& error)
+{
+    Header header;
+    {
+        std::ifstream headerStream(filePath(headerName), std::ios::in | std::ios::binary);
+        char magic[sizeof(headerMagic)];
+        std::uint32_t version = 0;
+        if(!headerStream.read(magic, sizeof(magic)) || std::memcmp(magic, headerMagic, sizeof(magic)) != 0 ||
+           !readValue(headerStream, version) || version != headerVersion ||
+           !readValue(headerStream, header.rows) || !readValue(headerStream, header.runs) ||
+           !readValue(headerStream, header.strings) || !readValue(headerStream, header.stringBytes)) {
+            error = "'" + directory + "' is not a metric store of this version";
+            return false;
+        }
+    }
+
+    // the writer cuts back what an interrupted append left behind. a reader leaves the files
+    // alone, they may be in the middle of an append, and only looks at what the header counts.
+    const auto holds = [this](const std::string& path, std::uint64_t size) {
+        return writable ? truncateTo(path, size) : holdsAtLeast(path, size);
+    };
+    const std::string damaged = "the metric store in '" + directory + "' is damaged";
+    for(const ColumnFile& file : columnFiles) {
+        if(!holds(filePath(file.name), header.rows * file.width)) {
+            error = damaged;
+            return false;
+        }
+    }
+    if(!holds(filePath(runsName), header.runs * sizeof(Run)) || !holds(filePath(stringsName), header.stringBytes)) {
+        error = damaged;
+        return false;
+    }
+
+    std::ifstream stringsStream(filePath(stringsName), std::ios::in | std::ios::binary);
+    strings.resize(header.strings);
+    std::uint64_t stringBytes = 0;
+    for(std::uint32_t id = 0; id < header.strings; id++) {
+        std::uint32_t length = 0;
+        stringBytes += sizeof(length);
+        if(stringBytes > header.stringBytes || !readValue(stringsStream, length) ||
+           length > header.stringBytes - stringBytes) {
+            error = damaged;
+            return false;
+        }
+        stringBytes += length;
+        strings[id].resize(length);
+        if(!stringsStream.read(strings[id].data(), length)) {
+            error = damaged;
+            return false;
+        }
+        stringIds.emplace(strings[id], id);
+    }
+    if(stringBytes != header.stringBytes) {
+        error = damaged;
+        return false;
+    }
+
+    std::ifstream runsStream(filePath(runsName), std::ios::in | std::ios::binary);
+    runs.resize(header.runs);
+    if(!runsStream.read(reinterpret_cast<char*>(runs.data()), static_cast<std::streamsize>(runs.size() * sizeof(Run)))) {
+        error = damaged;
+        return false;
+    }
+    std::uint64_t nextRow = 0;
+    for(const Run& run : runs) {
+        if(run.firstRow != nextRow || run.label >= strings.size()) {
+            error = damaged;
+            return false;
+        }
+        nextRow += run.rowCount;
+    }
+    rows = header.rows;
+    if(nextRow != rows) {
+        error = damaged;
+        return false;
+    }
+
+    if(!mapColumns(error)) {
+        return false;
+    }
+    opened = true;
+    return true;
+}
+
+
+void MetricStore::close()
+{
+    for(MappedFile& file : columns) {
+        file.close();
+    }
+    unlockWriter();
+    opened = false;
+    writable = false;
+    rows = 0;
+    runs.clear();
+    strings.clear();
+    stringIds.clear();
+}
+
+
+bool MetricStore::writeHeader(std::string& error) const
+{
+    std::uint64_t stringBytes = 0;
+    for(const std::string& text : strings) {
+        stringBytes += sizeof(std::uint32_t) + text.size();
+    }
+
+    // write to a temporary file and rename it, which commits the appended rows all at once.
+    const std::string path = filePath(headerName);
+    const std::string temporaryPath = path + ".tmp";
+    std::error_code fileError;
+    {
+        std::ofstream stream(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        stream.write(headerMagic, sizeof(headerMagic));
+        writeValue(stream, headerVersion);
+        writeValue(stream, rows);
+        writeValue(stream, static_cast<std::uint32_t>(runs.size()));
+        writeValue(stream, static_cast<std::uint32_t>(strings.size()));
+        writeValue(stream, stringBytes);
+        stream.close();
+        if(stream.fail()) {
+            std::filesystem::remove(temporaryPath, fileError);
+            error = "cannot write '" + temporaryPath + "'";
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path, fileError);
+    if(fileError) {
+        std::filesystem::remove(temporaryPath, fileError);
+        error = "cannot replace '" + path + "'";
+        return false;
+    }
+    return true;
+}
+
+
+bool MetricStore::mapColumns(std::string& error)
+{
+    for(int index = 0; index < ColumnCount; index++) {
+        const std::string path = filePath(columnFiles[index].name);
+        if(!columns[index].open(path)) {
+            error = "cannot map '" + path + "'";
+            return false;
+        }
+    }
+    return true;
+}
+
+
+std::uint32_t MetricStore::intern(std::string_view text, std::vector<std::string>& added)
+{
+    const std::string key(text);
+    const auto found = stringIds.find(key);
+    if(found != stringIds.end()) {
+        return found->second;
+    }
+    const std::uint32_t id = static_cast<std::uint32_t>(strings.size());
+    strings.push_back(key);
+    stringIds.emplace(key, id);
+    added.push_back(key);
+    return id;
+}
+
+
+bool MetricStore::appendRun(const std::string& label, const std::vector<MetricRow>& runRows, std::uint32_t& run,
+                            std::string& error)
+{
+    if(!opened || !writable) {
+        error = "the metric store is not open for writing";
+        return false;
+    }
+
+    const std::size_t stringCount = strings.size();
+    std::vector<std::string> added;
+    const Run entry{rows, runRows.size(), intern(label, added), 0};
+    run = static_cast<std::uint32_t>(runs.size());
+
+    std::vector<std::uint32_t> runValues(runRows.size(), run);
+    std::vector<std::uint32_t> files(runRows.size());
+    std::vector<std::uint32_t> stages(runRows.size());
+    std::vector<std::uint32_t> fields(runRows.size());
+    std::vector<double> values(runRows.size());
+    std::vector<std::uint64_t> offsets(runRows.size());
+    for(std::size_t row = 0; row < runRows.size(); row++) {
+        files[row] = intern(runRows[row].file, added);
+        stages[row] = runRows[row].stage;
+        fields[row] = intern(runRows[row].field, added);
+        values[row] = runRows[row].value;
+        offsets[row] = runRows[row].offset;
+    }
+
+    // unmapped while the files grow, which Windows needs.
+    for(MappedFile& file : columns) {
+        file.close();
+    }
+
+    bool written = appendValues(filePath(columnFiles[RunColumn].name), runValues) &&
+                   appendValues(filePath(columnFiles[FileColumn].name), files) &&
+                   appendValues(filePath(columnFiles[StageColumn].name), stages) &&
+                   appendValues(filePath(columnFiles[FieldColumn].name), fields) &&
+                   appendValues(filePath(columnFiles[ValueColumn].name), values) &&
+                   appendValues(filePath(columnFiles[OffsetColumn].name), offsets) &&
+                   appendValues(filePath(runsName), std::vector<Run>{entry});
+    if(written) {
+        std::ofstream stream(filePath(stringsName), std::ios::out | std::ios::binary | std::ios::app);
+        for(const std::string& text : added) {
+            writeValue(stream, static_cast<std::uint32_t>(text.size()));
+            stream.write(text.data(), static_cast<std::streamsize>(text.size()));
+        }
+        stream.close();
+        written = !stream.fail();
+    }
+
+    if(written) {
+        rows += runRows.size();
+        runs.push_back(entry);
+        if(writeHeader(error)) {
+            return mapColumns(error);
+        }
+        rows -= runRows.size();
+        runs.pop_back();
+    }
+    else {
+        error = "cannot append to the metric store in '" + directory + "'";
+    }
+
+    // not committed: forget the new strings, the files are cut back by the next open().
+    for(std::size_t id = stringCount; id < strings.size(); id++) {
+        stringIds.erase(strings[id]);
+    }
+    strings.resize(stringCount);
+    std::string mapError;
+    mapColumns(mapError);
+    return false;
+}
+
+
+#ifdef _WIN32
+
+bool MetricStore::lockWriter(std::string& error)
+{
+    // not shared: a second writer cannot open it until the first closes it, or exits.
+    const std::string path = filePath(lockName);
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        error = "the metric store in '" + directory + "' is open for writing by another process";
+        return false;
+    }
+    lockHandle = file;
+    return true;
+}
+
+
+void MetricStore::unlockWriter()
+{
+    if(lockHandle != nullptr) {
+        CloseHandle(static_cast<HANDLE>(lockHandle));
+        lockHandle = nullptr;
+    }
+}
+
+#else // #ifdef _WIN32
+
+bool MetricStore::lockWriter(std::string& error)
+{
+    // an advisory lock, which goes away with the process, so a crashed writer leaves none behind.
+    const std::string path = filePath(lockName);
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(fd < 0) {
+        error = "cannot create '" + path + "'";
+        return false;
+    }
+    if(flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        ::close(fd);
+        error = "the metric store in '" + directory + "' is open for writing by another process";
+        return false;
+    }
+    lockFile = fd;
+    return true;
+}
+
+
+void MetricStore::unlockWriter()
+{
+    if(lockFile >= 0) {
+        ::close(lockFile);
+        lockFile = -1;
+    }
+}
+
+#endif // #ifdef _WIN32
+
+
+std::uint32_t MetricStore::findRun(const std::string& label) const
+{
+    const auto found = stringIds.find(label);
+    if(found == stringIds.end()) {
+        return noRun;
+    }
+    for(std::uint32_t run = runCount(); run > 0; run--) {
+        if(runs[run - 1].label == found->second) {
+            return run - 1;
+        }
+    }
+    return noRun;
+}
+
+
+std::vector<MetricAggregate> MetricStore::aggregate(const MetricQuery& query) const
+{
+    std::vector<MetricAggregate> result;
+    if(!opened || runs.empty() || query.firstRun > query.lastRun || query.firstRun >= runs.size()) {
+        return result;
+    }
+
+    const bool allFields = query.field.empty();
+    std::uint32_t field = 0;
+    if(!allFields) {
+        const auto found = stringIds.find(query.field);
+        if(found == stringIds.end()) {
+            return result;
+        }
+        field = found->second;
+    }
+
+    // the runs of the window are contiguous rows.
+    const std::uint32_t lastRun = std::min<std::uint32_t>(query.lastRun, runCount() - 1);
+    const std::uint64_t firstRow = runs[query.firstRun].firstRow;
+    const std::uint64_t endRow = runs[lastRun].firstRow + runs[lastRun].rowCount;
+
+    const std::uint32_t* runValues = runColumn();
+    const std::uint32_t* stages = stageColumn();
+    const std::uint32_t* fields = fieldColumn();
+    const double* values = valueColumn();
+    const bool keepValues = !query.percentiles.empty();
+
+    struct Group
+    {
+        MetricAggregate aggregate;
+        std::vector<double> values;
+    };
+    std::vector<Group> groups;
+    std::unordered_map<std::uint32_t, std::size_t> groupIndex;
+    // consecutive rows are mostly of the same stage, and always of the same run.
+    std::uint32_t lastKey = 0;
+    std::size_t lastGroup = groups.max_size();
+
+    for(std::uint64_t row = firstRow; row < endRow; row++) {
+        if((!allFields && fields[row] != field) || (!query.allStages && stages[row] != query.stage)) {
+            continue;
+        }
+
+        std::uint32_t key = 0;
+        if(query.groupBy == MetricQuery::GroupBy::Stage) {
+            key = stages[row];
+        }
+        else if(query.groupBy == MetricQuery::GroupBy::Run) {
+            key = runValues[row];
+        }
+        if(lastGroup == groups.max_size() || key != lastKey) {
+            const auto inserted = groupIndex.emplace(key, groups.size());
+            if(inserted.second) {
+                groups.emplace_back();
+                groups.back().aggregate.key = key;
+            }
+            lastKey = key;
+            lastGroup = inserted.first->second;
+        }
+
+        MetricAggregate& aggregate = groups[lastGroup].aggregate;
+        const double value = values[row];
+        if(aggregate.count == 0) {
+            aggregate.min = value;
+            aggregate.max = value;
+        }
+        else {
+            aggregate.min = std::min(aggregate.min, value);
+            aggregate.max = std::max(aggregate.max, value);
+        }
+        aggregate.sum += value;
+        aggregate.count++;
+        if(keepValues) {
+            groups[lastGroup].values.push_back(value);
+        }
+    }
+
+    result.reserve(groups.size());
+    for(Group& group : groups) {
+        if(keepValues) {
+            selectPercentiles(group.values, query.percentiles, group.aggregate.percentiles);
+        }
+        result.push_back(std::move(group.aggregate));
+    }
+    std::sort(result.begin(), result.end(),
+              [](const MetricAggregate& a, const MetricAggregate& b) { return a.key < b.key; });
+    return result;
+}
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef METRICSTORE_H
+#define METRICSTORE_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "mappedfile.h"
+
+
+// one extracted value, as appended to a MetricStore. the strings only have to live for the call.
+struct MetricRow
+{
+    std::string_view file;
+    std::uint32_t stage = 0;
+    std::string_view field;     // e.g. "errors.count"
+    double value = 0;
+    std::uint64_t offset = 0;   // of the match in the file
+};
+
+
+// what to aggregate: the rows of one field (or all), in a window of runs, for one stage (or all).
+struct MetricQuery
+{
+    enum class GroupBy
+    {
+        Stage,
+        Run,
+        None,       // a single aggregate over all the rows
+    };
+
+    std::string field;                  // all fields if empty
+    std::uint32_t firstRun = 0;         // the window of runs, inclusive
+    std::uint32_t lastRun = ~std::uint32_t(0);
+    bool allStages = true;
+    std::uint32_t stage = 0;            // the only stage, without allStages
+    GroupBy groupBy = GroupBy::Stage;
+    std::vector<double> percentiles;    // as fractions, e.g. 0.5 and 0.99
+};
+
+
+struct MetricAggregate
+{
+    std::uint32_t key = 0;              // the stage or the run, by the grouping
+    std::uint64_t count = 0;
+    double min = 0;
+    double max = 0;
+    double sum = 0;
+    std::vector<double> percentiles;    // nearest rank, in the order of MetricQuery::percentiles
+
+    double mean() const { return count > 0 ? sum / static_cast<double>(count) : 0; }
+};
+
+
+// append-only, columnar store of the values extracted from many runs (e.g. one run per CI build),
+// for trends across runs without reading any log again.
+//
+// a directory with one file per column (run, file, stage, field, value, offset), each a flat
+// array in native byte order that is memory-mapped for reading. file and field names are
+// interned, so a row is 32 bytes. a run is appended as a whole, and its rows are contiguous,
+// so a window of runs is a range of rows: the run table says where each run starts.
+//
+// the columns are appended first and the header (row and run counts) is replaced last, so a
+// run that was cut short, by a crash or a full disk, is not part of the store and is cut off
+// by the next open(). there is only one writer at a time, open() holds a lock on the store
+// (writer.lock) until close(). readers open it read-only while it is written: they see the runs
+// committed when they opened it.
+class MetricStore
+{
+public:
+    static constexpr std::uint32_t noRun = ~std::uint32_t(0);
+
+    MetricStore() = default;
+    ~MetricStore();
+    MetricStore(const MetricStore&) = delete;
+    MetricStore& operator=(const MetricStore&) = delete;
+
+    // for appending runs: creates an empty store if the directory has none. fails if another
+    // writer has the store open.
+    bool open(const std::string& directory, std::string& error);
+    // for queries: fails if there is no store, changes nothing in it.
+    bool openReadOnly(const std::string& directory, std::string& error);
+    void close();
+    bool isOpen() const { return opened; }
+
+    // the rows as a new run, which gets the next run id (runs are numbered from 0).
+    bool appendRun(const std::string& label, const std::vector<MetricRow>& runRows, std::uint32_t& run,
+                   std::string& error);
+
+    std::uint64_t rowCount() const { return rows; }
+    std::uint32_t runCount() const { return static_cast<std::uint32_t>(runs.size()); }
+    const std::string& runLabel(std::uint32_t run) const { return strings[runs[run].label]; }
+    std::uint64_t runFirstRow(std::uint32_t run) const { return runs[run].firstRow; }
+    std::uint64_t runRowCount(std::uint32_t run) const { return runs[run].rowCount; }
+    // the last run with this label, noRun if there is none.
+    std::uint32_t findRun(const std::string& label) const;
+
+    // the columns, rowCount() values each, valid until the next appendRun() or close().
+    // files and fields are ids of string().
+    const std::uint32_t* runColumn() const { return column<std::uint32_t>(RunColumn); }
+    const std::uint32_t* fileColumn() const { return column<std::uint32_t>(FileColumn); }
+    const std::uint32_t* stageColumn() const { return column<std::uint32_t>(StageColumn); }
+    const std::uint32_t* fieldColumn() const { return column<std::uint32_t>(FieldColumn); }
+    const double* valueColumn() const { return column<double>(ValueColumn); }
+    const std::uint64_t* offsetColumn() const { return column<std::uint64_t>(OffsetColumn); }
+    const std::string& string(std::uint32_t id) const { return strings[id]; }
+
+    // aggregates of the rows the query selects, grouped by its grouping, ordered by the key.
+    std::vector<MetricAggregate> aggregate(const MetricQuery& query) const;
+
+private:
+    enum Column
+    {
+        RunColumn,
+        FileColumn,
+        StageColumn,
+        FieldColumn,
+        ValueColumn,
+        OffsetColumn,
+        ColumnCount
+    };
+
+    struct Run
+    {
+        std::uint64_t firstRow;
+        std::uint64_t rowCount;
+        std::uint32_t label;
+        std::uint32_t reserved;
+    };
+
+    template<typename T>
+    const T* column(Column index) const
+    {
+        return reinterpret_cast<const T*>(columns[index].view().data());
+    }
+
+    std::string filePath(const char* name) const;
+    // the header and what it counts in the files, cut back to it by a writer.
+    bool load(std::string& error);
+    bool lockWriter(std::string& error);
+    void unlockWriter();
+    bool writeHeader(std::string& error) const;
+    bool mapColumns(std::string& error);
+    std::uint32_t intern(std::string_view text, std::vector<std::string>& added);
+
+    std::string directory;
+    bool opened = false;
+    bool writable = false;
+    std::uint64_t rows = 0;
+    std::vector<Run> runs;
+    std::vector<std::string> strings;
+    std::unordered_map<std::string, std::uint32_t> stringIds;
+    MappedFile columns[ColumnCount];
+#ifdef _WIN32
+    void* lockHandle = nullptr;
+#else
+    int lockFile = -1;
+#endif // #ifdef _WIN32
+};
+
+#endif // #ifndef METRICSTORE_H
@@ -8,4 +8,59 @@
     #define QUETZALCOATLUS_USE_SPLASH_SCREEN 1
 #endif // #ifndef QUETZALCOATLUS_USE_SPLASH_SCREEN
 
+// startup budget, from main() to the first frame of the main window: the startup phase timings
+// are always logged, and a warning too if the total is over this. 0 for no budget.
+#ifndef QUETZALCOATLUS_STARTUP_BUDGET_MS
+    #define QUETZALCOATLUS_STARTUP_BUDGET_MS 1000
+#endif // #ifndef QUETZALCOATLUS_STARTUP_BUDGET_MS
+
+// the resources of quetzalcoatlus.qrc come from an external bundle (quetzalcoatlus.rcc) mapped at
+// startup, instead of being compiled into the executable. the build system turns this on with
+// QUETZALCOATLUS_EXTERNAL_RESOURCES.
+#ifndef QUETZALCOATLUS_USE_EXTERNAL_RESOURCES
+    #define QUETZALCOATLUS_USE_EXTERNAL_RESOURCES 0
+#endif // #ifndef QUETZALCOATLUS_USE_EXTERNAL_RESOURCES
+
+// icons come from the atlas pre-rendered at build time (see src/iconatlas.h), instead of all
+// being rendered at runtime. the build system turns this on with QUETZALCOATLUS_ICON_ATLAS.
+#ifndef QUETZALCOATLUS_USE_ICON_ATLAS
+    #define QUETZALCOATLUS_USE_ICON_ATLAS 0
+#endif // #ifndef QUETZALCOATLUS_USE_ICON_ATLAS
+
+// memory for the decoded frames of the accretion disk animation: all the frames are kept, down-scaled
+// if they do not fit at full size, and freed once it has not been shown for the release delay.
+#ifndef QUETZALCOATLUS_ANIMATION_FRAME_BUDGET_MB
+    #define QUETZALCOATLUS_ANIMATION_FRAME_BUDGET_MB 64
+#endif // #ifndef QUETZALCOATLUS_ANIMATION_FRAME_BUDGET_MB
+
+#ifndef QUETZALCOATLUS_ANIMATION_RELEASE_SECONDS
+    #define QUETZALCOATLUS_ANIMATION_RELEASE_SECONDS 30
+#endif // #ifndef QUETZALCOATLUS_ANIMATION_RELEASE_SECONDS
+
+// build the optional QRegularExpression (PCRE2) backend for the log scanner matchers
+#ifndef QUETZALCOATLUS_USE_QREGULAREXPRESSION_MATCHER
+    #define QUETZALCOATLUS_USE_QREGULAREXPRESSION_MATCHER 1
+#endif // #ifndef QUETZALCOATLUS_USE_QREGULAREXPRESSION_MATCHER
+
+// decompress .gz (zlib) and .zst (zstd) logs while scanning them.
+// the build system turns these on when it finds the libraries.
+#ifndef QUETZALCOATLUS_USE_ZLIB
+    #define QUETZALCOATLUS_USE_ZLIB 0
+#endif // #ifndef QUETZALCOATLUS_USE_ZLIB
+
+#ifndef QUETZALCOATLUS_USE_ZSTD
+    #define QUETZALCOATLUS_USE_ZSTD 0
+#endif // #ifndef QUETZALCOATLUS_USE_ZSTD
+
+// counters (bytes, candidates, matches, allocations, I/O wait and match time) and trace spans of
+// the scan path, see src/scanmetrics.h. the build system turns this on with QUETZALCOATLUS_SCAN_METRICS.
+#ifndef QUETZALCOATLUS_SCAN_METRICS
+    #define QUETZALCOATLUS_SCAN_METRICS 0
+#endif // #ifndef QUETZALCOATLUS_SCAN_METRICS
+
+// size limit of the on-disk scan result cache, 0 disables the cache
+#ifndef QUETZALCOATLUS_RESULT_CACHE_SIZE_MB
+    #define QUETZALCOATLUS_RESULT_CACHE_SIZE_MB 256
+#endif // #ifndef QUETZALCOATLUS_RESULT_CACHE_SIZE_MB
+
 #endif // #ifndef QUETZALCOATLUS_CONFIG_H
\ No newline at end of file
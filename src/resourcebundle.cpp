@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "resourcebundle.h"
+#include "mappedfile.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QResource>
+#include <QStringList>
+
+
+bool registerResourceBundle(QString &error)
+{
+    // QResource reads straight from the mapping for as long as the application runs.
+    static MappedFile bundle;
+    if(bundle.isOpen()) {
+        return true;
+    }
+
+    const QString directory = QCoreApplication::applicationDirPath();
+    const QStringList candidates = {
+        directory + "/quetzalcoatlus.rcc",
+        directory + "/../share/quetzalcoatlus/quetzalcoatlus.rcc",
+    };
+
+    for(const QString &path : candidates) {
+        if(!QFile::exists(path)) {
+            continue;
+        }
+        if(!bundle.open(QFile::encodeName(path).toStdString())) {
+            error = QString("cannot map the resource bundle '%1'").arg(path);
+            return false;
+        }
+        if(!QResource::registerResource(reinterpret_cast<const uchar *>(bundle.view().data()))) {
+            bundle.close();
+            error = QString("'%1' is not a valid resource bundle").arg(path);
+            return false;
+        }
+        return true;
+    }
+
+    error = QString("resource bundle not found, looked for: %1").arg(candidates.join(", "));
+    return false;
+}
@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef RESOURCEBUNDLE_H
+#define RESOURCEBUNDLE_H
+
+#include <QString>
+
+
+// registers the external resource bundle (quetzalcoatlus.rcc, built with 'rcc -binary' when
+// QUETZALCOATLUS_EXTERNAL_RESOURCES is on), so the ":/images/..." and ":/gif/..." paths work just
+// as if the resources were compiled in.
+//
+// the bundle is memory-mapped, not read: a resource is only paged in (and shared through the
+// page cache) when it is actually opened. it is looked for next to the executable (build tree),
+// then in ../share/quetzalcoatlus (install and deploy package).
+//
+// call once, after the QApplication is created. on failure 'error' says what went wrong.
+bool registerResourceBundle(QString &error);
+
+#endif // #ifndef RESOURCEBUNDLE_H
@@ -0,0 +1,371 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "resultcache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+
+namespace
+{
+
+// "QZRC", then the format version. bump the version when StageRecord or the layout changes.
+constexpr char entryMagic[4] = {'Q', 'Z', 'R', 'C'};
+constexpr std::uint32_t entryVersion = 2;
+
+constexpr std::size_t fingerprintBlockSize = 4096;
+
+constexpr const char* entrySuffix = ".qzrc";
+constexpr const char* lineIndexSuffix = ".qzli";
+
+
+// FNV-1a, good enough to name the entries and to fingerprint the logs, and stable across
+// platforms and runs (unlike std::hash).
+std::uint64_t hashBytes(const char* data, std::size_t size, std::uint64_t hash = 14695981039346656037ull)
+{
+    for(std::size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+
+template<typename T>
+void writeValue(std::ostream& stream, const T& value)
+{
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+
+template<typename T>
+bool readValue(std::istream& stream, T& value)
+{
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+
+// hash of the first and the last block of the first 'size' bytes of the file.
+bool fingerprintFile(const std::filesystem::path& path, std::uint64_t size, std::uint64_t& fingerprint)
+{
+    std::ifstream stream(path, std::ios::in | std::ios::binary);
+    if(!stream.good()) {
+        return false;
+    }
+    char block[fingerprintBlockSize];
+    stream.read(block, static_cast<std::streamsize>(std::min<std::uint64_t>(size, sizeof(block))));
+    fingerprint = hashBytes(block, static_cast<std::size_t>(stream.gcount()));
+    if(size > sizeof(block)) {
+        const std::uint64_t tail = std::min<std::uint64_t>(size - sizeof(block), sizeof(block));
+        stream.seekg(static_cast<std::streamoff>(size - tail));
+        stream.read(block, static_cast<std::streamsize>(tail));
+        fingerprint = hashBytes(block, static_cast<std::size_t>(stream.gcount()), fingerprint);
+    }
+    return !stream.bad();
+}
+
+
+void writeString(std::ostream& stream, const std::string& value)
+{
+    writeValue(stream, static_cast<std::uint64_t>(value.size()));
+    stream.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+
+bool readString(std::istream& stream, std::string& value)
+{
+    std::uint64_t size = 0;
+    // the key strings are paths and patterns, anything larger is a damaged entry.
+    if(!readValue(stream, size) || size > 1024 * 1024) {
+        return false;
+    }
+    value.resize(static_cast<std::size_t>(size));
+    return static_cast<bool>(stream.read(value.data(), static_cast<std::streamsize>(size)));
+}
+
+
+// the bytes from the read position to the end of the stream, 0 if the stream cannot seek.
+std::uint64_t remainingBytes(std::istream& stream)
+{
+    const std::istream::pos_type position = stream.tellg();
+    if(position < 0 || !stream.seekg(0, std::ios::end)) {
+        return 0;
+    }
+    const std::istream::pos_type end = stream.tellg();
+    stream.seekg(position);
+    return end > position ? static_cast<std::uint64_t>(end - position) : 0;
+}
+
+} // namespace
+
+
+ResultCache::ResultCache(const std::string& directory, std::uint64_t sizeLimit)
+    : directory(directory),
+      sizeLimit(sizeLimit)
+{
+}
+
+
+bool ResultCache::identify(const std::string& filepath, FileIdentity& identity)
+{
+    std::error_code error;
+    const std::filesystem::path path = std::filesystem::absolute(filepath, error);
+    if(error) {
+        return false;
+    }
+    const std::uintmax_t size = std::filesystem::file_size(path, error);
+    if(error) {
+        return false;
+    }
+    const std::filesystem::file_time_type modified = std::filesystem::last_write_time(path, error);
+    if(error) {
+        return false;
+    }
+
+    // size and time catch appends and most rewrites, the first and the last block catch
+    // a rewrite within the resolution of the timestamps.
+    std::uint64_t fingerprint = 0;
+    if(!fingerprintFile(path, static_cast<std::uint64_t>(size), fingerprint)) {
+        return false;
+    }
+
+    identity.path = path.string();
+    identity.size = static_cast<std::uint64_t>(size);
+    identity.modified = static_cast<std::int64_t>(modified.time_since_epoch().count());
+    identity.fingerprint = fingerprint;
+    return true;
+}
+
+
+std::string ResultCache::entryPath(const FileIdentity& identity, const std::string& patternSet) const
+{
+    // one entry per log and pattern set: a log that changed replaces its old entry.
+    std::uint64_t hash = hashBytes(identity.path.data(), identity.path.size());
+    hash = hashBytes("\0", 1, hash);
+    hash = hashBytes(patternSet.data(), patternSet.size(), hash);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return (std::filesystem::path(directory) / (std::string(name) + entrySuffix)).string();
+}
+
+
+bool ResultCache::load(const FileIdentity& identity, const std::string& patternSet,
+                       std::vector<StageRecord>& records) const
+{
+    const std::string path = entryPath(identity, patternSet);
+    std::ifstream stream(path, std::ios::in | std::ios::binary);
+    if(!stream.good()) {
+        return false;
+    }
+
+    char magic[sizeof(entryMagic)];
+    std::uint32_t version = 0;
+    FileIdentity stored;
+    std::string storedPatternSet;
+    std::uint64_t count = 0;
+    if(!stream.read(magic, sizeof(magic)) || std::memcmp(magic, entryMagic, sizeof(magic)) != 0 ||
+       !readValue(stream, version) || version != entryVersion ||
+       !readString(stream, stored.path) || !readValue(stream, stored.size) ||
+       !readValue(stream, stored.modified) || !readValue(stream, stored.fingerprint) ||
+       !readString(stream, storedPatternSet) || !readValue(stream, count)) {
+        return false;
+    }
+    if(stored != identity || storedPatternSet != patternSet) {
+        return false;
+    }
+
+    // the records are stored as they are in memory, and are all that follows the header: an entry
+    // cut short or with a damaged count is a miss, rather than a count sized allocation.
+    const std::uint64_t remaining = remainingBytes(stream);
+    if(remaining % sizeof(StageRecord) != 0 || count != remaining / sizeof(StageRecord)) {
+        return false;
+    }
+    std::vector<StageRecord> loaded(static_cast<std::size_t>(count));
+    if(!stream.read(reinterpret_cast<char*>(loaded.data()), static_cast<std::streamsize>(count * sizeof(StageRecord)))) {
+        return false;
+    }
+    stream.close();
+
+    // mark the entry as recently used.
+    std::error_code error;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+    records.insert(records.end(), loaded.begin(), loaded.end());
+    return true;
+}
+
+
+bool ResultCache::store(const FileIdentity& identity, const std::string& patternSet,
+                        const std::vector<StageRecord>& records) const
+{
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if(error) {
+        return false;
+    }
+
+    // write to a temporary file and rename it, so a reader never sees half an entry.
+    const std::string path = entryPath(identity, patternSet);
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!stream.good()) {
+            return false;
+        }
+        stream.write(entryMagic, sizeof(entryMagic));
+        writeValue(stream, entryVersion);
+        writeString(stream, identity.path);
+        writeValue(stream, identity.size);
+        writeValue(stream, identity.modified);
+        writeValue(stream, identity.fingerprint);
+        writeString(stream, patternSet);
+        writeValue(stream, static_cast<std::uint64_t>(records.size()));
+        stream.write(reinterpret_cast<const char*>(records.data()),
+                     static_cast<std::streamsize>(records.size() * sizeof(StageRecord)));
+        if(!stream.good()) {
+            stream.close();
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, path, error);
+    if(error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    evict();
+    return true;
+}
+
+
+std::string ResultCache::lineIndexPath(const std::string& filepath) const
+{
+    std::uint64_t hash = hashBytes(filepath.data(), filepath.size());
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    return (std::filesystem::path(directory) / (std::string(name) + lineIndexSuffix)).string();
+}
+
+
+bool ResultCache::loadLineIndex(const std::string& filepath, LineIndex& index) const
+{
+    std::error_code error;
+    const std::filesystem::path path = std::filesystem::absolute(filepath, error);
+    if(error) {
+        return false;
+    }
+    const std::string entry = lineIndexPath(path.string());
+    std::ifstream stream(entry, std::ios::in | std::ios::binary);
+    if(!stream.good()) {
+        return false;
+    }
+
+    std::string storedPath;
+    std::uint64_t storedFingerprint = 0;
+    LineIndex loaded;
+    if(!readString(stream, storedPath) || storedPath != path.string() ||
+       !readValue(stream, storedFingerprint) || !loaded.read(stream)) {
+        return false;
+    }
+    stream.close();
+
+    // still the log it was built for, only longer (or the same).
+    std::uint64_t fingerprint = 0;
+    const std::uintmax_t size = std::filesystem::file_size(path, error);
+    if(error || size < loaded.indexedSize() ||
+       !fingerprintFile(path, loaded.indexedSize(), fingerprint) || fingerprint != storedFingerprint) {
+        return false;
+    }
+
+    std::filesystem::last_write_time(entry, std::filesystem::file_time_type::clock::now(), error);
+    index = std::move(loaded);
+    return true;
+}
+
+
+bool ResultCache::storeLineIndex(const std::string& filepath, const LineIndex& index) const
+{
+    std::error_code error;
+    const std::filesystem::path path = std::filesystem::absolute(filepath, error);
+    std::uint64_t fingerprint = 0;
+    if(error || !fingerprintFile(path, index.indexedSize(), fingerprint)) {
+        return false;
+    }
+    std::filesystem::create_directories(directory, error);
+    if(error) {
+        return false;
+    }
+
+    const std::string entry = lineIndexPath(path.string());
+    const std::string temporaryPath = entry + ".tmp";
+    {
+        std::ofstream stream(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        writeString(stream, path.string());
+        writeValue(stream, fingerprint);
+        if(!stream.good() || !index.write(stream)) {
+            stream.close();
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporaryPath, entry, error);
+    if(error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    evict();
+    return true;
+}
+
+
+void ResultCache::evict() const
+{
+    struct Entry
+    {
+        std::filesystem::path path;
+        std::uint64_t size;
+        std::filesystem::file_time_type used;
+    };
+
+    std::vector<Entry> entries;
+    std::uint64_t total = 0;
+
+    std::error_code error;
+    for(std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if(it->path().extension() != entrySuffix && it->path().extension() != lineIndexSuffix) {
+            continue;
+        }
+        std::error_code entryError;
+        const std::uintmax_t size = it->file_size(entryError);
+        const std::filesystem::file_time_type used = it->last_write_time(entryError);
+        if(entryError) {
+            continue;
+        }
+        entries.push_back(Entry{it->path(), static_cast<std::uint64_t>(size), used});
+        total += size;
+    }
+
+    if(total <= sizeLimit) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for(const Entry& entry : entries) {
+        if(total <= sizeLimit) {
+            break;
+        }
+        if(std::filesystem::remove(entry.path, error)) {
+            total -= entry.size;
+        }
+    }
+}
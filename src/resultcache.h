@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lineindex.h"
+#include "stageseries.h"
+
+
+// what a log looked like when it was scanned.
+// a log with the same path, size, modification time and fingerprint is taken to be unchanged.
+struct FileIdentity
+{
+    std::string path;           // absolute path
+    std::uint64_t size = 0;
+    std::int64_t modified = 0;  // modification time, in the filesystem clock's ticks
+    std::uint64_t fingerprint = 0;  // hash of the first and the last few KiB
+
+    bool operator==(const FileIdentity& other) const
+    {
+        return path == other.path && size == other.size && modified == other.modified &&
+               fingerprint == other.fingerprint;
+    }
+    bool operator!=(const FileIdentity& other) const { return !(*this == other); }
+};
+
+
+// on-disk cache of scan results, so reopening a log that has not changed needs no scan at all.
+//
+// there is one file per (log, pattern set) in the cache directory, named after a hash of the
+// key, which also holds the full key so a hash collision is a miss and not a wrong result.
+// the total size of the cache is capped, the least recently used entries are evicted first
+// (a hit refreshes the modification time of its entry, which is what the eviction goes by).
+class ResultCache
+{
+public:
+    static constexpr std::uint64_t defaultSizeLimit = 256 * 1024 * 1024;
+
+    explicit ResultCache(const std::string& directory, std::uint64_t sizeLimit = defaultSizeLimit);
+
+    // false if the file cannot be read.
+    static bool identify(const std::string& filepath, FileIdentity& identity);
+
+    // 'patternSet' is everything the results depend on besides the log, e.g. the patterns.
+    // false on a miss: no entry, or a damaged one.
+    bool load(const FileIdentity& identity, const std::string& patternSet, std::vector<StageRecord>& records) const;
+
+    // store the results of a complete scan of the log as it was at 'identity'.
+    bool store(const FileIdentity& identity, const std::string& patternSet, const std::vector<StageRecord>& records) const;
+
+    // the line index of a log is kept next to its results, one per log path. it stays valid while
+    // the log is only appended to: a loaded index is checked against the log up to where it ends,
+    // and may need to be extended with the rest.
+    // false on a miss: no index, a damaged one, or the log was rewritten.
+    bool loadLineIndex(const std::string& filepath, LineIndex& index) const;
+    bool storeLineIndex(const std::string& filepath, const LineIndex& index) const;
+
+    const std::string& path() const { return directory; }
+
+private:
+    std::string entryPath(const FileIdentity& identity, const std::string& patternSet) const;
+    std::string lineIndexPath(const std::string& filepath) const;
+    // remove least recently used entries until the cache fits its size limit.
+    void evict() const;
+
+    std::string directory;
+    std::uint64_t sizeLimit;
+};
+
+#endif // #ifndef RESULTCACHE_H
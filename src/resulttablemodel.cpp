@@ -0,0 +1,334 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "resulttablemodel.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+#include <iterator>
+
+
+// rows are ints for Qt, and the row indices 32 bit.
+static constexpr std::size_t maximumRecords = static_cast<std::size_t>(std::numeric_limits<int>::max());
+// records appended while sorted are merged at most this often (ms).
+static constexpr int mergeInterval = 250;
+
+
+ResultTableModel::ResultTableModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+    mergeTimer.setSingleShot(true);
+    mergeTimer.setInterval(mergeInterval);
+    connect(&mergeTimer, &QTimer::timeout, this, &ResultTableModel::mergeAppended);
+}
+
+
+int ResultTableModel::rowCount(const QModelIndex &parent) const
+{
+    if(parent.isValid()) {
+        return 0;
+    }
+    return static_cast<int>(indexed ? rows.size() : records.size());
+}
+
+
+int ResultTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+
+QVariant ResultTableModel::data(const QModelIndex &index, int role) const
+{
+    if(!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+
+    const std::size_t recordIndex = recordAt(index.row());
+    const StageRecord& record = records[recordIndex];
+
+    if(role == Qt::DisplayRole) {
+        switch(index.column()) {
+        case FileColumn:
+            return fileNames[static_cast<int>(fileOf(recordIndex))];
+        case LineColumn:
+            return QVariant(static_cast<qulonglong>(record.line));
+        case StageColumn:
+            return QVariant(static_cast<uint>(record.stage));
+        case ValueColumn:
+            if(record.error != FieldError::None) {
+                return QString::fromLatin1(fieldErrorName(record.error));
+            }
+            return QVariant(static_cast<qlonglong>(record.value));
+        default:
+            return QVariant();
+        }
+    }
+    if(role == Qt::ToolTipRole && index.column() == FileColumn) {
+        return files[static_cast<int>(fileOf(recordIndex))];
+    }
+    if(role == Qt::TextAlignmentRole && index.column() != FileColumn) {
+        return QVariant(static_cast<int>(Qt::AlignRight | Qt::AlignVCenter));
+    }
+    return QVariant();
+}
+
+
+QVariant ResultTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if(orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QAbstractTableModel::headerData(section, orientation, role);
+    }
+    switch(section) {
+    case FileColumn:
+        return tr("File");
+    case LineColumn:
+        return tr("Line");
+    case StageColumn:
+        return tr("Stage");
+    case ValueColumn:
+        return tr("Value");
+    default:
+        return QVariant();
+    }
+}
+
+
+// runs 'change' on the rows as a layout change, keeping the persistent indexes (the selection, the
+// current row) on the records they were on, or dropping them if their record is filtered out.
+template<typename Change>
+void ResultTableModel::changeLayout(Change change)
+{
+    emit layoutAboutToBeChanged();
+
+    const QModelIndexList persistent = persistentIndexList();
+    std::vector<std::size_t> persistentRecords;
+    persistentRecords.reserve(static_cast<std::size_t>(persistent.size()));
+    for(const QModelIndex &index : persistent) {
+        persistentRecords.push_back(recordAt(index.row()));
+    }
+
+    change();
+
+    if(!persistent.isEmpty()) {
+        std::vector<int> rowOf;
+        if(indexed) {
+            rowOf.assign(records.size(), -1);
+            for(std::size_t row = 0; row < rows.size(); row++) {
+                rowOf[rows[row]] = static_cast<int>(row);
+            }
+        }
+        QModelIndexList moved;
+        for(int i = 0; i < persistent.size(); i++) {
+            const std::size_t record = persistentRecords[static_cast<std::size_t>(i)];
+            const int row = indexed ? rowOf[record] : static_cast<int>(record);
+            moved.append(row < 0 ? QModelIndex() : createIndex(row, persistent[i].column()));
+        }
+        changePersistentIndexList(persistent, moved);
+    }
+
+    emit layoutChanged();
+}
+
+
+void ResultTableModel::sort(int column, Qt::SortOrder order)
+{
+    if(column >= ColumnCount) {
+        return;
+    }
+    changeLayout([this, column, order]() {
+        sortColumn = column;
+        sortOrder = order;
+        rebuild();
+    });
+}
+
+
+void ResultTableModel::setFilter(const ResultFilter &filter)
+{
+    if(filter == rowFilter) {
+        return;
+    }
+    changeLayout([this, &filter]() {
+        rowFilter = filter;
+        rebuild();
+    });
+}
+
+
+void ResultTableModel::append(const QString &filepath, const QVector<StageRecord> &newRecords)
+{
+    const std::size_t count = std::min(static_cast<std::size_t>(newRecords.size()), maximumRecords - records.size());
+    if(count == 0) {
+        return;
+    }
+
+    auto fileId = fileIds.constFind(filepath);
+    if(fileId == fileIds.constEnd()) {
+        fileId = fileIds.insert(filepath, static_cast<std::uint32_t>(files.size()));
+        files.append(filepath);
+        fileNames.append(QFileInfo(filepath).fileName());
+        if(sortColumn == FileColumn) {
+            updateFileRanks();
+        }
+    }
+
+    const std::size_t first = records.size();
+    if(!indexed) {
+        beginInsertRows(QModelIndex(), static_cast<int>(first), static_cast<int>(first + count - 1));
+    }
+    if(fileRuns.empty() || fileRuns.back().file != fileId.value()) {
+        fileRuns.push_back(FileRun{first, fileId.value()});
+    }
+    records.insert(records.end(), newRecords.begin(), newRecords.begin() + static_cast<int>(count));
+    if(!indexed) {
+        endInsertRows();
+        return;
+    }
+
+    if(sortColumn >= 0) {
+        // sorted: merged with the others appended until the timer fires.
+        for(std::size_t record = first; record < records.size(); record++) {
+            if(rowFilter.accepts(records[record])) {
+                appendedRows.push_back(static_cast<std::uint32_t>(record));
+            }
+        }
+        if(!appendedRows.empty() && !mergeTimer.isActive()) {
+            mergeTimer.start();
+        }
+        return;
+    }
+
+    std::vector<std::uint32_t> added;
+    for(std::size_t record = first; record < records.size(); record++) {
+        if(rowFilter.accepts(records[record])) {
+            added.push_back(static_cast<std::uint32_t>(record));
+        }
+    }
+    if(added.empty()) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), static_cast<int>(rows.size()), static_cast<int>(rows.size() + added.size() - 1));
+    rows.insert(rows.end(), added.begin(), added.end());
+    endInsertRows();
+}
+
+
+void ResultTableModel::mergeAppended()
+{
+    mergeTimer.stop();
+    if(appendedRows.empty()) {
+        return;
+    }
+
+    // the new rows are sorted on their own, then merged in. both are stable, so equal rows stay
+    // in the order the records came.
+    auto less = [this](std::uint32_t a, std::uint32_t b) { return lessThan(a, b); };
+    std::stable_sort(appendedRows.begin(), appendedRows.end(), less);
+    changeLayout([this, &less]() {
+        const std::size_t middle = rows.size();
+        rows.insert(rows.end(), appendedRows.begin(), appendedRows.end());
+        std::inplace_merge(rows.begin(), rows.begin() + static_cast<std::ptrdiff_t>(middle), rows.end(), less);
+    });
+    appendedRows.clear();
+}
+
+
+void ResultTableModel::clear()
+{
+    beginResetModel();
+    records.clear();
+    records.shrink_to_fit();
+    fileRuns.clear();
+    files.clear();
+    fileNames.clear();
+    fileIds.clear();
+    fileRanks.clear();
+    rebuild();
+    endResetModel();
+}
+
+
+std::uint32_t ResultTableModel::fileOf(std::size_t record) const
+{
+    const auto run = std::upper_bound(fileRuns.begin(), fileRuns.end(), record,
+                                      [](std::size_t index, const FileRun& run) { return index < run.first; });
+    return std::prev(run)->file;
+}
+
+
+void ResultTableModel::updateFileRanks()
+{
+    std::vector<std::uint32_t> order(static_cast<std::size_t>(files.size()));
+    for(std::size_t file = 0; file < order.size(); file++) {
+        order[file] = static_cast<std::uint32_t>(file);
+    }
+    std::sort(order.begin(), order.end(), [this](std::uint32_t a, std::uint32_t b) {
+        return files[static_cast<int>(a)] < files[static_cast<int>(b)];
+    });
+    fileRanks.resize(order.size());
+    for(std::size_t rank = 0; rank < order.size(); rank++) {
+        fileRanks[order[rank]] = static_cast<std::uint32_t>(rank);
+    }
+}
+
+
+bool ResultTableModel::lessThan(std::uint32_t a, std::uint32_t b) const
+{
+    if(sortOrder == Qt::DescendingOrder) {
+        std::swap(a, b);
+    }
+    const StageRecord& left = records[a];
+    const StageRecord& right = records[b];
+    switch(sortColumn) {
+    case FileColumn:
+        return fileRanks[fileOf(a)] < fileRanks[fileOf(b)];
+    case LineColumn:
+        return left.line < right.line;
+    case StageColumn:
+        return left.stage < right.stage;
+    case ValueColumn:
+        // records without a value sort before all values.
+        if(left.error != right.error) {
+            return right.error == FieldError::None || (left.error != FieldError::None && left.error < right.error);
+        }
+        return left.value < right.value;
+    default:
+        return false;
+    }
+}
+
+
+void ResultTableModel::rebuild()
+{
+    // from all the records, those waiting to be merged too.
+    mergeTimer.stop();
+    appendedRows.clear();
+    rows.clear();
+    indexed = sortColumn >= 0 || !rowFilter.isEmpty();
+    if(!indexed) {
+        rows.shrink_to_fit();
+        return;
+    }
+
+    if(rowFilter.isEmpty()) {
+        rows.resize(records.size());
+        for(std::size_t record = 0; record < records.size(); record++) {
+            rows[record] = static_cast<std::uint32_t>(record);
+        }
+    }
+    else {
+        for(std::size_t record = 0; record < records.size(); record++) {
+            if(rowFilter.accepts(records[record])) {
+                rows.push_back(static_cast<std::uint32_t>(record));
+            }
+        }
+    }
+
+    if(sortColumn == FileColumn) {
+        updateFileRanks();
+    }
+    if(sortColumn >= 0) {
+        std::stable_sort(rows.begin(), rows.end(), [this](std::uint32_t a, std::uint32_t b) { return lessThan(a, b); });
+    }
+}
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef RESULTTABLEMODEL_H
+#define RESULTTABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "stageseries.h"
+
+
+// which records a ResultTableModel shows, all of them by default.
+struct ResultFilter
+{
+    std::uint32_t stageFrom = 0;
+    std::uint32_t stageTo = std::numeric_limits<std::uint32_t>::max();
+    std::int64_t valueFrom = std::numeric_limits<std::int64_t>::min();
+    std::int64_t valueTo = std::numeric_limits<std::int64_t>::max();
+
+    bool accepts(const StageRecord& record) const
+    {
+        if(record.stage < stageFrom || record.stage > stageTo) {
+            return false;
+        }
+        // a record without a value is in no range of values.
+        if(record.error != FieldError::None) {
+            return valueFrom == std::numeric_limits<std::int64_t>::min() &&
+                   valueTo == std::numeric_limits<std::int64_t>::max();
+        }
+        return record.value >= valueFrom && record.value <= valueTo;
+    }
+
+    bool isEmpty() const { return *this == ResultFilter(); }
+
+    bool operator==(const ResultFilter& other) const
+    {
+        return stageFrom == other.stageFrom && stageTo == other.stageTo &&
+               valueFrom == other.valueFrom && valueTo == other.valueTo;
+    }
+};
+
+
+// the records of a scan as a table (file, line, stage, value), for millions of them.
+//
+// the records are kept as they arrive, flat in one vector, and the file they come from only per
+// run of records (a scan sends the records of a file together). nothing is converted to strings
+// up front: data() formats a cell only when the view shows it.
+//
+// sorting and filtering do not copy records either, they build a vector of record indices (4 bytes
+// a row), and only if there is a sort order or a filter, otherwise rows are the records as they
+// came. records arriving while sorted are collected and merged into place a few times a second,
+// not per batch, as every merge goes through all the rows.
+class ResultTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column
+    {
+        FileColumn,
+        LineColumn,
+        StageColumn,
+        ValueColumn,
+        ColumnCount
+    };
+
+    explicit ResultTableModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    // a column < 0 restores the order the records came in.
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    void setFilter(const ResultFilter &filter);
+    const ResultFilter& filter() const { return rowFilter; }
+
+    // records found in 'filepath', after those already in the model.
+    void append(const QString &filepath, const QVector<StageRecord> &newRecords);
+    // merges the records appended while sorted now, rather than with the next merge (e.g. when
+    // the scan is done).
+    void mergeAppended();
+    void clear();
+
+    // the record shown in a row, and the file it was found in.
+    const StageRecord& record(int row) const { return records[recordAt(row)]; }
+    QString filepath(int row) const { return files[static_cast<int>(fileOf(recordAt(row)))]; }
+
+    // all the records, shown or filtered out.
+    std::size_t recordCount() const { return records.size(); }
+
+private:
+    struct FileRun
+    {
+        std::size_t first;      // index of the first record of the run
+        std::uint32_t file;     // index into 'files'
+    };
+
+    std::size_t recordAt(int row) const { return indexed ? rows[static_cast<std::size_t>(row)] : static_cast<std::size_t>(row); }
+    std::uint32_t fileOf(std::size_t record) const;
+    // the files in path order, for sorting by file.
+    void updateFileRanks();
+    bool lessThan(std::uint32_t a, std::uint32_t b) const;
+    template<typename Change>
+    void changeLayout(Change change);
+    // the rows for the current sort order and filter, from scratch.
+    void rebuild();
+
+    std::vector<StageRecord> records;
+    std::vector<FileRun> fileRuns;
+    QStringList files;
+    QStringList fileNames;
+    QHash<QString, std::uint32_t> fileIds;
+    std::vector<std::uint32_t> fileRanks;
+
+    ResultFilter rowFilter;
+    int sortColumn = -1;
+    Qt::SortOrder sortOrder = Qt::AscendingOrder;
+
+    // with a sort order or a filter, the record shown in each row.
+    bool indexed = false;
+    std::vector<std::uint32_t> rows;
+    // appended while sorted, not merged into the rows yet.
+    std::vector<std::uint32_t> appendedRows;
+    QTimer mergeTimer;
+};
+
+#endif // #ifndef RESULTTABLEMODEL_H
@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "ruleset.h"
+#include "matcher.h"
+
+#include <algorithm>
+#include <fstream>
+#include <regex>
+#include <set>
+
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+
+// the next whitespace separated word of 'line' from 'at', 'at' is moved past it.
+static std::string_view nextWord(std::string_view line, std::size_t& at)
+{
+    while(at < line.size() && isSpace(line[at])) {
+        at++;
+    }
+    const std::size_t begin = at;
+    while(at < line.size() && !isSpace(line[at])) {
+        at++;
+    }
+    return line.substr(begin, at - begin);
+}
+
+
+// 'fields' is "a,b,c", "a,b=3" or "-".
+static bool parseFields(std::string_view fields, ScanRule& rule, std::string& error)
+{
+    if(fields == "-") {
+        return true;
+    }
+
+    std::size_t nextGroup = 1;
+    std::size_t begin = 0;
+    for(;;) {
+        const std::size_t end = std::min(fields.find(',', begin), fields.size());
+        std::string_view field = fields.substr(begin, end - begin);
+
+        std::size_t group = nextGroup;
+        const std::size_t equals = field.find('=');
+        if(equals != std::string_view::npos) {
+            const std::string number(field.substr(equals + 1));
+            group = 0;
+            for(char c : number) {
+                if(c < '0' || c > '9' || group > rule.captureCount) {
+                    group = 0;
+                    break;
+                }
+                group = group * 10 + static_cast<std::size_t>(c - '0');
+            }
+            field = field.substr(0, equals);
+        }
+
+        FieldType type = FieldType::Text;
+        const std::size_t colon = field.find(':');
+        if(colon != std::string_view::npos) {
+            if(!parseFieldType(field.substr(colon + 1), type)) {
+                error = "field '" + std::string(field) + "' has an unknown type (text, int, float, duration or hex)";
+                return false;
+            }
+            field = field.substr(0, colon);
+        }
+
+        if(field.empty()) {
+            error = "empty field name";
+            return false;
+        }
+        if(group == 0 || group > rule.captureCount) {
+            error = "field '" + std::string(field) + "' has no capture group in the pattern";
+            return false;
+        }
+
+        rule.fields.emplace_back(field);
+        rule.fieldGroups.push_back(group);
+        rule.fieldTypes.push_back(type);
+        nextGroup = group + 1;
+
+        if(end == fields.size()) {
+            return true;
+        }
+        begin = end + 1;
+    }
+}
+
+
+bool RuleSet::load(const std::string& filepath, std::string& error)
+{
+    std::ifstream stream(filepath, std::ios::in | std::ios::binary);
+    if(!stream.good()) {
+        error = filepath + ": cannot open the rule file";
+        return false;
+    }
+    if(!parse(stream, error)) {
+        error = filepath + ":" + error;
+        return false;
+    }
+    return true;
+}
+
+
+bool RuleSet::parse(std::istream& stream, std::string& error)
+{
+    std::vector<ScanRule> parsed;
+    std::set<std::string> names;
+
+    std::string text;
+    for(std::size_t lineNumber = 1; std::getline(stream, text); lineNumber++) {
+        const std::string_view line(text);
+        auto fail = [&error, lineNumber](const std::string& message) {
+            error = std::to_string(lineNumber) + ": " + message;
+            return false;
+        };
+
+        std::size_t at = 0;
+        const std::string_view name = nextWord(line, at);
+        if(name.empty() || name[0] == '#') {
+            continue;
+        }
+        const std::string_view fields = nextWord(line, at);
+        while(at < line.size() && isSpace(line[at])) {
+            at++;
+        }
+        std::string_view pattern = line.substr(at);
+        while(!pattern.empty() && isSpace(pattern.back())) {
+            pattern.remove_suffix(1);
+        }
+        if(fields.empty() || pattern.empty()) {
+            return fail("expected '<name> <fields> <pattern>'");
+        }
+        if(!names.insert(std::string(name)).second) {
+            return fail("duplicate rule '" + std::string(name) + "'");
+        }
+
+        ScanRule rule;
+        rule.name = std::string(name);
+        rule.pattern = std::string(pattern);
+        try {
+            rule.captureCount = createMatcher(rule.pattern)->captureCount();
+        }
+        catch(const std::regex_error& exception) {
+            return fail("invalid pattern: " + std::string(exception.what()));
+        }
+
+        std::string fieldError;
+        if(!parseFields(fields, rule, fieldError)) {
+            return fail(fieldError);
+        }
+
+        parsed.push_back(std::move(rule));
+    }
+
+    if(stream.bad()) {
+        error = "read error";
+        return false;
+    }
+
+    ruleList = std::move(parsed);
+    return true;
+}
+
+
+// "(rule0)|(rule1)|...", and the group of each rule in it.
+static std::string combinePatterns(const RuleSet& rules, std::vector<std::size_t>& groupBases)
+{
+    if(rules.empty()) {
+        // nothing can match.
+        return "[^\\s\\S]";
+    }
+
+    std::string pattern;
+    std::size_t group = 1;
+    for(const ScanRule& rule : rules.rules()) {
+        if(!pattern.empty()) {
+            pattern += '|';
+        }
+        pattern += '(' + rule.pattern + ')';
+        groupBases.push_back(group);
+        group += 1 + rule.captureCount;
+    }
+    return pattern;
+}
+
+
+RuleScanner::RuleScanner(const RuleSet& rules, MatcherBackend backend)
+    : rules(rules),
+      combinedPattern(combinePatterns(rules, groupBases)),
+      logScanner(combinedPattern, LogScanner::defaultChunkSize, backend)
+{
+}
+
+
+RuleMatch RuleScanner::ruleMatch(const ScanMatch& match) const
+{
+    std::size_t rule = 0;
+    while(rule + 1 < groupBases.size() && match.group(groupBases[rule]).data() == nullptr) {
+        rule++;
+    }
+    return RuleMatch{rule, &rules.rules()[rule], &match, groupBases[rule]};
+}
+
+
+bool RuleScanner::scanFile(const std::string& filepath, const RuleCallback& callback) const
+{
+    if(rules.empty()) {
+        return true;
+    }
+
+    return logScanner.scanFile(filepath,
+                               [this, &callback](const ScanMatch& match) {
+                                    return callback(ruleMatch(match));
+                               });
+}
+
+
+bool RuleScanner::scanView(std::string_view data, const RuleCallback& callback) const
+{
+    if(rules.empty()) {
+        return true;
+    }
+
+    return logScanner.scanView(data,
+                               [this, &callback](const ScanMatch& match) {
+                                    return callback(ruleMatch(match));
+                               });
+}
+
+
+bool RuleScanner::scanRange(std::string_view data, std::size_t from, std::size_t until,
+                            const RuleCallback& callback) const
+{
+    if(rules.empty()) {
+        return true;
+    }
+
+    return logScanner.scanRange(data, from, until,
+                                [this, &callback](const ScanMatch& match) {
+                                     return callback(ruleMatch(match));
+                                });
+}
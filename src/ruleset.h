@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef RULESET_H
+#define RULESET_H
+
+#include <cstddef>
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fieldvalue.h"
+#include "logscanner.h"
+
+
+// a named pattern, and the names of the fields its capture groups are extracted into.
+struct ScanRule
+{
+    std::string name;
+    std::string pattern;
+    std::vector<std::string> fields;
+    std::vector<std::size_t> fieldGroups;   // capture group (1 based, within 'pattern') of each field
+    std::size_t captureCount = 0;
+    std::vector<FieldType> fieldTypes;      // of each field, text where none is given
+
+    FieldType fieldType(std::size_t index) const
+    {
+        return index < fieldTypes.size() ? fieldTypes[index] : FieldType::Text;
+    }
+};
+
+
+// a list of rules, read from a rule file like resources/scan_rules.txt:
+//
+//   # comment
+//   <name> <fields> <pattern>
+//
+// - name: unique name of the rule.
+// - fields: comma separated field names, one per capture group in order, or 'name=N' to take
+//   capture group N, or '-' for none. 'name:type' (or 'name:type=N') parses the field as an int,
+//   float, duration or hex number (see FieldType), by default it is text.
+// - pattern: ECMAScript regular expression, the rest of the line after the fields.
+class RuleSet
+{
+public:
+    // on failure 'error' says what is wrong and where, and the rule set is left unchanged.
+    bool load(const std::string& filepath, std::string& error);
+    bool parse(std::istream& stream, std::string& error);
+
+    void add(const ScanRule& rule) { ruleList.push_back(rule); }
+
+    const std::vector<ScanRule>& rules() const { return ruleList; }
+    std::size_t size() const { return ruleList.size(); }
+    bool empty() const { return ruleList.empty(); }
+
+private:
+    std::vector<ScanRule> ruleList;
+};
+
+
+// one match of one rule, only valid for the duration of the callback (like ScanMatch).
+struct RuleMatch
+{
+    std::size_t rule;           // index of the rule in the RuleSet
+    const ScanRule* definition;
+    const ScanMatch* match;
+    std::size_t groupBase;      // group of the whole rule in the combined pattern
+
+    std::string_view field(std::size_t index) const
+    {
+        return match->group(groupBase + definition->fieldGroups[index]);
+    }
+    FieldValue value(std::size_t index) const
+    {
+        return parseField(definition->fieldType(index), field(index));
+    }
+    std::size_t fieldCount() const { return definition->fields.size(); }
+};
+
+
+// matches all the rules of a RuleSet in a single pass over the log.
+//
+// the rules are compiled into one automaton, as alternatives of a single pattern with a capture
+// group around each rule, so the log is read once, whatever the number of rules. the group that
+// took part in a match tells which rule it was.
+// like any alternation, matches do not overlap: where several rules match at the same position,
+// the first one in the rule set wins.
+class RuleScanner
+{
+public:
+    using RuleCallback = std::function<bool(const RuleMatch& match)>;
+
+    // throws std::regex_error if a pattern is not valid.
+    explicit RuleScanner(const RuleSet& rules, MatcherBackend backend = MatcherBackend::Builtin);
+
+    // returns false if the scan was stopped by the callback, or on a read error.
+    bool scanFile(const std::string& filepath, const RuleCallback& callback) const;
+    bool scanView(std::string_view data, const RuleCallback& callback) const;
+    // as LogScanner::scanRange().
+    bool scanRange(std::string_view data, std::size_t from, std::size_t until, const RuleCallback& callback) const;
+
+    // for progress/cancellation, threads and scan mode.
+    LogScanner& scanner() { return logScanner; }
+    const LogScanner& scanner() const { return logScanner; }
+
+    // the combined pattern, which is all the matches depend on besides the log.
+    const std::string& pattern() const { return combinedPattern; }
+
+    const RuleSet& ruleSet() const { return rules; }
+
+private:
+    // build a RuleMatch from a match of the combined pattern.
+    RuleMatch ruleMatch(const ScanMatch& match) const;
+
+    RuleSet rules;
+    std::vector<std::size_t> groupBases;
+    std::string combinedPattern;
+    LogScanner logScanner;
+};
+
+#endif // #ifndef RULESET_H
@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "scanmetrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+
+namespace
+{
+
+// a trace holds at most this many spans (32 bytes each), the rest are counted as dropped.
+constexpr std::size_t maximumTraceEvents = 1024 * 1024;
+
+struct TraceEvent
+{
+    const char* name;
+    std::uint64_t start;
+    std::uint64_t duration;
+    std::uint32_t thread;
+};
+
+std::atomic<std::uint64_t> counters[ScanMetrics::CounterCount];
+
+std::atomic<bool> tracingEnabled{false};
+// bumped by every startTracing(), so spans of an earlier trace still in a thread's buffer are dropped.
+std::atomic<std::uint32_t> traceGeneration{0};
+std::atomic<std::uint32_t> nextThread{1};
+
+std::mutex traceMutex;
+std::vector<TraceEvent> traceEvents;
+std::uint64_t droppedEvents = 0;
+std::uint64_t traceStart = 0;
+
+
+// the spans of one thread, handed over to the trace when its outermost span ends (a shard, a
+// file), so a thread of the pool does not hold on to them, and when the thread exits.
+struct ThreadTrace
+{
+    std::vector<TraceEvent> events;
+    std::uint32_t generation = 0;
+    std::uint32_t thread = nextThread++;
+    int depth = 0;
+
+    ~ThreadTrace() { flush(); }
+
+    void flush()
+    {
+        if(events.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(traceMutex);
+        if(generation == traceGeneration) {
+            const std::size_t room = maximumTraceEvents - std::min(maximumTraceEvents, traceEvents.size());
+            const std::size_t taken = std::min(room, events.size());
+            traceEvents.insert(traceEvents.end(), events.begin(), events.begin() + static_cast<std::ptrdiff_t>(taken));
+            droppedEvents += events.size() - taken;
+        }
+        events.clear();
+    }
+};
+
+thread_local ThreadTrace threadTrace;
+
+
+void writeJsonString(std::ostream& out, const char* text)
+{
+    out << '"';
+    for(; *text != '\0'; text++) {
+        if(*text == '"' || *text == '\\') {
+            out << '\\';
+        }
+        out << *text;
+    }
+    out << '"';
+}
+
+} // namespace
+
+
+const char* ScanMetrics::counterName(Counter counter)
+{
+    switch(counter) {
+    case BytesRead:
+        return "bytes_read";
+    case Candidates:
+        return "candidates";
+    case Matches:
+        return "matches";
+    case Allocations:
+        return "allocations";
+    case IoWaitNanoseconds:
+        return "io_wait_ns";
+    case MatchNanoseconds:
+        return "match_ns";
+    case CounterCount:
+        break;
+    }
+    return "";
+}
+
+
+void ScanMetrics::add(Counter counter, std::uint64_t value)
+{
+    counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+
+ScanMetrics::Snapshot ScanMetrics::snapshot()
+{
+    Snapshot snapshot;
+    for(int counter = 0; counter < CounterCount; counter++) {
+        snapshot.values[counter] = counters[counter].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+
+void ScanMetrics::reset()
+{
+    for(std::atomic<std::uint64_t>& counter : counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+void ScanMetrics::startTracing()
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+    traceEvents.clear();
+    droppedEvents = 0;
+    traceStart = now();
+    traceGeneration++;
+    tracingEnabled = true;
+}
+
+
+void ScanMetrics::stopTracing()
+{
+    tracingEnabled = false;
+}
+
+
+bool ScanMetrics::tracing()
+{
+    return tracingEnabled.load(std::memory_order_relaxed);
+}
+
+
+bool ScanMetrics::writeTrace(const std::string& filepath)
+{
+    threadTrace.flush();
+
+    std::ofstream out(filepath, std::ios::out | std::ios::trunc);
+    if(!out.good()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    std::vector<bool> named;
+
+    // timestamps and durations in microseconds.
+    char number[64];
+    auto microseconds = [&number](std::uint64_t nanoseconds) -> const char* {
+        std::snprintf(number, sizeof(number), "%.3f", static_cast<double>(nanoseconds) / 1000.0);
+        return number;
+    };
+
+    out << "{\"traceEvents\":[";
+    bool first = true;
+    for(const TraceEvent& event : traceEvents) {
+        if(event.thread >= named.size()) {
+            named.resize(event.thread + 1, false);
+        }
+        if(!named[event.thread]) {
+            named[event.thread] = true;
+            out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << event.thread
+                << ",\"args\":{\"name\":\"scan thread " << event.thread << "\"}}";
+            first = false;
+        }
+        out << (first ? "\n" : ",\n") << "{\"name\":";
+        writeJsonString(out, event.name);
+        out << ",\"cat\":\"scan\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread;
+        out << ",\"ts\":" << microseconds(event.start >= traceStart ? event.start - traceStart : 0);
+        out << ",\"dur\":" << microseconds(event.duration) << "}";
+        first = false;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{";
+    const Snapshot counterValues = snapshot();
+    for(int counter = 0; counter < CounterCount; counter++) {
+        out << "\"" << counterName(static_cast<Counter>(counter)) << "\":" << counterValues.values[counter] << ",";
+    }
+    out << "\"dropped_events\":" << droppedEvents << "}}\n";
+    return out.good();
+}
+
+
+std::uint64_t ScanMetrics::now()
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+ScanMetrics::Span::Span(const char* name, Counter timeCounter)
+    : name(name),
+      timeCounter(timeCounter),
+      traced(tracing())
+{
+    if(traced || timeCounter != CounterCount) {
+        start = now();
+    }
+    if(traced) {
+        threadTrace.depth++;
+    }
+}
+
+
+ScanMetrics::Span::~Span()
+{
+    if(!traced && timeCounter == CounterCount) {
+        return;
+    }
+    const std::uint64_t duration = now() - start;
+    if(timeCounter != CounterCount) {
+        add(timeCounter, duration);
+    }
+    if(traced) {
+        ThreadTrace& trace = threadTrace;
+        const std::uint32_t generation = traceGeneration.load(std::memory_order_relaxed);
+        if(trace.generation != generation) {
+            trace.events.clear();
+            trace.generation = generation;
+        }
+        trace.events.push_back(TraceEvent{name, start, duration, trace.thread});
+        if(--trace.depth == 0) {
+            trace.flush();
+        }
+    }
+}
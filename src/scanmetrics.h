@@ -0,0 +1,96 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SCANMETRICS_H
+#define SCANMETRICS_H
+
+#include "quetzalcoatlus_config.h"
+
+#include <cstdint>
+#include <string>
+
+
+// counters and timing spans of the scan path, to see where the scan time goes.
+//
+// the counters are process wide and always on (when compiled in), relaxed atomics added to once
+// per chunk or per read, never per byte or per match. the spans are only recorded while tracing,
+// into per-thread buffers (up to a fixed number of events), and written as Chrome trace-event
+// JSON, for https://ui.perfetto.dev or chrome://tracing.
+//
+// the scan code uses the SCAN_METRICS_* macros below, which compile to nothing without
+// QUETZALCOATLUS_SCAN_METRICS.
+class ScanMetrics
+{
+public:
+    enum Counter
+    {
+        BytesRead,          // read from a stream, or mapped and scanned
+        Candidates,         // positions the literal prefilter handed to the matcher
+        Matches,
+        Allocations,        // buffers allocated or grown by the scan path
+        IoWaitNanoseconds,  // blocked reading (or decompressing) a streamed log
+        MatchNanoseconds,   // matching the chunks
+        CounterCount
+    };
+
+    struct Snapshot
+    {
+        std::uint64_t values[CounterCount] = {};
+        std::uint64_t operator[](Counter counter) const { return values[counter]; }
+    };
+
+    static const char* counterName(Counter counter);
+
+    static void add(Counter counter, std::uint64_t value);
+    static Snapshot snapshot();
+    static void reset();
+
+    // spans are recorded from startTracing() on, and dropped by it.
+    static void startTracing();
+    static void stopTracing();
+    static bool tracing();
+    // the spans recorded so far, with the counters as metadata. false if the file cannot be written.
+    static bool writeTrace(const std::string& filepath);
+
+    // times its scope: as a trace span while tracing, and into a time counter if it has one.
+    // 'name' has to outlive the trace, a string literal.
+    class Span
+    {
+    public:
+        explicit Span(const char* name, Counter timeCounter = CounterCount);
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* name;
+        Counter timeCounter;
+        bool traced;
+        std::uint64_t start = 0;
+    };
+
+    // nanoseconds on a steady clock.
+    static std::uint64_t now();
+};
+
+
+#if QUETZALCOATLUS_SCAN_METRICS
+
+#define SCAN_METRICS_CONCATENATE_(a, b) a##b
+#define SCAN_METRICS_CONCATENATE(a, b) SCAN_METRICS_CONCATENATE_(a, b)
+
+#define SCAN_METRICS_ADD(counter, value) ScanMetrics::add(ScanMetrics::counter, (value))
+#define SCAN_METRICS_SPAN(name) \
+    const ScanMetrics::Span SCAN_METRICS_CONCATENATE(scanMetricsSpan, __LINE__)(name)
+#define SCAN_METRICS_TIMED_SPAN(name, counter) \
+    const ScanMetrics::Span SCAN_METRICS_CONCATENATE(scanMetricsSpan, __LINE__)(name, ScanMetrics::counter)
+
+#else // #if QUETZALCOATLUS_SCAN_METRICS
+
+#define SCAN_METRICS_ADD(counter, value) static_cast<void>(0)
+#define SCAN_METRICS_SPAN(name) static_cast<void>(0)
+#define SCAN_METRICS_TIMED_SPAN(name, counter) static_cast<void>(0)
+
+#endif // #if QUETZALCOATLUS_SCAN_METRICS
+
+#endif // #ifndef SCANMETRICS_H
@@ -0,0 +1,518 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+// quetzalcoatlus_tests: tests of the scanning core, without the GUI. prints every check that
+// fails, and exits non-zero if any did.
+
+#include "builtinpatterns.h"
+#include "fieldvalue.h"
+#include "lineindex.h"
+#include "logfollower.h"
+#include "logscanner.h"
+#include "matcher.h"
+#include "metricstore.h"
+#include "resultcache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace
+{
+
+int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if(!(condition)) { \
+            std::fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while(false)
+
+
+// a subject made of random pieces, so that patterns find matches, near misses and line breaks.
+std::string randomSubject(std::mt19937& random, const std::vector<std::string>& pieces, std::size_t size)
+{
+    std::string subject;
+    while(subject.size() < size) {
+        subject += pieces[random() % pieces.size()];
+    }
+    return subject;
+}
+
+
+// all matches of the matcher in the subject, left to right, as offsets of every group.
+std::vector<std::vector<std::ptrdiff_t>> allMatches(const Matcher& matcher, std::string_view subject)
+{
+    std::vector<std::vector<std::ptrdiff_t>> matches;
+    const char* begin = subject.data();
+    const char* end = subject.data() + subject.size();
+    MatchResult result;
+    for(const char* from = begin; from <= end && matcher.search(begin, end, from, result);) {
+        std::vector<std::ptrdiff_t> groups;
+        for(const char* group : result.groups) {
+            groups.push_back(group != nullptr ? group - begin : -1);
+        }
+        matches.push_back(groups);
+        from = (result.end() == result.begin()) ? result.end() + 1 : result.end();
+    }
+    return matches;
+}
+
+
+void checkSameMatches(const std::string& pattern, MatcherBackend backend, const std::vector<std::string>& pieces)
+{
+    const std::unique_ptr<Matcher> matcher = createMatcher(pattern, backend);
+    const std::unique_ptr<Matcher> reference = createMatcher(pattern, MatcherBackend::StdRegex);
+    std::mt19937 random(7);
+    for(int round = 0; round < 50; round++) {
+        const std::string subject = randomSubject(random, pieces, 1 + random() % 200);
+        const bool same = allMatches(*matcher, subject) == allMatches(*reference, subject);
+        if(!same) {
+            std::string shown = subject;
+            std::replace(shown.begin(), shown.end(), '\n', '|');
+            std::fprintf(stderr, "%s on \"%s\" with %s:\n", pattern.c_str(), shown.c_str(), matcherBackendName(backend));
+        }
+        CHECK(same);
+    }
+}
+
+
+void testAutomatonMatchesStdRegex()
+{
+    const std::vector<std::string> pieces = {"a", "b", "ab", "c", "1", "42", " ", "\n", "x_y", "-", ".", ":"};
+    // no capture in a repetition that can match empty: std::regex does not capture it as ECMAScript does.
+    const char* patterns[] = {
+        "a", "ab|b", "a*", "a+b", "(a|ab)(c|bcd)?", "[a-c]+", "[^ab\\n]+", "\\d+(?:\\.\\d+)?", "(\\w+)\\s*:\\s*(\\d*)",
+        "\\bab\\b", "\\Bb", "^a|b$", "(?:a*)*b", "(a|b)*c", "a{2,3}", "x?(y)?", "(?:a|(b))+", "[\\d.]+", "\\S+\\s",
+    };
+    for(const char* pattern : patterns) {
+        checkSameMatches(pattern, MatcherBackend::Automaton, pieces);
+    }
+}
+
+
+void testBuiltinMatchesStdRegex()
+{
+    const std::vector<std::string> pieces = {"stage", " ", "  ", "\n", "12", "3", ":", " : ", "errors", "warnings",
+                                             "peak memory", "MB", "cpu usage", "%", ".5", "load", " took ", "ms", "s", "x"};
+    const std::string builtins[] = {BuiltinPatterns::stage, BuiltinPatterns::errors, BuiltinPatterns::warnings,
+                                    BuiltinPatterns::timing, BuiltinPatterns::memory, BuiltinPatterns::cpu};
+    for(const std::string& pattern : builtins) {
+        checkSameMatches(pattern, MatcherBackend::Builtin, pieces);
+    }
+    // as RuleScanner combines them.
+    checkSameMatches("(" + builtins[0] + ")|(" + builtins[1] + ")", MatcherBackend::Builtin, pieces);
+    checkSameMatches("(?:" + builtins[3] + ")|(?:" + builtins[5] + ")", MatcherBackend::Builtin, pieces);
+}
+
+
+// (\w+) took ... has no literal to look for first, so it is tried on every byte: a long run of
+// word characters (a base64 blob, a minified line) must not be matched from every byte in it.
+void testBuiltinLongWordRun()
+{
+    const std::string run(80 * 1024, 'a');
+    const std::string patterns[] = {BuiltinPatterns::timing, std::string("(?:") + BuiltinPatterns::stage + ")|(?:" +
+                                                                 BuiltinPatterns::timing + ")|(?:" + BuiltinPatterns::cpu + ")"};
+    for(const std::string& pattern : patterns) {
+        const std::unique_ptr<Matcher> matcher = createMatcher(pattern, MatcherBackend::Builtin);
+        for(const std::string& subject : {run + "\n", run + " took 5 ms\n", "x " + run + " tooks"}) {
+            const auto start = std::chrono::steady_clock::now();
+            MatchResult result;
+            const bool found = matcher->search(subject.data(), subject.data() + subject.size(), subject.data(), result);
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            CHECK(seconds < 1);
+            CHECK(found == (subject.find(" took 5") != std::string::npos));
+            if(found) {
+                CHECK(result.view(0) == std::string_view(subject).substr(0, subject.size() - 1));
+            }
+        }
+    }
+}
+
+
+// matches that run over a newline, in chunks, streamed and in shards, are those of the whole log.
+void testMatchesAcrossChunks()
+{
+    std::mt19937 random(11);
+    const std::vector<std::string> pieces = {"stage 12", "stage", "\n", "   ", " :", ":", " 4\n\n  :", "errors", "x\n"};
+    const std::string log = randomSubject(random, pieces, 64 * 1024);
+    const char* patterns[] = {"stage\\s+(\\d+)\\s*:", "(\\d+)\\s*\\n\\s*:"};
+    for(const char* pattern : patterns) {
+        const std::unique_ptr<Matcher> reference = createMatcher(pattern, MatcherBackend::StdRegex);
+        std::vector<std::uint64_t> expected;
+        for(const std::vector<std::ptrdiff_t>& match : allMatches(*reference, log)) {
+            expected.push_back(static_cast<std::uint64_t>(match[0]));
+            expected.push_back(static_cast<std::uint64_t>(match[1] - match[0]));
+        }
+        CHECK(!expected.empty());
+
+        for(MatcherBackend backend : {MatcherBackend::Builtin, MatcherBackend::Automaton}) {
+            for(unsigned int threads : {0u, 1u, 4u}) {
+                LogScanner scanner(pattern, LogScanner::minimumChunkSize, backend);
+                scanner.setThreadCount(std::max(threads, 1u));
+                std::vector<std::uint64_t> found;
+                const LogScanner::MatchCallback callback = [&found](const ScanMatch& match) {
+                    found.push_back(match.offset);
+                    found.push_back(match.length);
+                    return true;
+                };
+                // 0 threads: streamed.
+                if(threads == 0) {
+                    std::istringstream stream(log);
+                    CHECK(scanner.scanStream(stream, callback));
+                }
+                else {
+                    CHECK(scanner.scanView(log, callback));
+                }
+                CHECK(found == expected);
+            }
+        }
+    }
+}
+
+
+void append(const std::filesystem::path& path, const std::string& text)
+{
+    std::ofstream stream(path, std::ios::binary | std::ios::app);
+    stream << text;
+}
+
+
+// a log written piece by piece and polled after every piece has the matches of the whole log, even
+// those that a poll cut off (the value of a header only written after it).
+void testFollowerAcrossPolls(const std::filesystem::path& directory)
+{
+    const std::filesystem::path log = directory / "followed.log";
+    std::ofstream(log, std::ios::binary | std::ios::trunc).close();
+    const LogScanner scanner(BuiltinPatterns::errors);
+    LogFollower follower(log.string());
+    std::vector<std::uint64_t> found;
+    const LogScanner::MatchCallback callback = [&found](const ScanMatch& match) {
+        found.push_back(match.offset);
+        found.push_back(match.line);
+        return true;
+    };
+
+    append(log, "stage 1:\n  number of errors :\n");
+    CHECK(follower.poll(scanner, callback) == LogFollower::Update::Appended);
+    CHECK(found.empty());
+    append(log, "87\n");
+    CHECK(follower.poll(scanner, callback) == LogFollower::Update::Appended);
+    CHECK((found == std::vector<std::uint64_t>{21, 2}));
+
+    std::mt19937 random(5);
+    const std::vector<std::string> pieces = {"errors", " ", ":", "\n", "1", "23", "stage 4:", "x"};
+    for(MatcherBackend backend : {MatcherBackend::Builtin, MatcherBackend::Automaton}) {
+        const LogScanner followScanner("(?:" + std::string(BuiltinPatterns::errors) + ")|(?:\\d+\\s*\\n\\s*x)",
+                                       LogScanner::minimumChunkSize, backend);
+        std::ofstream(log, std::ios::binary | std::ios::trunc).close();
+        LogFollower followed(log.string());
+        found.clear();
+        std::string written;
+        for(int round = 0; round < 300; round++) {
+            const std::string piece = randomSubject(random, pieces, 1 + random() % 200);
+            append(log, piece);
+            written += piece;
+            CHECK(followed.poll(followScanner, callback) != LogFollower::Update::Stopped);
+        }
+        // the last line is not complete, so it is not scanned yet.
+        append(log, "\n");
+        written += "\n";
+        CHECK(followed.poll(followScanner, callback) != LogFollower::Update::Stopped);
+
+        std::vector<std::uint64_t> expected;
+        CHECK(followScanner.scanView(written, [&expected](const ScanMatch& match) {
+                  expected.push_back(match.offset);
+                  expected.push_back(match.line);
+                  return true;
+              }));
+        CHECK(!expected.empty());
+        CHECK(found == expected);
+    }
+
+    // truncated in place, as copytruncate does: scanned again from the start.
+    std::ofstream(log, std::ios::binary | std::ios::trunc).close();
+    append(log, "errors: 5\n");
+    CHECK(follower.poll(scanner, callback) == LogFollower::Update::Restarted);
+    found.clear();
+    CHECK(follower.poll(scanner, callback) == LogFollower::Update::Appended);
+    CHECK((found == std::vector<std::uint64_t>{0, 1}));
+}
+
+
+void testLineIndexRoundTrip()
+{
+    std::mt19937 random(3);
+    std::string log;
+    std::vector<std::uint64_t> lineStarts = {0};
+    for(int line = 0; line < 5000; line++) {
+        log.append(random() % 40, 'x');
+        log += '\n';
+        lineStarts.push_back(log.size());
+    }
+    log += "no newline";
+
+    // built in one go, and extended in pieces that end anywhere in a line.
+    LineIndex whole(8);
+    whole.extend(log);
+    LineIndex pieces(8);
+    for(std::size_t size = 0; size < log.size();) {
+        size = std::min<std::size_t>(log.size(), size + 1 + random() % 700);
+        pieces.extend(std::string_view(log).substr(0, size));
+    }
+
+    std::stringstream stream;
+    CHECK(whole.write(stream));
+    LineIndex read;
+    CHECK(read.read(stream));
+
+    for(const LineIndex* index : {&whole, &pieces, &read}) {
+        CHECK(index->indexedSize() == log.size());
+        CHECK(index->lineCount() == lineStarts.size());
+        for(std::size_t line = 0; line < lineStarts.size(); line++) {
+            std::uint64_t offset = 0;
+            CHECK(index->lineOffset(log, line + 1, offset) && offset == lineStarts[line]);
+            CHECK(index->lineAt(log, lineStarts[line]) == line + 1);
+            if(line + 1 < lineStarts.size()) {
+                CHECK(index->lineAt(log, lineStarts[line + 1] - 1) == line + 1);
+            }
+        }
+        std::uint64_t offset = 0;
+        CHECK(!index->lineOffset(log, 0, offset));
+        CHECK(!index->lineOffset(log, lineStarts.size() + 1, offset));
+    }
+}
+
+
+void testParseField()
+{
+    FieldValue value = parseField(FieldType::Integer, " -42\r");
+    CHECK(value.error == FieldError::None && value.integer == -42);
+    CHECK(parseField(FieldType::Integer, "+7").integer == 7);
+    CHECK(parseField(FieldType::Integer, "").error == FieldError::Empty);
+    CHECK(parseField(FieldType::Integer, " \t").error == FieldError::Empty);
+    CHECK(parseField(FieldType::Integer, "12a").error == FieldError::Malformed);
+    CHECK(parseField(FieldType::Integer, "1.5").error == FieldError::Malformed);
+    CHECK(parseField(FieldType::Integer, "9223372036854775807").integer == INT64_MAX);
+    value = parseField(FieldType::Integer, "9223372036854775808");
+    CHECK(value.error == FieldError::Overflow && value.integer == 0);
+
+    CHECK(parseField(FieldType::Float, "2.5e3").real == 2500);
+    CHECK(parseField(FieldType::Float, "-.5").real == -0.5);
+    CHECK(parseField(FieldType::Float, "1e999").error == FieldError::Overflow);
+    CHECK(parseField(FieldType::Float, "1.2.3").error == FieldError::Malformed);
+
+    CHECK(parseField(FieldType::Hex, "0x1F").integer == 31);
+    CHECK(parseField(FieldType::Hex, "ff").integer == 255);
+    CHECK(parseField(FieldType::Hex, "0x").error == FieldError::Malformed);
+    CHECK(parseField(FieldType::Hex, "-1").error == FieldError::Malformed);
+    CHECK(parseField(FieldType::Hex, "0xg").error == FieldError::Malformed);
+    CHECK(parseField(FieldType::Hex, "ffffffffffffffff").error == FieldError::Overflow);
+
+    CHECK(parseField(FieldType::Duration, "1h30m").integer == 5400000000000);
+    CHECK(parseField(FieldType::Duration, "250 ms").integer == 250000000);
+    CHECK(parseField(FieldType::Duration, "1.5").integer == 1500000000);
+    CHECK(parseField(FieldType::Duration, "-2s").integer == -2000000000);
+    CHECK(parseField(FieldType::Duration, "01:02:03.5").integer == 3723500000000);
+    CHECK(parseField(FieldType::Duration, "1:").error == FieldError::Malformed);
+    CHECK(parseField(FieldType::Duration, "3 parsecs").error == FieldError::Malformed);
+    CHECK(parseField(FieldType::Duration, "1 2").error == FieldError::Malformed);
+    CHECK(parseField(FieldType::Duration, "999999999d").error == FieldError::Overflow);
+
+    value = parseField(FieldType::Text, "");
+    CHECK(value.error == FieldError::None && !value.isNumber());
+}
+
+
+// the first regular file in 'directory'.
+std::filesystem::path onlyFile(const std::filesystem::path& directory)
+{
+    for(const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory)) {
+        if(entry.is_regular_file()) {
+            return entry.path();
+        }
+    }
+    return std::filesystem::path();
+}
+
+
+void overwrite(const std::filesystem::path& path, std::uint64_t at, const void* bytes, std::size_t size)
+{
+    std::fstream stream(path, std::ios::in | std::ios::out | std::ios::binary);
+    stream.seekp(static_cast<std::streamoff>(at));
+    stream.write(static_cast<const char*>(bytes), static_cast<std::streamsize>(size));
+}
+
+
+void testDamagedResultCache(const std::filesystem::path& directory)
+{
+    const std::filesystem::path log = directory / "cached.log";
+    {
+        std::ofstream stream(log, std::ios::binary);
+        stream << "stage 1:\nerrors: 3\n";
+    }
+    FileIdentity identity;
+    CHECK(ResultCache::identify(log.string(), identity));
+
+    const ResultCache cache((directory / "results").string());
+    const std::vector<StageRecord> records(5);
+    std::vector<StageRecord> loaded;
+    CHECK(cache.store(identity, "patterns", records));
+    CHECK(cache.load(identity, "patterns", loaded) && loaded.size() == records.size());
+    CHECK(!cache.load(identity, "other patterns", loaded));
+
+    // the record count is right before the records.
+    const std::filesystem::path entry = onlyFile(directory / "results");
+    const std::uint64_t size = std::filesystem::file_size(entry);
+    const std::uint64_t countAt = size - records.size() * sizeof(StageRecord) - sizeof(std::uint64_t);
+    for(std::uint64_t count : {std::uint64_t(1) << 60, std::uint64_t(6), std::uint64_t(4)}) {
+        CHECK(cache.store(identity, "patterns", records));
+        overwrite(entry, countAt, &count, sizeof(count));
+        CHECK(!cache.load(identity, "patterns", loaded));
+    }
+
+    CHECK(cache.store(identity, "patterns", records));
+    std::filesystem::resize_file(entry, size - 3);
+    CHECK(!cache.load(identity, "patterns", loaded));
+    std::filesystem::resize_file(entry, 10);
+    CHECK(!cache.load(identity, "patterns", loaded));
+
+    // an index entry cut short.
+    const ResultCache indexCache((directory / "index").string());
+    LineIndex index;
+    index.extend("stage 1:\nerrors: 3\n");
+    CHECK(indexCache.storeLineIndex(log.string(), index));
+    LineIndex loadedIndex;
+    CHECK(indexCache.loadLineIndex(log.string(), loadedIndex) && loadedIndex.lineCount() == 2);
+    const std::filesystem::path indexEntry = onlyFile(directory / "index");
+    std::filesystem::resize_file(indexEntry, std::filesystem::file_size(indexEntry) - 1);
+    CHECK(!indexCache.loadLineIndex(log.string(), loadedIndex));
+}
+
+
+void testMetricStoreReaders(const std::filesystem::path& directory)
+{
+    const std::filesystem::path path = directory / "metrics";
+    std::string error;
+
+    // a query of a store that is not there fails, and leaves nothing behind.
+    MetricStore reader;
+    CHECK(!reader.openReadOnly(path.string(), error));
+    CHECK(!std::filesystem::exists(path));
+
+    MetricStore writer;
+    CHECK(writer.open(path.string(), error));
+    const std::vector<MetricRow> rows = {{"a.log", 1, "errors.count", 3, 10}, {"a.log", 2, "errors.count", 5, 20}};
+    std::uint32_t run = 0;
+    CHECK(writer.appendRun("first", rows, run, error) && run == 0);
+
+    // one writer at a time.
+    MetricStore second;
+    CHECK(!second.open(path.string(), error));
+
+    // a writer in the middle of an append: the columns are longer than the header says.
+    const std::filesystem::path values = path / "value.f64";
+    const std::uint64_t committed = std::filesystem::file_size(values);
+    append(values, std::string(sizeof(double), '\0'));
+    CHECK(reader.openReadOnly(path.string(), error));
+    CHECK(reader.runCount() == 1 && reader.rowCount() == rows.size());
+    std::uint32_t added = 0;
+    CHECK(!reader.appendRun("second", rows, added, error));
+    reader.close();
+    CHECK(std::filesystem::file_size(values) == committed + sizeof(double));
+
+    // the writer cuts it back once it is the only writer again.
+    writer.close();
+    CHECK(second.open(path.string(), error));
+    CHECK(std::filesystem::file_size(values) == committed);
+    CHECK(second.appendRun("second", rows, run, error) && run == 1);
+    second.close();
+    CHECK(reader.openReadOnly(path.string(), error) && reader.runCount() == 2);
+}
+
+
+void testDamagedLineIndex()
+{
+    std::string log;
+    for(int line = 0; line < 1000; line++) {
+        log += "line " + std::to_string(line) + "\n";
+    }
+    LineIndex index(8);
+    index.extend(log);
+    std::ostringstream stream;
+    CHECK(index.write(stream));
+    const std::string bytes = stream.str();
+
+    const auto readsBack = [](const std::string& data) {
+        std::istringstream in(data);
+        LineIndex loaded;
+        return loaded.read(in);
+    };
+    CHECK(readsBack(bytes));
+
+    // magic, version, sampling, then the size, newline and sample counts.
+    constexpr std::size_t sizeAt = 12;
+    constexpr std::size_t newlinesAt = 20;
+    constexpr std::size_t countAt = 29;
+    const auto patched = [&bytes](std::size_t at, std::uint64_t value) {
+        std::string data = bytes;
+        std::memcpy(&data[at], &value, sizeof(value));
+        return data;
+    };
+
+    CHECK(!readsBack(patched(newlinesAt, log.size() + 1)));
+    CHECK(!readsBack(patched(sizeAt, 1)));
+    // counts that agree with each other, but not with what the stream holds.
+    std::string huge = patched(sizeAt, std::uint64_t(1) << 62);
+    std::memcpy(&huge[newlinesAt], &huge[sizeAt], sizeof(std::uint64_t));
+    const std::uint64_t samples = (std::uint64_t(1) << 62) / 8 + 1;
+    std::memcpy(&huge[countAt], &samples, sizeof(samples));
+    CHECK(!readsBack(huge));
+    // an anchor past the end of the log.
+    CHECK(!readsBack(patched(bytes.size() - sizeof(std::uint64_t), log.size() + 1)));
+
+    CHECK(!readsBack(bytes.substr(0, bytes.size() - 4)));
+    CHECK(!readsBack(bytes.substr(0, countAt)));
+    CHECK(!readsBack(std::string()));
+}
+
+} // namespace
+
+
+int main()
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "quetzalcoatlus_tests";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    testAutomatonMatchesStdRegex();
+    testBuiltinMatchesStdRegex();
+    testBuiltinLongWordRun();
+    testMatchesAcrossChunks();
+    testFollowerAcrossPolls(directory);
+    testLineIndexRoundTrip();
+    testParseField();
+    testDamagedResultCache(directory);
+    testMetricStoreReaders(directory);
+    testDamagedLineIndex();
+
+    std::filesystem::remove_all(directory);
+    if(failures != 0) {
+        std::fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    std::printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,305 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "scanworker.h"
+#include "decompressor.h"
+#include "directoryscanner.h"
+#include "mappedfile.h"
+#include "quetzalcoatlus_config.h"
+
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <vector>
+
+
+// file change notifications are not delivered for every filesystem (e.g. network shares),
+// so the followed log is also polled at this interval. a poll without new data is only a
+// stat and a mapping.
+static constexpr int followPollInterval = 1000;
+
+
+ScanWorker::ScanWorker(QObject *parent)
+    : QObject(parent)
+{
+    // for the queued connections.
+    qRegisterMetaType<QVector<StageRecord>>("QVector<StageRecord>");
+    qRegisterMetaType<std::shared_ptr<const LineIndex>>("std::shared_ptr<const LineIndex>");
+}
+
+
+void ScanWorker::cancel()
+{
+    cancelRequested = true;
+}
+
+
+void ScanWorker::setCacheDirectory(const QString &directory)
+{
+    if(QUETZALCOATLUS_RESULT_CACHE_SIZE_MB > 0 && !directory.isEmpty()) {
+        resultCache = std::make_unique<ResultCache>(directory.toStdString(),
+                                                    std::uint64_t(QUETZALCOATLUS_RESULT_CACHE_SIZE_MB) * 1024 * 1024);
+    }
+    else {
+        resultCache.reset();
+    }
+}
+
+
+void ScanWorker::scan(const QString &filepath, const QString &pattern)
+{
+    stopFollowing();
+    cancelRequested = false;
+
+    // size is unknown (0) for pipes and special files.
+    const qint64 totalBytes = QFileInfo(filepath).size();
+    emit started(totalBytes);
+
+    StageSeriesExtractor extractor(pattern.toStdString());
+    std::vector<StageRecord> records;
+    std::size_t recordsSent = 0;
+
+    // taken before the scan, so a log that changes while it is scanned is not cached as unchanged.
+    FileIdentity identity;
+    const bool cacheable = resultCache && ResultCache::identify(filepath.toStdString(), identity);
+    if(cacheable && resultCache->load(identity, extractor.pattern(), records)) {
+        emit recordsFound(QVector<StageRecord>(records.begin(), records.end()));
+        emit progress(totalBytes, totalBytes);
+        emit finished(true);
+        indexLines(filepath);
+        return;
+    }
+
+    auto sendRecords = [this, &records, &recordsSent]() {
+        if(records.size() > recordsSent) {
+            emit recordsFound(QVector<StageRecord>(records.begin() + static_cast<std::ptrdiff_t>(recordsSent),
+                                                   records.end()));
+            recordsSent = records.size();
+        }
+    };
+
+    // large mapped logs are split across all cores.
+    extractor.scanner().setThreadCount(static_cast<unsigned int>(QThread::idealThreadCount()));
+    extractor.scanner().setProgressCallback([this, totalBytes, &sendRecords](std::uint64_t bytesScanned) {
+                                                sendRecords();
+                                                emit progress(static_cast<qint64>(bytesScanned), totalBytes);
+                                                return !cancelRequested;
+                                            });
+
+    const bool completed = extractor.extract(filepath.toStdString(), records) && !cancelRequested;
+    sendRecords();
+
+    FileIdentity identityAfter;
+    if(completed && cacheable && ResultCache::identify(filepath.toStdString(), identityAfter) &&
+       identityAfter == identity) {
+        resultCache->store(identity, extractor.pattern(), records);
+    }
+
+    emit finished(completed);
+    if(completed) {
+        indexLines(filepath);
+    }
+}
+
+
+void ScanWorker::indexLines(const QString &filepath)
+{
+    // compressed logs have no offsets to index into.
+    const std::string path = filepath.toStdString();
+    MappedFile file;
+    if(detectCompression(path) != Compression::None || !file.open(path)) {
+        return;
+    }
+
+    LineIndex index;
+    if(resultCache && resultCache->loadLineIndex(path, index) && index.indexedSize() > file.view().size()) {
+        // truncated since it was checked.
+        index.clear();
+    }
+    const std::uint64_t indexedBefore = index.indexedSize();
+    index.extend(file.view());
+    if(resultCache && index.indexedSize() != indexedBefore) {
+        resultCache->storeLineIndex(path, index);
+    }
+
+    emit lineIndexReady(filepath, std::make_shared<const LineIndex>(std::move(index)));
+}
+
+
+void ScanWorker::scanDirectory(const QString &path, const QString &pattern)
+{
+    stopFollowing();
+    cancelRequested = false;
+
+    const std::vector<std::string> files = DirectoryScanner::expand({path.toStdString()});
+    qint64 totalBytes = 0;
+    for(const std::string& file : files) {
+        totalBytes += QFileInfo(QString::fromStdString(file)).size();
+    }
+    emit started(totalBytes);
+
+    // the same stage series as scan(), as a rule set.
+    RuleSet rules;
+    rules.add(ScanRule{"stage", StageSeriesExtractor::defaultStagePattern, {"stage"}, {1}, 1, {FieldType::Integer}});
+    const std::string valuePattern = pattern.toStdString();
+    rules.add(ScanRule{"value", valuePattern, {"value"}, {1}, createMatcher(valuePattern)->captureCount(),
+                       {FieldType::Integer}});
+
+    DirectoryScanner scanner(rules);
+    scanner.setThreadCount(static_cast<unsigned int>(QThread::idealThreadCount()));
+
+    qint64 bytesScanned = 0;
+    const bool completed = scanner.scan(files,
+                                        [this, totalBytes, &bytesScanned](const FileScanResult& result) {
+        QVector<StageRecord> records;
+        std::uint32_t stage = 0;
+        for(const RuleRecord& record : result.records) {
+            const FieldValue& value = result.value(record, 0);
+            if(record.rule == 0) {
+                if(value.error == FieldError::None) {
+                    stage = static_cast<std::uint32_t>(value.integer);
+                }
+            }
+            else {
+                records.push_back(StageRecord{record.offset, record.line, value.integer, stage, value.error});
+            }
+        }
+
+        emit fileScanned(QString::fromStdString(result.path), records, result.completed);
+        bytesScanned += static_cast<qint64>(result.size);
+        emit progress(bytesScanned, totalBytes);
+        return !cancelRequested;
+    });
+
+    emit finished(completed && !cancelRequested);
+}
+
+
+void ScanWorker::follow(const QString &filepath, const QString &pattern)
+{
+    stopFollowing();
+    cancelRequested = false;
+
+    const qint64 totalBytes = QFileInfo(filepath).size();
+    emit started(totalBytes);
+
+    followExtractor = std::make_unique<StageSeriesExtractor>(pattern.toStdString());
+    follower = std::make_unique<LogFollower>(filepath.toStdString());
+    followStage = 0;
+    followRecords.clear();
+    followRecordsSent = 0;
+    followSentUntil = 0;
+
+    // the first poll scans the whole log, streamed on this thread: a log that is being written
+    // is never mapped (see LogFollower).
+    LogScanner& scanner = followExtractor->scanner();
+    scanner.setProgressCallback([this, totalBytes](std::uint64_t bytesScanned) {
+                                    sendFollowRecords();
+                                    emit progress(static_cast<qint64>(bytesScanned), totalBytes);
+                                    return !cancelRequested;
+                                });
+
+    const LogFollower::Update update = pollFollowed();
+    if(update == LogFollower::Update::Stopped || update == LogFollower::Update::Missing) {
+        stopFollowing();
+        emit finished(false);
+        return;
+    }
+    emit finished(true);
+    indexLines(filepath);
+
+    // from here on only appended data is scanned, which is small, so no progress.
+    scanner.setProgressCallback([this](std::uint64_t) {
+                                    sendFollowRecords();
+                                    return !cancelRequested;
+                                });
+
+    // the directory is watched too, to notice the log being re-created after a rotation.
+    watcher = new QFileSystemWatcher(this);
+    watcher->addPath(filepath);
+    watcher->addPath(QFileInfo(filepath).absolutePath());
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &ScanWorker::refreshFollowed);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &ScanWorker::refreshFollowed);
+
+    pollTimer = new QTimer(this);
+    pollTimer->setInterval(followPollInterval);
+    connect(pollTimer, &QTimer::timeout, this, &ScanWorker::refreshFollowed);
+    pollTimer->start();
+}
+
+
+void ScanWorker::stopFollowing()
+{
+    if(watcher != nullptr) {
+        watcher->deleteLater();
+        watcher = nullptr;
+    }
+    if(pollTimer != nullptr) {
+        pollTimer->stop();
+        pollTimer->deleteLater();
+        pollTimer = nullptr;
+    }
+    follower.reset();
+    followExtractor.reset();
+    followRecords.clear();
+    followRecordsSent = 0;
+    followSentUntil = 0;
+}
+
+
+void ScanWorker::refreshFollowed()
+{
+    if(!follower) {
+        return;
+    }
+
+    // a watched file that is removed or renamed drops out of the watcher, add it back once
+    // the log has been re-created.
+    const QString filepath = QString::fromStdString(follower->path());
+    if(!watcher->files().contains(filepath) && QFileInfo::exists(filepath)) {
+        watcher->addPath(filepath);
+    }
+
+    pollFollowed();
+}
+
+
+LogFollower::Update ScanWorker::pollFollowed()
+{
+    LogFollower::Update update = followExtractor->extractAppended(*follower, followStage, followRecords);
+    if(update == LogFollower::Update::Restarted) {
+        followStage = 0;
+        followRecords.clear();
+        followRecordsSent = 0;
+        followSentUntil = 0;
+        emit followRestarted();
+        update = followExtractor->extractAppended(*follower, followStage, followRecords);
+    }
+
+    sendFollowRecords();
+    followRecords.clear();
+    followRecordsSent = 0;
+    if(update == LogFollower::Update::Appended) {
+        emit followAppended();
+    }
+    return update;
+}
+
+
+void ScanWorker::sendFollowRecords()
+{
+    // a cancelled poll drops the records it found, some of which may have been sent already, and
+    // the next poll finds them again: those are skipped by their offset.
+    followRecordsSent = std::min(followRecordsSent, followRecords.size());
+    auto first = followRecords.begin() + static_cast<std::ptrdiff_t>(followRecordsSent);
+    while(first != followRecords.end() && first->offset < followSentUntil) {
+        ++first;
+    }
+    if(first != followRecords.end()) {
+        emit recordsFound(QVector<StageRecord>(first, followRecords.end()));
+        followSentUntil = followRecords.back().offset + 1;
+    }
+    followRecordsSent = followRecords.size();
+}
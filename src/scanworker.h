@@ -0,0 +1,102 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef SCANWORKER_H
+#define SCANWORKER_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "lineindex.h"
+#include "logfollower.h"
+#include "resultcache.h"
+#include "stageseries.h"
+
+
+QT_BEGIN_NAMESPACE
+class QFileSystemWatcher;
+class QTimer;
+QT_END_NAMESPACE
+
+
+Q_DECLARE_METATYPE(StageRecord)
+Q_DECLARE_METATYPE(std::shared_ptr<const LineIndex>)
+
+
+// runs log scans off the GUI thread.
+// move it to a QThread, and talk to it only through queued signals/slots,
+// except for cancel() which is safe to call from any thread.
+class ScanWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ScanWorker(QObject *parent = nullptr);
+
+    void cancel();
+
+    // keep the results of complete scans in this directory, so an unchanged log is not scanned
+    // again. call before the worker is moved to its thread.
+    void setCacheDirectory(const QString &directory);
+
+public slots:
+    // extract every match of the pattern in the file, with the stage it belongs to.
+    void scan(const QString &filepath, const QString &pattern);
+
+    // scan every log of a directory tree, or matching a glob, on all cores.
+    // the records come per file, through fileScanned(), as soon as each file is done.
+    void scanDirectory(const QString &path, const QString &pattern);
+
+    // scan the file like scan(), then keep watching it and scan only what gets appended.
+    // a truncated or rotated log is scanned again from the start, after followRestarted().
+    void follow(const QString &filepath, const QString &pattern);
+    void stopFollowing();
+
+signals:
+    void started(qint64 totalBytes);
+    void progress(qint64 bytesScanned, qint64 totalBytes);
+    // records arrive in batches, in file order, as the scan goes.
+    void recordsFound(const QVector<StageRecord> &records);
+    // completed is false if the scan was cancelled or failed.
+    void finished(bool completed);
+    void fileScanned(const QString &filepath, const QVector<StageRecord> &records, bool completed);
+    // the followed log was truncated or replaced, the records found so far are stale.
+    void followRestarted();
+    // the followed log has grown, with or without new records.
+    void followAppended();
+    // the line index of a scanned (or followed) log, sent after finished().
+    void lineIndexReady(const QString &filepath, std::shared_ptr<const LineIndex> index);
+
+private slots:
+    void refreshFollowed();
+
+private:
+    // builds the line index of the log, from the one cached for it if the log was only appended to.
+    void indexLines(const QString &filepath);
+
+    // poll the followed log once, sending any new records.
+    LogFollower::Update pollFollowed();
+    void sendFollowRecords();
+
+    std::atomic<bool> cancelRequested{false};
+
+    std::unique_ptr<ResultCache> resultCache;
+
+    // follow mode state, only touched on the worker's thread.
+    std::unique_ptr<StageSeriesExtractor> followExtractor;
+    std::unique_ptr<LogFollower> follower;
+    std::uint32_t followStage = 0;
+    std::vector<StageRecord> followRecords;
+    std::size_t followRecordsSent = 0;
+    // end of the records sent so far: a stopped poll is scanned again, records before it are not sent twice.
+    std::uint64_t followSentUntil = 0;
+    QFileSystemWatcher *watcher = nullptr;
+    QTimer *pollTimer = nullptr;
+};
+
+#endif // #ifndef SCANWORKER_H
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "stageseries.h"
+
+
+// number of capture groups in a pattern, the same way the scanner counts them.
+static std::size_t captureCount(const std::string& pattern)
+{
+    return createMatcher(pattern)->captureCount();
+}
+
+
+// the stage pattern comes first, so group 1 is the stage number, and the value pattern's
+// first group follows all of the stage pattern's groups.
+StageSeriesExtractor::StageSeriesExtractor(const std::string& valuePattern, const std::string& stagePattern,
+                                           MatcherBackend backend)
+    : combinedPattern("(?:" + stagePattern + ")|(?:" + valuePattern + ")"),
+      logScanner(combinedPattern, LogScanner::defaultChunkSize, backend),
+      valueGroup(captureCount(stagePattern) + 1)
+{
+}
+
+
+void StageSeriesExtractor::addMatch(const ScanMatch& match, std::uint32_t& stage,
+                                    std::vector<StageRecord>& records) const
+{
+    const std::string_view stageNumber = match.group(1);
+    if(stageNumber.data() != nullptr) {
+        const FieldValue number = parseField(FieldType::Integer, stageNumber);
+        if(number.error == FieldError::None) {
+            stage = static_cast<std::uint32_t>(number.integer);
+        }
+        return;
+    }
+
+    // a value that is not a number we can represent is kept, with its error, rather than
+    // silently dropped: the table shows why, and a value filter leaves it out.
+    const FieldValue value = parseField(FieldType::Integer, match.group(valueGroup));
+    records.push_back(StageRecord{match.offset, match.line, value.integer, stage, value.error});
+}
+
+
+bool StageSeriesExtractor::extract(const std::string& filepath, std::vector<StageRecord>& records) const
+{
+    std::uint32_t stage = 0;
+
+    return logScanner.scanFile(filepath,
+                               [&](const ScanMatch& match) {
+                                    addMatch(match, stage, records);
+                                    return true;
+                               });
+}
+
+
+LogFollower::Update StageSeriesExtractor::extractAppended(LogFollower& follower, std::uint32_t& stage,
+                                                          std::vector<StageRecord>& records) const
+{
+    const std::uint32_t stageBefore = stage;
+    const std::size_t recordsBefore = records.size();
+
+    const LogFollower::Update update = follower.poll(logScanner,
+                                                     [&](const ScanMatch& match) {
+                                                          addMatch(match, stage, records);
+                                                          return true;
+                                                     });
+    if(update == LogFollower::Update::Stopped) {
+        // the follower scans the same lines again next time.
+        stage = stageBefore;
+        records.resize(recordsBefore);
+    }
+    return update;
+}
@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef STAGESERIES_H
+#define STAGESERIES_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "builtinpatterns.h"
+#include "fieldvalue.h"
+#include "logfollower.h"
+#include "logscanner.h"
+
+
+// one value extracted from a log, with the stage it belongs to.
+// kept small and flat, as a log can have hundreds of thousands of these.
+struct StageRecord
+{
+    std::uint64_t offset;   // byte offset of the match in the file
+    std::uint64_t line;     // line number (1 based) of the match
+    std::int64_t value;     // the captured number, 0 if it is not one (see error)
+    std::uint32_t stage;    // number of the last "stage N:" header before the match, 0 if none
+    FieldError error = FieldError::None;    // why the capture is not a number we can represent
+};
+
+
+// extracts every match of a value pattern (e.g. "errors : 87") as a per-stage series,
+// in a single pass over the log: the stage headers and the values are matched together,
+// as alternatives of one pattern.
+class StageSeriesExtractor
+{
+public:
+    static constexpr const char* defaultStagePattern = BuiltinPatterns::stage;
+
+    // the first capture group of the value pattern is the value.
+    explicit StageSeriesExtractor(const std::string& valuePattern,
+                                  const std::string& stagePattern = defaultStagePattern,
+                                  MatcherBackend backend = MatcherBackend::Builtin);
+
+    // records are appended to 'records', returns false if the scan was stopped or failed.
+    bool extract(const std::string& filepath, std::vector<StageRecord>& records) const;
+
+    // records from the lines appended to a followed log since the last call.
+    // 'stage' is the stage at the end of what has been scanned so far, carried from call to call,
+    // and has to be reset to 0 when the follower restarts. a Stopped poll takes back its records
+    // and the next one finds them again, so a caller that passed some on has to skip them by offset.
+    LogFollower::Update extractAppended(LogFollower& follower, std::uint32_t& stage,
+                                        std::vector<StageRecord>& records) const;
+
+    // for progress/cancellation, threads and scan mode.
+    LogScanner& scanner() { return logScanner; }
+
+    // the combined pattern, which is all the records depend on besides the log.
+    const std::string& pattern() const { return combinedPattern; }
+
+private:
+    // a stage header updates 'stage', a value is appended to 'records'.
+    void addMatch(const ScanMatch& match, std::uint32_t& stage, std::vector<StageRecord>& records) const;
+
+    std::string combinedPattern;
+    LogScanner logScanner;
+    // group of the value capture in the combined pattern.
+    std::size_t valueGroup;
+};
+
+#endif // #ifndef STAGESERIES_H
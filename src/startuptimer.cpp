@@ -0,0 +1,35 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "startuptimer.h"
+
+#include <QDebug>
+
+
+StartupTimer::StartupTimer()
+{
+    timer.start();
+}
+
+
+void StartupTimer::mark(const char *phase)
+{
+    const qint64 now = timer.nsecsElapsed();
+    phases.append(Phase{phase, now - lastMark});
+    lastMark = now;
+}
+
+
+void StartupTimer::report(qint64 budgetMs) const
+{
+    qDebug() << "";
+    qDebug() << "Startup Phases                :" << (QElapsedTimer::isMonotonic() ? "(monotonic clock)" : "(not monotonic clock)");
+    for(const Phase &phase : phases) {
+        qDebug().noquote() << QString("  %1: %2 ms").arg(phase.name, -28).arg(phase.nanoseconds / 1e6, 0, 'f', 1);
+    }
+    const double totalMs = lastMark / 1e6;
+    qDebug().noquote() << QString("  %1: %2 ms").arg("total", -28).arg(totalMs, 0, 'f', 1);
+    if(budgetMs > 0 && totalMs > budgetMs) {
+        qWarning().noquote() << QString("startup took %1 ms, over the budget of %2 ms").arg(totalMs, 0, 'f', 1).arg(budgetMs);
+    }
+    qDebug() << "";
+}
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef STARTUPTIMER_H
+#define STARTUPTIMER_H
+
+#include <QElapsedTimer>
+#include <QVector>
+
+
+// times the phases of the application startup with a monotonic clock, so a cold start can be
+// held to a budget. each mark() ends the phase that began at the previous mark, or at
+// construction for the first one (so construct it first thing in main()).
+class StartupTimer
+{
+public:
+    StartupTimer();
+
+    void mark(const char *phase);
+
+    qint64 elapsedMs() const { return timer.elapsed(); }
+
+    // logs every phase and the total, and warns if the total is over budgetMs (0: no budget).
+    void report(qint64 budgetMs) const;
+
+private:
+    struct Phase
+    {
+        const char *name;
+        qint64 nanoseconds;
+    };
+
+    QElapsedTimer timer;
+    qint64 lastMark = 0;
+    QVector<Phase> phases;
+};
+
+#endif // #ifndef STARTUPTIMER_H
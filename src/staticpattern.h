@@ -0,0 +1,422 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef STATICPATTERN_H
+#define STATICPATTERN_H
+
+#include "matcher.h"
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+
+// regular expressions spelled as types, so that the compiler generates the matcher: every node
+// is inlined into the next, and a pattern becomes straight-line code with tight loops for its
+// repetitions, instead of a program the automaton interprets. e.g. errors\s*:\s*(\d+) is
+//
+//   Sequence<Literal<'e', 'r', 'r', 'o', 'r', 's'>, Star<Space>, Literal<':'>, Star<Space>,
+//            Capture<1, Plus<Digit>>>
+//
+// matching backtracks, with the leftmost-first (ECMAScript) semantics of the other matchers:
+// each node is handed the rest of the pattern as a continuation, and calls it for every way it
+// can match, greedy first. backtracking can blow up on patterns that nest repetitions, so this
+// is only for the patterns that ship with the tool (see builtinpatterns.h), never user patterns.
+// those are linear in the length of the subject: no repetition in them is followed by another
+// one that can match the same bytes, and a search does not retry inside a run that begins a
+// pattern and already failed (see LeadingRun).
+namespace staticpattern
+{
+
+// a match attempt: the subject, and the capture slots (begin/end pairs, as in MatchResult).
+// hitEnd is set by any node that looked at the end of the subject, where more input could have
+// made it match (or match more).
+struct Context
+{
+    const char* begin;
+    const char* end;
+    const char** groups;
+    bool* hitEnd;
+};
+
+
+// byte classes, as in the automaton.
+struct Digit
+{
+    static constexpr bool contains(unsigned char c) { return c >= '0' && c <= '9'; }
+};
+
+struct Space
+{
+    static constexpr bool contains(unsigned char c)
+    {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+    }
+};
+
+struct Word
+{
+    static constexpr bool contains(unsigned char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+};
+
+
+// every node has:
+// - match(context, at, next): true if the node matches at 'at' and next(end of the node's match)
+//   returns true, trying the ways it can match in order.
+// - canStart(c): whether a match of the node can begin with the byte c.
+// - nullable: whether it can match without consuming anything.
+
+template<char... Bytes>
+struct Literal
+{
+    static constexpr std::size_t size = sizeof...(Bytes);
+    static constexpr char bytes[size + 1] = {Bytes..., '\0'};
+    static constexpr bool nullable = (size == 0);
+
+    static constexpr bool canStart(unsigned char c) { return size > 0 && static_cast<unsigned char>(bytes[0]) == c; }
+
+    template<typename Next>
+    static bool match(const Context& context, const char* at, const Next& next)
+    {
+        const std::size_t available = static_cast<std::size_t>(context.end - at);
+        if(available < size) {
+            *context.hitEnd = *context.hitEnd || std::memcmp(at, bytes, available) == 0;
+            return false;
+        }
+        std::size_t index = 0;
+        if(!((at[index++] == Bytes) && ...)) {
+            return false;
+        }
+        return next(at + size);
+    }
+};
+
+
+constexpr std::size_t unbounded = ~std::size_t(0);
+
+// greedy repetition of a byte class, {Min,Max}: takes as many bytes as it can in one loop, then
+// gives them back one at a time until the rest of the pattern matches.
+template<std::size_t Min, std::size_t Max, typename Class>
+struct Repeat
+{
+    static constexpr bool nullable = (Min == 0);
+
+    static constexpr bool canStart(unsigned char c) { return Max > 0 && Class::contains(c); }
+
+    template<typename Next>
+    static bool match(const Context& context, const char* at, const Next& next)
+    {
+        const char* limit = context.end;
+        if(Max != unbounded && static_cast<std::size_t>(limit - at) > Max) {
+            limit = at + Max;
+        }
+        const char* stop = at;
+        while(stop < limit && Class::contains(static_cast<unsigned char>(*stop))) {
+            stop++;
+        }
+        if(stop == context.end) {
+            *context.hitEnd = true;
+        }
+        if(static_cast<std::size_t>(stop - at) < Min) {
+            return false;
+        }
+        for(const char* until = stop; ; until--) {
+            if(next(until)) {
+                return true;
+            }
+            if(until == at + Min) {
+                return false;
+            }
+        }
+    }
+};
+
+template<typename Class>
+using One = Repeat<1, 1, Class>;
+
+template<typename Class>
+using Star = Repeat<0, unbounded, Class>;
+
+template<typename Class>
+using Plus = Repeat<1, unbounded, Class>;
+
+
+template<typename... Nodes>
+struct Sequence;
+
+template<>
+struct Sequence<>
+{
+    static constexpr bool nullable = true;
+
+    static constexpr bool canStart(unsigned char) { return false; }
+
+    template<typename Next>
+    static bool match(const Context&, const char* at, const Next& next)
+    {
+        return next(at);
+    }
+};
+
+template<typename First, typename... Rest>
+struct Sequence<First, Rest...>
+{
+    static constexpr bool nullable = First::nullable && Sequence<Rest...>::nullable;
+
+    static constexpr bool canStart(unsigned char c)
+    {
+        return First::canStart(c) || (First::nullable && Sequence<Rest...>::canStart(c));
+    }
+
+    template<typename Next>
+    static bool match(const Context& context, const char* at, const Next& next)
+    {
+        return First::match(context, at, [&context, &next](const char* from) {
+            return Sequence<Rest...>::match(context, from, next);
+        });
+    }
+};
+
+
+// the first alternative that lets the rest of the pattern match.
+template<typename... Alternatives>
+struct Alternation;
+
+template<>
+struct Alternation<>
+{
+    static constexpr bool nullable = false;
+
+    static constexpr bool canStart(unsigned char) { return false; }
+
+    template<typename Next>
+    static bool match(const Context&, const char*, const Next&)
+    {
+        return false;
+    }
+};
+
+template<typename First, typename... Rest>
+struct Alternation<First, Rest...>
+{
+    static constexpr bool nullable = First::nullable || Alternation<Rest...>::nullable;
+
+    static constexpr bool canStart(unsigned char c) { return First::canStart(c) || Alternation<Rest...>::canStart(c); }
+
+    template<typename Next>
+    static bool match(const Context& context, const char* at, const Next& next)
+    {
+        return First::match(context, at, next) || Alternation<Rest...>::match(context, at, next);
+    }
+};
+
+
+// greedy: (...)?
+template<typename Node>
+struct Optional
+{
+    static constexpr bool nullable = true;
+
+    static constexpr bool canStart(unsigned char c) { return Node::canStart(c); }
+
+    template<typename Next>
+    static bool match(const Context& context, const char* at, const Next& next)
+    {
+        return Node::match(context, at, next) || next(at);
+    }
+};
+
+
+// capture group 'Group' (1 based), left as it was if the rest of the pattern does not match.
+template<std::size_t Group, typename Node>
+struct Capture
+{
+    static constexpr bool nullable = Node::nullable;
+
+    static constexpr bool canStart(unsigned char c) { return Node::canStart(c); }
+
+    template<typename Next>
+    static bool match(const Context& context, const char* at, const Next& next)
+    {
+        const char** slot = context.groups + 2 * Group;
+        const char* previousBegin = slot[0];
+        const char* previousEnd = slot[1];
+        if(Node::match(context, at, [slot, at, &next](const char* end) {
+               slot[0] = at;
+               slot[1] = end;
+               return next(end);
+           })) {
+            return true;
+        }
+        slot[0] = previousBegin;
+        slot[1] = previousEnd;
+        return false;
+    }
+};
+
+
+// \b
+struct WordBoundary
+{
+    static constexpr bool nullable = true;
+
+    static constexpr bool canStart(unsigned char) { return false; }
+
+    template<typename Next>
+    static bool match(const Context& context, const char* at, const Next& next)
+    {
+        const bool wordBefore = at != context.begin && Word::contains(static_cast<unsigned char>(at[-1]));
+        const bool wordAfter = at != context.end && Word::contains(static_cast<unsigned char>(*at));
+        if(at == context.end) {
+            *context.hitEnd = true;
+        }
+        return wordBefore != wordAfter && next(at);
+    }
+};
+
+
+// a pattern that begins with a greedy, unbounded repetition of a byte class (\w+ in
+// (\w+) took ...) tries every end of the run at the first start, and what follows the run does
+// not depend on where it began. once an attempt inside a run failed, no later start in the same
+// run can match, so searches skip to the end of the run: otherwise a long run, with no literal to
+// look for first, is matched from every byte in it, quadratic in its length.
+template<typename Node>
+struct LeadingRun
+{
+    static constexpr bool exists = false;
+
+    static constexpr bool contains(unsigned char) { return false; }
+};
+
+template<std::size_t Min, typename Class>
+struct LeadingRun<Repeat<Min, unbounded, Class>>
+{
+    static constexpr bool exists = true;
+
+    static constexpr bool contains(unsigned char c) { return Class::contains(c); }
+};
+
+template<std::size_t Group, typename Node>
+struct LeadingRun<Capture<Group, Node>> : LeadingRun<Node>
+{
+};
+
+template<typename First, typename... Rest>
+struct LeadingRun<Sequence<First, Rest...>> : LeadingRun<First>
+{
+};
+
+
+// where the next attempt may start, after the one at 'at' failed.
+template<typename Pattern>
+const char* resumeAfterFailure(const char* at, const char* end)
+{
+    if(LeadingRun<Pattern>::exists && at < end && LeadingRun<Pattern>::contains(static_cast<unsigned char>(*at))) {
+        while(at < end && LeadingRun<Pattern>::contains(static_cast<unsigned char>(*at))) {
+            at++;
+        }
+        return at;
+    }
+    return at + 1;
+}
+
+
+// the bytes a match can begin with, as a table.
+template<typename Pattern>
+constexpr std::array<bool, 256> startBytes()
+{
+    std::array<bool, 256> bytes{};
+    for(int c = 0; c < 256; c++) {
+        bytes[static_cast<std::size_t>(c)] = Pattern::canStart(static_cast<unsigned char>(c));
+    }
+    return bytes;
+}
+
+// the only byte a match can begin with, -1 if there are several.
+template<typename Pattern>
+constexpr int onlyStartByte()
+{
+    int only = -1;
+    for(int c = 0; c < 256; c++) {
+        if(Pattern::canStart(static_cast<unsigned char>(c))) {
+            if(only >= 0) {
+                return -1;
+            }
+            only = c;
+        }
+    }
+    return only;
+}
+
+} // namespace staticpattern
+
+
+// a Matcher for a pattern spelled as a staticpattern type, with 'Captures' capture groups.
+template<typename Pattern, std::size_t Captures>
+class StaticMatcher : public Matcher
+{
+public:
+    bool search(const char* begin, const char* end, const char* from, MatchResult& result) const override
+    {
+        const char* partial = nullptr;
+        bool found = false;
+        for(const char* at = from; at <= end && !found;) {
+            if(!Pattern::nullable) {
+                // skip to the next byte a match can begin with.
+                if(onlyStart >= 0) {
+                    at = static_cast<const char*>(std::memchr(at, onlyStart, static_cast<std::size_t>(end - at)));
+                    if(at == nullptr) {
+                        break;
+                    }
+                }
+                else {
+                    while(at < end && !starts[static_cast<unsigned char>(*at)]) {
+                        at++;
+                    }
+                    if(at == end) {
+                        break;
+                    }
+                }
+            }
+            found = matchAt(begin, end, at, result);
+            partial = (partial != nullptr) ? partial : result.partialBegin;
+            at = staticpattern::resumeAfterFailure<Pattern>(at, end);
+        }
+        result.partialBegin = partial;
+        return found;
+    }
+
+    bool matchAt(const char* begin, const char* end, const char* at, MatchResult& result) const override
+    {
+        result.partialBegin = nullptr;
+        if(!Pattern::nullable && (at == end || !starts[static_cast<unsigned char>(*at)])) {
+            return false;
+        }
+        result.groups.assign(2 * (Captures + 1), nullptr);
+        bool hitEnd = false;
+        const staticpattern::Context context{begin, end, result.groups.data(), &hitEnd};
+        const char* matchEnd = nullptr;
+        const bool matched = Pattern::match(context, at, [&matchEnd](const char* stop) {
+                                                matchEnd = stop;
+                                                return true;
+                                            });
+        result.partialBegin = hitEnd ? at : nullptr;
+        if(!matched) {
+            return false;
+        }
+        result.groups[0] = at;
+        result.groups[1] = matchEnd;
+        return true;
+    }
+
+    std::size_t captureCount() const override { return Captures; }
+    const char* name() const override { return "static"; }
+
+private:
+    static constexpr std::array<bool, 256> starts = staticpattern::startBytes<Pattern>();
+    static constexpr int onlyStart = staticpattern::onlyStartByte<Pattern>();
+};
+
+#endif // #ifndef STATICPATTERN_H
@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#include "taskscheduler.h"
+
+#include <algorithm>
+
+
+// the scheduler and queue of the pool thread running the current task, if any.
+static thread_local TaskScheduler* currentScheduler = nullptr;
+static thread_local unsigned int currentQueue = 0;
+
+
+TaskScheduler::TaskScheduler(unsigned int threads)
+{
+    if(threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for(unsigned int index = 0; index < threads; index++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for(unsigned int index = 0; index < threads; index++) {
+        workers.emplace_back(&TaskScheduler::run, this, index);
+    }
+}
+
+
+TaskScheduler::~TaskScheduler()
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+
+void TaskScheduler::submit(Task task)
+{
+    const unsigned int index = (currentScheduler == this)
+                               ? currentQueue
+                               : nextQueue.fetch_add(1, std::memory_order_relaxed) % threadCount();
+
+    pending.fetch_add(1);
+    queued.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+
+    // taking the lock orders this against a thread that just found nothing and is about to sleep.
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wake.notify_one();
+}
+
+
+void TaskScheduler::wait()
+{
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    done.wait(lock, [this]() { return pending.load() == 0; });
+}
+
+
+bool TaskScheduler::take(unsigned int index, Task& task)
+{
+    {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for(unsigned int offset = 1; offset < threadCount(); offset++) {
+        Queue& victim = *queues[(index + offset) % threadCount()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void TaskScheduler::run(unsigned int index)
+{
+    currentScheduler = this;
+    currentQueue = index;
+
+    for(;;) {
+        Task task;
+        if(take(index, task)) {
+            queued.fetch_sub(1);
+            task();
+            // release whatever the task holds before it counts as done.
+            task = nullptr;
+
+            if(pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(sleepMutex);
+                done.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this]() { return stopping || queued.load() > 0; });
+        if(stopping && queued.load() == 0) {
+            return;
+        }
+    }
+}
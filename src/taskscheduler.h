@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: BSD-3-Clause
+
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// pool of threads with a work-stealing scheduler.
+//
+// every thread has its own queue: it takes its tasks from the back of it (last in, first out,
+// which keeps what a task just submitted hot in the cache), and when it runs dry it steals from
+// the front of the others' queues, which holds the oldest and usually largest pieces of work.
+// so no thread idles while there is work anywhere in the pool, however uneven the tasks are.
+class TaskScheduler
+{
+public:
+    using Task = std::function<void()>;
+
+    // 0 threads means one per hardware thread.
+    explicit TaskScheduler(unsigned int threads = 0);
+    // waits for the submitted tasks to complete.
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // from a task, the new task goes to the queue of the thread running it,
+    // from anywhere else, the queues take turns. as a thread runs its own tasks last in, first out,
+    // of tasks submitted together the last ones start first.
+    void submit(Task task);
+
+    // wait until all the submitted tasks, and the tasks they submitted, have completed.
+    void wait();
+
+    unsigned int threadCount() const { return static_cast<unsigned int>(workers.size()); }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void run(unsigned int index);
+    // own queue first, then steal.
+    bool take(unsigned int index, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<std::size_t> queued{0};     // tasks waiting in the queues
+    std::atomic<std::size_t> pending{0};    // tasks submitted and not completed yet
+    std::atomic<unsigned int> nextQueue{0};
+
+    // idle threads, and wait(), sleep on these.
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    bool stopping = false;
+};
+
+#endif // #ifndef TASKSCHEDULER_H
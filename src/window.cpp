@@ -10,6 +10,7 @@
 #include <QAction>
 #include <QCheckBox>
 #include <QComboBox>
+#include <QDialog>
 #include <QCoreApplication>
 #include <QCloseEvent>
 #include <QGroupBox>
@@ -18,21 +19,33 @@
 #include <QMenu>
 #include <QPushButton>
 #include <QSpinBox>
+#include <QTableView>
+#include <QSplitter>
+#include <QHeaderView>
 #include <QTextEdit>
 #include <QVBoxLayout>
 #include <QMessageBox>
 #include <QFileDialog>
-#include <QMovie>
+#include <QFileInfo>
 #include <QProgressDialog>
 #include <QDebug>
 #include <QSpacerItem>
 #include <QStatusBar>
 #include <QMenuBar>
 #include <QDialogButtonBox>
+#include <QThread>
+#include <QStandardPaths>
+#include <QTimer>
 
-#include <iostream>
-#include <regex>
-#include <fstream>
+#include <algorithm>
+
+#include "quetzalcoatlus_config.h"
+#include "animationplayer.h"
+#include "builtinpatterns.h"
+#include "iconcache.h"
+#include "logview.h"
+#include "resulttablemodel.h"
+#include "scanworker.h"
 
 
 // https://stackoverflow.com/questions/240353/convert-a-preprocessor-token-to-a-string
@@ -49,8 +62,10 @@ Window::Window()
     createSimpleGroupBox();
     createActions();
     createMenus();
+    createScanWorker();
+    createResultView();
 
-    QIcon icon(":/images/logo_256x256.png");
+    const QIcon icon = IconCache::icon(":/images/logo_256x256.png");
 
 #ifndef QT_NO_SYSTEMTRAYICON
     createTrayIcon();
@@ -64,6 +79,7 @@ Window::Window()
 
     QVBoxLayout *centraWidgetLayout = new QVBoxLayout;
     centraWidgetLayout->addWidget(simpleGroupBox);
+    centraWidgetLayout->addWidget(resultWidget, 1);
     QWidget *widget = new QWidget();
     widget->setLayout(centraWidgetLayout);
 
@@ -80,6 +96,14 @@ Window::Window()
 
 }
 
+Window::~Window()
+{
+    scanWorker->cancel();
+    scanThread->quit();
+    scanThread->wait();
+}
+
+
 void Window::setVisible(bool visible)
 {
     minimizeAction->setEnabled(visible);
@@ -132,6 +156,17 @@ void Window::changeEvent(QEvent *event)
 }
 
 
+void Window::paintEvent(QPaintEvent *event)
+{
+    QMainWindow::paintEvent(event);
+    if(!painted) {
+        painted = true;
+        // queued, so the frame is flushed to the screen first.
+        QTimer::singleShot(0, this, &Window::firstFramePainted);
+    }
+}
+
+
 void Window::closeEvent(QCloseEvent *event)
 {
     // close event originated outside application (system event?)
@@ -169,7 +204,7 @@ void Window::iconActivated(QSystemTrayIcon::ActivationReason reason)
 void Window::showMessage()
 {
     QSystemTrayIcon::MessageIcon msgIcon = QSystemTrayIcon::MessageIcon(QSystemTrayIcon::Information);
-    QIcon icon(":/images/logo_256x256.png");
+    const QIcon icon = IconCache::icon(":/images/logo_256x256.png");
     trayIcon->showMessage("This is TITLE",
                           "This is BODY",
                           icon,
@@ -209,15 +244,15 @@ void Window::createSimpleGroupBox()
     simpleComboBox = new QComboBox;
     simpleComboBox->setIconSize(QSize(120,100));
     simpleComboBox->setStyleSheet("QComboBox { background-color: gray; color: black; }");
-    simpleComboBox->addItem(QIcon(":/images/sun.svg"), "Sun");
-    simpleComboBox->addItem(QIcon(":/images/mercury.svg"), "Mercury");
-    simpleComboBox->addItem(QIcon(":/images/venus.svg"), "Venus");
-    simpleComboBox->addItem(QIcon(":/images/earth.svg"), "Earth");
-    simpleComboBox->addItem(QIcon(":/images/mars.svg"), "Mars");
-    simpleComboBox->addItem(QIcon(":/images/jupiter.svg"), "Jupiter");
-    simpleComboBox->addItem(QIcon(":/images/saturn.svg"), "Saturn");
-    simpleComboBox->addItem(QIcon(":/images/uranus.svg"), "Uranus");
-    simpleComboBox->addItem(QIcon(":/images/neptune.svg"), "Neptune");
+    simpleComboBox->addItem(IconCache::icon(":/images/sun.svg"), "Sun");
+    simpleComboBox->addItem(IconCache::icon(":/images/mercury.svg"), "Mercury");
+    simpleComboBox->addItem(IconCache::icon(":/images/venus.svg"), "Venus");
+    simpleComboBox->addItem(IconCache::icon(":/images/earth.svg"), "Earth");
+    simpleComboBox->addItem(IconCache::icon(":/images/mars.svg"), "Mars");
+    simpleComboBox->addItem(IconCache::icon(":/images/jupiter.svg"), "Jupiter");
+    simpleComboBox->addItem(IconCache::icon(":/images/saturn.svg"), "Saturn");
+    simpleComboBox->addItem(IconCache::icon(":/images/uranus.svg"), "Uranus");
+    simpleComboBox->addItem(IconCache::icon(":/images/neptune.svg"), "Neptune");
     simpleComboBox->setCurrentIndex(simpleComboBox->findText("Jupiter"));
 
     simpleSpinBoxLabel = new QLabel(tr("SpinBox"));
@@ -237,8 +272,8 @@ void Window::createSimpleGroupBox()
 
     simplePixmapLabelLabel = new QLabel(tr("PixmapLabel"));
     simplePixmapLabel = new QLabel();
-    // pixmap from a svg, via QIcon (or use QIcon directly):
-    QPixmap p = QIcon(":/images/accretion_disk.svg").pixmap(QSize(93,80)); // use original image w,h or multiple.
+    // pixmap from a svg, pre-rendered or rendered once (see IconCache):
+    QPixmap p = IconCache::pixmap(":/images/accretion_disk.svg", QSize(93,80), devicePixelRatioF()); // use original image w,h or multiple.
     if(!p.isNull()) {
         simplePixmapLabel->setPixmap(p);
     }
@@ -246,50 +281,78 @@ void Window::createSimpleGroupBox()
     // simplePixmapLabel->setMovie(selectedGif);
     // selectedGif->start();
 
+    // one player and one dialog for every click, the frames are decoded once and kept (within a
+    // budget) while the dialog is open or was closed recently. the first frame is decoded now,
+    // during startup, so the dialog opens at once.
+    accretionDiskPlayer = new AnimationPlayer(":/gif/accretion_disk.gif",
+                                              qint64(QUETZALCOATLUS_ANIMATION_FRAME_BUDGET_MB) * 1024 * 1024,
+                                              QUETZALCOATLUS_ANIMATION_RELEASE_SECONDS * 1000,
+                                              this);
+    accretionDiskPlayer->prepare();
+    accretionDiskDialog = nullptr;
+
 
     // https://stackoverflow.com/questions/31580362/qt-creating-icon-button
     simplePixmapPushButtonLabel = new QLabel(tr("PixmapPushButton"));
     simplePixmapPushButton = new QPushButton();
     simplePixmapPushButton->setToolTip("Click to view an accretion disk!");
-    simplePixmapPushButton->setIcon(QIcon(":/images/accretion_disk.svg"));
+    simplePixmapPushButton->setIcon(IconCache::icon(":/images/accretion_disk.svg"));
     simplePixmapPushButton->setIconSize(QSize(93,80)); // use original image w,h or multiple.
     simplePixmapPushButton->setFixedSize(QSize(93+10,80+10));
     QObject::connect(simplePixmapPushButton, &QPushButton::released,
                      this,
                      [this]() {
 
-                        // https://stackoverflow.com/questions/41079412/qt-show-gif-on-qdialog
-                        QDialog* gifContainerDialog = new QDialog(this);
-                        gifContainerDialog->setWindowModality(Qt::WindowModal);
-                        gifContainerDialog->setWindowTitle("Accretion Disk");
+                        if(accretionDiskDialog == nullptr) {
+                            // https://stackoverflow.com/questions/41079412/qt-show-gif-on-qdialog
+                            accretionDiskDialog = new QDialog(this);
+                            accretionDiskDialog->setWindowModality(Qt::WindowModal);
+                            accretionDiskDialog->setWindowTitle("Accretion Disk");
 
-                        QVBoxLayout* gifContainerDialogLayout = new QVBoxLayout();
-                        gifContainerDialog->setLayout(gifContainerDialogLayout);
+                            QVBoxLayout* gifContainerDialogLayout = new QVBoxLayout();
+                            accretionDiskDialog->setLayout(gifContainerDialogLayout);
 
-                        QLabel* gifContainerLabel = new QLabel();
-                        QMovie* selectedGif = new QMovie(":/gif/accretion_disk.gif");
-                        gifContainerLabel->setMovie(selectedGif);
-                        gifContainerDialogLayout->addWidget(gifContainerLabel);
+                            QLabel* gifContainerLabel = new QLabel();
+                            gifContainerLabel->setFixedSize(accretionDiskPlayer->frameSize());
+                            QObject::connect(accretionDiskPlayer, &AnimationPlayer::frameChanged,
+                                             gifContainerLabel, &QLabel::setPixmap);
+                            gifContainerDialogLayout->addWidget(gifContainerLabel);
 #if (QT_VERSION < QT_VERSION_CHECK(6, 5, 3))
-                        gifContainerDialogLayout->setMargin(0);
+                            gifContainerDialogLayout->setMargin(0);
 #else
-                        gifContainerDialogLayout->setContentsMargins(0, 0, 0, 0);
+                            gifContainerDialogLayout->setContentsMargins(0, 0, 0, 0);
 #endif
 
-                        // disallow resizing, but still adjust to content size.
-                        // https://stackoverflow.com/questions/696209/non-resizeable-qdialog-with-fixed-size-in-qt
-                        gifContainerDialog->layout()->setSizeConstraint( QLayout::SetFixedSize );
-                        
-                        selectedGif->start();
-                        gifContainerDialog->show();
+                            // disallow resizing, but still adjust to content size.
+                            // https://stackoverflow.com/questions/696209/non-resizeable-qdialog-with-fixed-size-in-qt
+                            accretionDiskDialog->layout()->setSizeConstraint( QLayout::SetFixedSize );
+
+                            // only play while it is shown, the frames are freed a while after.
+                            QObject::connect(accretionDiskDialog, &QDialog::finished,
+                                             accretionDiskPlayer, &AnimationPlayer::stop);
+                        }
+
+                        accretionDiskPlayer->start();
+                        accretionDiskDialog->show();
+                        accretionDiskDialog->raise();
+                        accretionDiskDialog->activateWindow();
                      }
                     );
 
     fileSelectLabel = new QLabel(tr("Select Log File"));
     fileSelectTextEdit = new QLineEdit();
-    fileSelectTextEdit->setPlaceholderText("Enter Path or Browse to Log File");
+    fileSelectTextEdit->setPlaceholderText("Enter Path or Browse to Log File, Folder or Glob (logs/**/*.log)");
+    // a typed path is used as is, a folder or a glob scans every matching log in it.
+    QObject::connect(fileSelectTextEdit, &QLineEdit::textEdited,
+                     this,
+                     [this](const QString &text) {
+                        logfilepath = text;
+                     }
+                    );
     fileSelectButton = new QPushButton("Browse");
     QObject::connect(fileSelectButton, &QPushButton::clicked, this, &Window::selectFile);
+    folderSelectButton = new QPushButton("Folder");
+    QObject::connect(folderSelectButton, &QPushButton::clicked, this, &Window::selectFolder);
 
     simplePushButton = new QPushButton(tr("RightPushButton"));
     QObject::connect(simplePushButton, &QPushButton::released,
@@ -312,34 +375,32 @@ void Window::createSimpleGroupBox()
     QObject::connect(regexPushButton, &QPushButton::released,
                      this,
                      [this]() {
-                        ////// std:: implementation //////
-                        ///// can also do Qt implementation 
-                        std::regex regex;
-                        std::smatch smatches;
-                        bool found;
-                        
                         if(!logfilepath.isEmpty()) {
 
-                            std::string filecontent;
-
-                            // get it into a ifstream and parse into std::string
-                            std::ifstream stream(logfilepath.toStdString());
-                            if (stream.good()) {
-
-                                filecontent = 
-                                std::string((std::istreambuf_iterator<char>(stream)),
-                                            std::istreambuf_iterator<char>());
+                            // the scan runs on the worker thread, results come back via queued signals.
+                            regexPushButton->setEnabled(false);
+                            scanFilepath = logfilepath;
+                            if(QFileInfo(logfilepath).isDir() || logfilepath.contains('*') || logfilepath.contains('?')) {
+                                emit directoryScanRequested(logfilepath, BuiltinPatterns::errors);
                             }
-                            stream.close();
-
-
-                            regex = std::regex("errors\\s*:\\s*(\\d+)", std::regex::ECMAScript);
-                            found = std::regex_search ( filecontent, smatches, regex );
-                            if(found) {
-                                std::string string_value = smatches.str(1);
-                                std::cout << "found: " << string_value << std::endl;
+                            else if(followCheckBox->isChecked()) {
+                                emit followRequested(logfilepath, BuiltinPatterns::errors);
+                            }
+                            else {
+                                emit scanRequested(logfilepath, BuiltinPatterns::errors);
                             }
+                        }
+                     }
+                    );
 
+    // keep scanning what gets appended to the log after the first scan.
+    followCheckBox = new QCheckBox(tr("Follow"));
+    followCheckBox->setChecked(false);
+    QObject::connect(followCheckBox, &QCheckBox::toggled,
+                     this,
+                     [this](bool checked) {
+                        if(!checked) {
+                            emit followStopRequested();
                         }
                      }
                     );
@@ -419,10 +480,12 @@ void Window::createSimpleGroupBox()
 
     column = 0; rowspan = 1; columnspan = 1;
     simpleGroupBoxLayout->addWidget(fileSelectLabel, row, column, rowspan, columnspan);
-    column = column + columnspan; rowspan = 1; columnspan = 3;
+    column = column + columnspan; rowspan = 1; columnspan = 2;
     simpleGroupBoxLayout->addWidget(fileSelectTextEdit, row, column, rowspan, columnspan);
     column = column + columnspan; rowspan = 1; columnspan = 1;
     simpleGroupBoxLayout->addWidget(fileSelectButton, row, column, rowspan, columnspan);
+    column = column + columnspan; rowspan = 1; columnspan = 1;
+    simpleGroupBoxLayout->addWidget(folderSelectButton, row, column, rowspan, columnspan);
     row += rowspan;
     total_columns = column + columnspan;
     if(total_columns > total_columns_max) total_columns_max = total_columns;
@@ -433,7 +496,9 @@ void Window::createSimpleGroupBox()
     total_columns = column + columnspan;
     if(total_columns > total_columns_max) total_columns_max = total_columns;
 
-    column = total_columns_max - 1; rowspan = 1; columnspan = 1;
+    column = total_columns_max - 2; rowspan = 1; columnspan = 1;
+    simpleGroupBoxLayout->addWidget(followCheckBox, row, column, rowspan, columnspan);
+    column = column + columnspan; rowspan = 1; columnspan = 1;
     simpleGroupBoxLayout->addWidget(regexPushButton, row, column, rowspan, columnspan);
     row += rowspan;
     total_columns = column + columnspan;
@@ -509,8 +574,9 @@ void Window::createSimpleGroupBox()
     fileSelectLabel->setMinimumWidth(200);
     fileSelectTextEdit->setMinimumWidth(400);
     fileSelectLayout->addWidget(fileSelectLabel, 1);
-    fileSelectLayout->addWidget(fileSelectTextEdit, 18);
+    fileSelectLayout->addWidget(fileSelectTextEdit, 17);
     fileSelectLayout->addWidget(fileSelectButton, 1);
+    fileSelectLayout->addWidget(folderSelectButton, 1);
     simpleGroupBoxLayout->addLayout(fileSelectLayout);
 
     QHBoxLayout* simplePushButtonLayout = new QHBoxLayout();
@@ -519,7 +585,8 @@ void Window::createSimpleGroupBox()
     simpleGroupBoxLayout->addLayout(simplePushButtonLayout);
 
     QHBoxLayout* regexPushButtonLayout = new QHBoxLayout();
-    regexPushButtonLayout->addStretch(19);
+    regexPushButtonLayout->addStretch(18);
+    regexPushButtonLayout->addWidget(followCheckBox, 1);
     regexPushButtonLayout->addWidget(regexPushButton, 1);
     simpleGroupBoxLayout->addLayout(regexPushButtonLayout);
 
@@ -572,17 +639,305 @@ void Window::createMenus() {
 }
 
 
+void Window::createScanWorker()
+{
+    scanProgressDialog = new QProgressDialog(tr("Scanning log file..."), tr("Cancel"), 0, 1000, this);
+    scanProgressDialog->setWindowTitle(tr("Scanning"));
+    // modeless: a modal QProgressDialog spins a nested event loop from setValue().
+    scanProgressDialog->setWindowModality(Qt::NonModal);
+    // only pop up if the scan takes a noticeable amount of time.
+    scanProgressDialog->setMinimumDuration(500);
+    scanProgressDialog->setAutoReset(false);
+    scanProgressDialog->reset();
+
+    scanThread = new QThread(this);
+    scanWorker = new ScanWorker();
+    scanWorker->setCacheDirectory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/scans");
+    scanWorker->moveToThread(scanThread);
+    connect(scanThread, &QThread::finished, scanWorker, &QObject::deleteLater);
+
+    // cross-thread connections, so these are all queued.
+    connect(this, &Window::scanRequested, scanWorker, &ScanWorker::scan);
+    connect(this, &Window::directoryScanRequested, scanWorker, &ScanWorker::scanDirectory);
+    connect(this, &Window::followRequested, scanWorker, &ScanWorker::follow);
+    connect(this, &Window::followStopRequested, scanWorker, &ScanWorker::stopFollowing);
+    connect(scanWorker, &ScanWorker::started, this, &Window::scanStarted);
+    connect(scanWorker, &ScanWorker::progress, this, &Window::scanProgress);
+    connect(scanWorker, &ScanWorker::recordsFound, this, &Window::scanRecordsFound);
+    connect(scanWorker, &ScanWorker::fileScanned, this, &Window::scanFileScanned);
+    connect(scanWorker, &ScanWorker::finished, this, &Window::scanFinished);
+    connect(scanWorker, &ScanWorker::followRestarted, this, &Window::followRestarted);
+    connect(scanWorker, &ScanWorker::followAppended, this, [this]() { logView->refresh(); });
+    connect(scanWorker, &ScanWorker::lineIndexReady, this, &Window::lineIndexReady);
+
+    // cancel() only sets an atomic flag, so it is called directly from the GUI thread.
+    connect(scanProgressDialog, &QProgressDialog::canceled, this, [this]() { scanWorker->cancel(); });
+
+#if QUETZALCOATLUS_SCAN_METRICS
+    scanMetricsTimer = new QTimer(this);
+    scanMetricsTimer->setInterval(500);
+    connect(scanMetricsTimer, &QTimer::timeout, this, &Window::showScanMetrics);
+#endif
+
+    scanThread->start();
+}
+
+
+#if QUETZALCOATLUS_SCAN_METRICS
+void Window::showScanMetrics()
+{
+    const ScanMetrics::Snapshot now = ScanMetrics::snapshot();
+    auto delta = [&](ScanMetrics::Counter counter) {
+        return static_cast<double>(now[counter] - scanMetricsStart[counter]);
+    };
+    const double seconds = std::max(static_cast<double>(ScanMetrics::now() - scanMetricsStartTime) / 1e9, 1e-3);
+    const double megabytes = delta(ScanMetrics::BytesRead) / (1024.0 * 1024.0);
+
+    // of the time the scan threads spent reading or matching, the share spent waiting on the reads.
+    const double busy = delta(ScanMetrics::IoWaitNanoseconds) + delta(ScanMetrics::MatchNanoseconds);
+    const double ioWait = busy > 0 ? delta(ScanMetrics::IoWaitNanoseconds) / busy : 0;
+
+    statusBar()->showMessage(tr("%1 MB/s, %2 MB read, %3 candidates, %4 matches, %5% I/O wait")
+                             .arg(megabytes / seconds, 0, 'f', 0)
+                             .arg(megabytes, 0, 'f', 0)
+                             .arg(static_cast<qulonglong>(delta(ScanMetrics::Candidates)))
+                             .arg(static_cast<qulonglong>(delta(ScanMetrics::Matches)))
+                             .arg(ioWait * 100, 0, 'f', 0));
+}
+#endif // #if QUETZALCOATLUS_SCAN_METRICS
+
+
+void Window::createResultView()
+{
+    resultModel = new ResultTableModel(this);
+
+    resultView = new QTableView();
+    resultView->setModel(resultModel);
+    // millions of rows: every row the same height, so the view never measures them, and the
+    // columns are not sized to their contents either, which would go through all of them.
+    resultView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    resultView->verticalHeader()->setDefaultSectionSize(resultView->fontMetrics().height() + 6);
+    resultView->horizontalHeader()->setSectionResizeMode(QHeaderView::Interactive);
+    resultView->horizontalHeader()->setStretchLastSection(true);
+    resultView->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+    resultView->setSortingEnabled(true);
+    resultView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    resultView->setWordWrap(false);
+    connect(resultView, &QTableView::activated, this, &Window::resultActivated);
+
+    stageFilterSpinBox = new QSpinBox();
+    stageFilterSpinBox->setRange(-1, 1000000);
+    stageFilterSpinBox->setValue(-1);
+    stageFilterSpinBox->setSpecialValueText(tr("all"));
+    connect(stageFilterSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), this, &Window::resultFilterChanged);
+
+    valueFromLineEdit = new QLineEdit();
+    valueFromLineEdit->setPlaceholderText(tr("min"));
+    connect(valueFromLineEdit, &QLineEdit::editingFinished, this, &Window::resultFilterChanged);
+    valueToLineEdit = new QLineEdit();
+    valueToLineEdit->setPlaceholderText(tr("max"));
+    connect(valueToLineEdit, &QLineEdit::editingFinished, this, &Window::resultFilterChanged);
+
+    QHBoxLayout* filterLayout = new QHBoxLayout();
+    filterLayout->addWidget(new QLabel(tr("Stage")));
+    filterLayout->addWidget(stageFilterSpinBox);
+    filterLayout->addWidget(new QLabel(tr("Value")));
+    filterLayout->addWidget(valueFromLineEdit);
+    filterLayout->addWidget(valueToLineEdit);
+    filterLayout->addStretch(1);
+
+    QVBoxLayout* resultLayout = new QVBoxLayout();
+    resultLayout->setContentsMargins(0, 0, 0, 0);
+    resultLayout->addLayout(filterLayout);
+    resultLayout->addWidget(resultView);
+    QWidget* resultPane = new QWidget();
+    resultPane->setLayout(resultLayout);
+
+    // activating (double click, enter) a result shows it in the log.
+    logView = new LogView();
+    logSearchLineEdit = new QLineEdit();
+    logSearchLineEdit->setPlaceholderText(tr("Search the log (Enter: next, F3 / Shift+F3 in the log)"));
+    logSearchLineEdit->setClearButtonEnabled(true);
+    connect(logSearchLineEdit, &QLineEdit::textChanged, logView, &LogView::search);
+    connect(logSearchLineEdit, &QLineEdit::returnPressed, logView, &LogView::findNext);
+    connect(logView, &LogView::searchFinished, this, [this](bool found) {
+        if(!found) {
+            statusBar()->showMessage(tr("'%1' not found").arg(logSearchLineEdit->text()), 3000);
+        }
+    });
+
+    goToLineLineEdit = new QLineEdit();
+    goToLineLineEdit->setPlaceholderText(tr("Line"));
+    goToLineLineEdit->setMaximumWidth(120);
+    connect(goToLineLineEdit, &QLineEdit::returnPressed, this, [this]() {
+        bool ok = false;
+        const qulonglong line = goToLineLineEdit->text().trimmed().toULongLong(&ok);
+        if(!ok || !logView->goToLine(line)) {
+            statusBar()->showMessage(tr("Cannot go to line '%1' (the log is not indexed yet, or is shorter)")
+                                     .arg(goToLineLineEdit->text()), 3000);
+        }
+    });
+
+    QHBoxLayout* logSearchLayout = new QHBoxLayout();
+    logSearchLayout->addWidget(logSearchLineEdit, 1);
+    logSearchLayout->addWidget(goToLineLineEdit);
+
+    QVBoxLayout* logLayout = new QVBoxLayout();
+    logLayout->setContentsMargins(0, 0, 0, 0);
+    logLayout->addLayout(logSearchLayout);
+    logLayout->addWidget(logView);
+    QWidget* logPane = new QWidget();
+    logPane->setLayout(logLayout);
+
+    QSplitter* splitter = new QSplitter(Qt::Horizontal);
+    splitter->addWidget(resultPane);
+    splitter->addWidget(logPane);
+    splitter->setStretchFactor(0, 1);
+    splitter->setStretchFactor(1, 2);
+    resultWidget = splitter;
+}
+
+
+void Window::resultActivated(const QModelIndex &index)
+{
+    if(!index.isValid()) {
+        return;
+    }
+    const QString filepath = resultModel->filepath(index.row());
+    if(logView->filepath() != filepath) {
+        if(!logView->open(filepath)) {
+            statusBar()->showMessage(tr("Cannot show '%1' (compressed logs cannot be viewed)").arg(filepath));
+            return;
+        }
+        logView->setLineIndex(lineIndexes.value(filepath));
+    }
+    const StageRecord& record = resultModel->record(index.row());
+    logView->jumpTo(record.offset, record.line);
+}
+
+
+void Window::resultFilterChanged()
+{
+    ResultFilter filter;
+    if(stageFilterSpinBox->value() >= 0) {
+        filter.stageFrom = static_cast<std::uint32_t>(stageFilterSpinBox->value());
+        filter.stageTo = filter.stageFrom;
+    }
+    // an empty or invalid bound is no bound.
+    bool ok = false;
+    const qlonglong valueFrom = valueFromLineEdit->text().trimmed().toLongLong(&ok);
+    if(ok) {
+        filter.valueFrom = valueFrom;
+    }
+    const qlonglong valueTo = valueToLineEdit->text().trimmed().toLongLong(&ok);
+    if(ok) {
+        filter.valueTo = valueTo;
+    }
+    resultModel->setFilter(filter);
+    statusBar()->showMessage(tr("%1 of %2 matches").arg(resultModel->rowCount()).arg(resultModel->recordCount()));
+}
+
+
+void Window::lineIndexReady(const QString &filepath, std::shared_ptr<const LineIndex> index)
+{
+    lineIndexes.insert(filepath, index);
+    if(logView->filepath() == filepath) {
+        logView->setLineIndex(index);
+    }
+}
+
+
+void Window::scanStarted(qint64 totalBytes)
+{
+    Q_UNUSED(totalBytes);
+    resultModel->clear();
+    // mapped as it was, the log may have changed since.
+    logView->close();
+    lineIndexes.clear();
+    scanProgressDialog->setValue(0);
+#if QUETZALCOATLUS_SCAN_METRICS
+    scanMetricsStart = ScanMetrics::snapshot();
+    scanMetricsStartTime = ScanMetrics::now();
+    scanMetricsTimer->start();
+#endif
+}
+
+
+void Window::scanProgress(qint64 bytesScanned, qint64 totalBytes)
+{
+    if(totalBytes > 0 && !scanProgressDialog->wasCanceled()) {
+        scanProgressDialog->setValue(static_cast<int>(bytesScanned * 1000 / totalBytes));
+    }
+}
+
+
+void Window::scanRecordsFound(const QVector<StageRecord> &records)
+{
+    resultModel->append(scanFilepath, records);
+}
+
+
+void Window::scanFinished(bool completed)
+{
+    resultModel->mergeAppended();
+    scanProgressDialog->reset();
+    regexPushButton->setEnabled(true);
+    QString message = (completed ? tr("%1 of %2 matches") : tr("%1 of %2 matches (incomplete)"))
+                      .arg(resultModel->rowCount()).arg(resultModel->recordCount());
+#if QUETZALCOATLUS_SCAN_METRICS
+    scanMetricsTimer->stop();
+    const double seconds = static_cast<double>(ScanMetrics::now() - scanMetricsStartTime) / 1e9;
+    const double megabytes = static_cast<double>(ScanMetrics::snapshot()[ScanMetrics::BytesRead] -
+                                                 scanMetricsStart[ScanMetrics::BytesRead]) / (1024.0 * 1024.0);
+    message += tr(", %1 MB in %2 s").arg(megabytes, 0, 'f', 0).arg(seconds, 0, 'f', 2);
+#endif
+    statusBar()->showMessage(message);
+}
+
+
+void Window::scanFileScanned(const QString &filepath, const QVector<StageRecord> &records, bool completed)
+{
+    if(!completed) {
+        qWarning().noquote() << filepath << "was not scanned completely";
+    }
+    resultModel->append(filepath, records);
+}
+
+
+void Window::followRestarted()
+{
+    resultModel->clear();
+    // shown again from the start, the old mapping is not touched anymore (a log truncated and
+    // grown past its old size between two polls looks to refresh() as if it had only grown).
+    const QString shown = logView->filepath();
+    if(!shown.isEmpty()) {
+        logView->open(shown);
+    }
+    lineIndexes.clear();
+    statusBar()->showMessage(tr("Log restarted, rescanning"));
+}
+
+
 void Window::selectFile() {
     logfilepath = QFileDialog::getOpenFileName(this,
                                                "Select Log File",
                                                QDir::currentPath(),
-                                               "Log Files (*.log);;Text Files (*.txt);;All Files (*.*)",
+                                               "Log Files (*.log *.log.gz *.log.zst);;Compressed Files (*.gz *.zst);;Text Files (*.txt);;All Files (*.*)",
                                                nullptr,
                                                QFileDialog::DontUseNativeDialog);
     fileSelectTextEdit->setText(QDir(QDir::currentPath()).filePath(logfilepath));
 }
 
 
+void Window::selectFolder() {
+    logfilepath = QFileDialog::getExistingDirectory(this,
+                                                    "Select Log Folder",
+                                                    QDir::currentPath(),
+                                                    QFileDialog::ShowDirsOnly | QFileDialog::DontUseNativeDialog);
+    fileSelectTextEdit->setText(logfilepath);
+}
+
+
 void Window::about() {
 
     QDialog* dialog = new QDialog(this);
@@ -594,8 +949,8 @@ void Window::about() {
 
     QHBoxLayout* logoAndAppInfoHBoxLayout = new QHBoxLayout();
     QLabel* logoLabel = new QLabel();
-    // pixmap from a svg, via QIcon (or use QIcon directly):
-    QPixmap p = QIcon(":/images/logo.svg").pixmap(QSize(100,100)); // use original image w,h or multiple.
+    // pixmap from a svg, pre-rendered or rendered once (see IconCache):
+    QPixmap p = IconCache::pixmap(":/images/logo.svg", QSize(100,100), devicePixelRatioF()); // use original image w,h or multiple.
     if(!p.isNull()) {
         logoLabel->setPixmap(p);
     }
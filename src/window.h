@@ -4,36 +4,66 @@
 #define WINDOW_H
 
 #include <QSystemTrayIcon>
+#include <QHash>
 #include <QMainWindow>
+#include <QVector>
+
+#include <memory>
+
+#include "lineindex.h"
+#include "quetzalcoatlus_config.h"
+#include "scanmetrics.h"
+#include "stageseries.h"
 
 
 QT_BEGIN_NAMESPACE
 class QAction;
 class QCheckBox;
 class QComboBox;
+class QDialog;
 class QGroupBox;
 class QLabel;
 class QLineEdit;
 class QMenu;
 class QPushButton;
 class QSpinBox;
+class QTableView;
 class QTextEdit;
+class QThread;
+class QTimer;
+class QProgressDialog;
+class QModelIndex;
 QT_END_NAMESPACE
 
+class AnimationPlayer;
+class LogView;
+class ResultTableModel;
+class ScanWorker;
+
 class Window : public QMainWindow
 {
     Q_OBJECT
 
 public:
     Window();
+    ~Window() override;
     void setVisible(bool visible) override;
 
 public slots:
     void setPositionAndSize();
 
+signals:
+    void scanRequested(const QString &filepath, const QString &pattern);
+    void directoryScanRequested(const QString &path, const QString &pattern);
+    void followRequested(const QString &filepath, const QString &pattern);
+    void followStopRequested();
+    // once, when the window has painted for the first time (the end of the startup).
+    void firstFramePainted();
+
 protected:
     void closeEvent(QCloseEvent *event) override;
     void changeEvent(QEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
 
 private slots:
 #ifndef QT_NO_SYSTEMTRAYICON
@@ -42,12 +72,28 @@ private slots:
     void messageClicked();
 #endif
     void selectFile();
+    void selectFolder();
     void about();
+    void scanStarted(qint64 totalBytes);
+    void scanProgress(qint64 bytesScanned, qint64 totalBytes);
+    void scanRecordsFound(const QVector<StageRecord> &records);
+    void scanFileScanned(const QString &filepath, const QVector<StageRecord> &records, bool completed);
+    void scanFinished(bool completed);
+    void followRestarted();
+    void resultFilterChanged();
+    void resultActivated(const QModelIndex &index);
+    void lineIndexReady(const QString &filepath, std::shared_ptr<const LineIndex> index);
 
 private:
     void createSimpleGroupBox();
     void createActions();
     void createMenus();
+    void createScanWorker();
+    void createResultView();
+#if QUETZALCOATLUS_SCAN_METRICS
+    // throughput and counts of the running scan, in the status bar.
+    void showScanMetrics();
+#endif
 #ifndef QT_NO_SYSTEMTRAYICON
     void createTrayIcon();
 #endif
@@ -68,18 +114,23 @@ private:
 
     QLabel *simplePixmapLabelLabel;
     QLabel *simplePixmapLabel;
+    // shared by every click on simplePixmapPushButton.
+    AnimationPlayer *accretionDiskPlayer;
+    QDialog *accretionDiskDialog;
 
     QLabel *simplePixmapPushButtonLabel;
     QPushButton *simplePixmapPushButton;
 
     QPushButton *simplePushButton;
     QPushButton *regexPushButton;
+    QCheckBox *followCheckBox;
 
     QCheckBox *simpleCheckBox;
 
     QLabel* fileSelectLabel;
     QLineEdit* fileSelectTextEdit;
     QPushButton* fileSelectButton;
+    QPushButton* folderSelectButton;
 
 
     QAction *minimizeAction;
@@ -97,6 +148,34 @@ private:
 #endif // #ifndef QT_NO_SYSTEMTRAYICON
 
     QString logfilepath;
+
+    // the matches of the last scan.
+    ResultTableModel *resultModel;
+    QTableView *resultView;
+    QSpinBox *stageFilterSpinBox;
+    QLineEdit *valueFromLineEdit;
+    QLineEdit *valueToLineEdit;
+    QWidget *resultWidget;
+    // the log around the match picked in the results.
+    LogView *logView;
+    QLineEdit *logSearchLineEdit;
+    QLineEdit *goToLineLineEdit;
+    // of the logs scanned since the last scan started, for the log view.
+    QHash<QString, std::shared_ptr<const LineIndex>> lineIndexes;
+    // the file the records of scan() and follow() come from.
+    QString scanFilepath;
+
+    QThread *scanThread;
+    ScanWorker *scanWorker;
+    QProgressDialog *scanProgressDialog;
+#if QUETZALCOATLUS_SCAN_METRICS
+    QTimer *scanMetricsTimer;
+    // when the scan started, and the counters then.
+    ScanMetrics::Snapshot scanMetricsStart;
+    std::uint64_t scanMetricsStartTime = 0;
+#endif
+
+    bool painted = false;
 };
 
 #endif // #ifndef WINDOW_H